@@ -0,0 +1,148 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "daking/actor.hpp"
+
+/*
+     Message throughput of daking::actor_system, 10k actors by default:
+     - BM_Actors_FanIn/{A}/{W}: 4 outside threads send round-robin to A actors run by W workers,
+                                 the run ends when every actor has received its share.
+     - BM_Actors_Ring/{A}/{W}:   every actor starts with one token and forwards it to the next actor,
+                                 so all traffic is actor-to-actor (and every send is an empty-to-non-empty one at worst).
+     Reported: items/s, where an item is one message received.
+*/
+
+constexpr int kSenders          = 4;
+constexpr int kMessagesPerActor = 200;
+
+struct Payload {
+    std::uint64_t value;
+    std::uint64_t pad[3];
+};
+
+struct Sink : daking::actor<Payload> {
+    Sink(std::atomic<int>& finished, int expected) : finished(finished), expected(expected) {}
+
+    void receive(Payload& message) override {
+        sum += message.value;
+        if (++received == expected) {
+            finished.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    std::atomic<int>& finished;
+    const int         expected;
+    int               received = 0;
+    std::uint64_t     sum      = 0;
+};
+
+static void BM_Actors_FanIn(benchmark::State& state) {
+    const int num_actors  = (int)state.range(0);
+    const int num_workers = (int)state.range(1);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::atomic<int> finished{0};
+        auto system = std::make_unique<daking::actor_system>(num_workers);
+        std::vector<Sink*> actors;
+        for (int i = 0; i < num_actors; ++i) {
+            actors.push_back(system->spawn<Sink>(finished, kMessagesPerActor));
+        }
+        state.ResumeTiming();
+
+        std::vector<std::thread> senders;
+        for (int s = 0; s < kSenders; ++s) {
+            senders.emplace_back([&, s]() {
+                for (int round = s; round < kMessagesPerActor; round += kSenders) {
+                    for (auto* a : actors) {
+                        a->send(Payload{(std::uint64_t)round, {}});
+                    }
+                }
+            });
+        }
+        for (auto& t : senders) t.join();
+        while (finished.load(std::memory_order_acquire) < num_actors) {
+            std::this_thread::yield();
+        }
+
+        state.PauseTiming();
+        system.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed((int64_t)num_actors * kMessagesPerActor * state.iterations());
+    state.SetLabel("A=" + std::to_string(num_actors) + " W=" + std::to_string(num_workers));
+}
+
+struct Relay : daking::actor<Payload> {
+    Relay(std::atomic<int>& finished, int hops) : finished(finished), hops(hops) {}
+
+    void receive(Payload& message) override {
+        if (++received == hops) {
+            finished.fetch_add(1, std::memory_order_release);
+        }
+        if (message.value > 0) {
+            next->send(Payload{message.value - 1, {}});
+        }
+    }
+
+    std::atomic<int>& finished;
+    const int         hops;
+    int               received = 0;
+    Relay*            next     = nullptr;
+};
+
+static void BM_Actors_Ring(benchmark::State& state) {
+    const int num_actors  = (int)state.range(0);
+    const int num_workers = (int)state.range(1);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::atomic<int> finished{0};
+        auto system = std::make_unique<daking::actor_system>(num_workers);
+        std::vector<Relay*> ring;
+        for (int i = 0; i < num_actors; ++i) {
+            ring.push_back(system->spawn<Relay>(finished, kMessagesPerActor));
+        }
+        for (int i = 0; i < num_actors; ++i) {
+            ring[i]->next = ring[(i + 1) % num_actors];
+        }
+        state.ResumeTiming();
+
+        // Every token makes kMessagesPerActor hops, so every actor receives exactly kMessagesPerActor messages.
+        for (auto* a : ring) {
+            a->send(Payload{(std::uint64_t)kMessagesPerActor - 1, {}});
+        }
+        while (finished.load(std::memory_order_acquire) < num_actors) {
+            std::this_thread::yield();
+        }
+
+        state.PauseTiming();
+        system.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed((int64_t)num_actors * kMessagesPerActor * state.iterations());
+    state.SetLabel("A=" + std::to_string(num_actors) + " W=" + std::to_string(num_workers));
+}
+
+BENCHMARK(BM_Actors_FanIn)
+    ->ArgNames({"A", "W"})
+    ->ArgsProduct({{1000, 10000}, {1, 2, 4, 8}})
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_Actors_Ring)
+    ->ArgNames({"A", "W"})
+    ->ArgsProduct({{1000, 10000}, {1, 2, 4, 8}})
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
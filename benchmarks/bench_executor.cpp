@@ -0,0 +1,194 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string>
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+
+#include "daking/executor.hpp"
+
+/*
+     daking::executor against the usual mutex + condition_variable pool (one std::deque<std::function<void()>>):
+     - BM_ForkJoin_{Executor,MutexPool}/{W}:    one root task splits into two until depth 16, the leaves count themselves
+                                                 (65536 leaves, 131071 tasks). Every task is posted from a worker.
+     - BM_FanOutFanIn_{Executor,MutexPool}/{W}: the main thread posts 10000 small tasks, waits until all of them ran, 20 rounds.
+     Reported: items/s (tasks), and mallocs_per_task, counted by replacing the global operator new in this file.
+*/
+
+static std::atomic<std::uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+class mutex_pool {
+public:
+    explicit mutex_pool(std::size_t worker_count) {
+        for (std::size_t i = 0; i < worker_count; i++) {
+            workers_.emplace_back([this]() {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while (true) {
+                    wake_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+                    if (tasks_.empty()) {
+                        return;
+                    }
+                    std::function<void()> task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                    lock.unlock();
+                    task();
+                    lock.lock();
+                }
+            });
+        }
+    }
+
+    ~mutex_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    template <typename F>
+    void post(F&& f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back(std::forward<F>(f));
+        }
+        wake_.notify_one();
+    }
+
+private:
+    std::mutex                        mutex_;
+    std::condition_variable           wake_;
+    std::deque<std::function<void()>> tasks_;
+    bool                              stop_ = false;
+    std::vector<std::thread>          workers_;
+};
+
+constexpr int kForkDepth      = 16;
+constexpr int kFanOutTasks    = 10000;
+constexpr int kFanOutRounds   = 20;
+
+static void wait_until(const std::atomic<int>& counter, int expected) {
+    while (counter.load(std::memory_order_acquire) < expected) {
+        std::this_thread::yield();
+    }
+}
+
+template <typename Pool>
+struct Fork {
+    Pool*             pool;
+    std::atomic<int>* leaves;
+    std::uint64_t     salt;
+
+    void operator()(int depth) const {
+        if (depth == 0) {
+            benchmark::DoNotOptimize(salt * 2654435761u);
+            leaves->fetch_add(1, std::memory_order_release);
+            return;
+        }
+        Fork left{ pool, leaves, salt * 2 }, right{ pool, leaves, salt * 2 + 1 };
+        pool->post([left, depth]() { left(depth - 1); });
+        pool->post([right, depth]() { right(depth - 1); });
+    }
+};
+
+template <typename Pool>
+static void BM_ForkJoin(benchmark::State& state) {
+    const int num_workers = (int)state.range(0);
+    Pool pool(num_workers);
+    std::uint64_t allocations = 0;
+
+    for (auto _ : state) {
+        std::atomic<int> leaves{0};
+        std::uint64_t before = g_allocations.load(std::memory_order_relaxed);
+        Fork<Pool> root{ &pool, &leaves, 1 };
+        pool.post([root]() { root(kForkDepth); });
+        wait_until(leaves, 1 << kForkDepth);
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    }
+
+    const std::int64_t tasks = (2ll << kForkDepth) - 1;
+    state.SetItemsProcessed(tasks * state.iterations());
+    state.counters["mallocs_per_task"] = (double)allocations / (double)(tasks * state.iterations());
+    state.SetLabel("W=" + std::to_string(num_workers));
+}
+
+template <typename Pool>
+static void BM_FanOutFanIn(benchmark::State& state) {
+    const int num_workers = (int)state.range(0);
+    Pool pool(num_workers);
+    std::uint64_t allocations = 0;
+
+    for (auto _ : state) {
+        std::uint64_t before = g_allocations.load(std::memory_order_relaxed);
+        for (int round = 0; round < kFanOutRounds; ++round) {
+            std::atomic<int> done{0};
+            for (int i = 0; i < kFanOutTasks; ++i) {
+                pool.post([&done, i]() {
+                    benchmark::DoNotOptimize(i * 2654435761u);
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+            wait_until(done, kFanOutTasks);
+        }
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    }
+
+    const std::int64_t tasks = (std::int64_t)kFanOutTasks * kFanOutRounds;
+    state.SetItemsProcessed(tasks * state.iterations());
+    state.counters["mallocs_per_task"] = (double)allocations / (double)(tasks * state.iterations());
+    state.SetLabel("W=" + std::to_string(num_workers));
+}
+
+BENCHMARK_TEMPLATE(BM_ForkJoin, daking::executor)
+    ->Name("BM_ForkJoin_Executor")
+    ->ArgName("W")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_ForkJoin, mutex_pool)
+    ->Name("BM_ForkJoin_MutexPool")
+    ->ArgName("W")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_FanOutFanIn, daking::executor)
+    ->Name("BM_FanOutFanIn_Executor")
+    ->ArgName("W")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_FanOutFanIn, mutex_pool)
+    ->Name("BM_FanOutFanIn_MutexPool")
+    ->ArgName("W")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
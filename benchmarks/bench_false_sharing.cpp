@@ -0,0 +1,210 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "daking/MPSC_queue.hpp"
+
+/*
+     False sharing on the global pool statics, with hardware counters where the kernel exposes them:
+     - BM_Pool/{n}:            n producers enqueue one by one into a queue of thread_local_capacity 16, one consumer drains.
+                               Every 16 elements a producer pops a chunk from the global stack and the consumer pushes one,
+                               while every enqueue and dequeue reads the manager pointer.
+     - BM_Layout<Adjacent>/{n}: the same two accesses on a copy of the former layout, stack top and manager pointer
+                               on one line; n - 1 threads read the pointer, one thread CASes the top.
+     - BM_Layout<Isolated>/{n}: the same with both on their own line, as the pool declares them now.
+     Reported: items/s, and per item: cache_misses (PERF_COUNT_HW_CACHE_MISSES) and l1d_misses (L1D read misses),
+     counted in user space over every thread of the iteration.
+     Without a PMU (most VMs, perf_event_paranoid > 2) the label says so and only time is reported.
+     Generic events have no HITM, on Intel record the snoops with:
+         perf c2c record -- ./mpsc_bench_false_sharing --benchmark_filter=BM_Pool
+         perf c2c report --stdio
+     To compare BM_Pool with the former layout, build this file against the header of the previous release.
+*/
+
+#if defined(__linux__)
+class PerfCounters {
+public:
+    PerfCounters() {
+        fds_[0] = _open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds_[1] = _open(PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    bool available() const noexcept {
+        return fds_[0] >= 0;
+    }
+
+    void start() noexcept {
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    // Threads must be joined first: inherited counts are folded into the parent when a child exits.
+    void stop(std::uint64_t& cache_misses, std::uint64_t& l1d_misses) noexcept {
+        std::uint64_t* out[2] = { &cache_misses, &l1d_misses };
+        for (int i = 0; i < 2; ++i) {
+            std::uint64_t value = 0;
+            if (fds_[i] >= 0) {
+                ::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+                if (::read(fds_[i], &value, sizeof(value)) != sizeof(value)) value = 0;
+            }
+            *out[i] += value;
+        }
+    }
+
+private:
+    static int _open(std::uint32_t type, std::uint64_t config) noexcept {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.disabled       = 1;
+        attr.inherit        = 1; /* Threads created after the counter is opened */
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        return (int)::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    int fds_[2];
+};
+#else
+class PerfCounters {
+public:
+    bool available() const noexcept { return false; }
+    void start() noexcept {}
+    void stop(std::uint64_t&, std::uint64_t&) noexcept {}
+};
+#endif
+
+static void report(benchmark::State& state, bool available, std::uint64_t cache_misses, std::uint64_t l1d_misses, int64_t items) {
+    state.SetItemsProcessed(items);
+    if (!available) {
+        state.SetLabel("perf counters unavailable");
+        return;
+    }
+    state.counters["cache_misses"] = benchmark::Counter((double)cache_misses / (double)items);
+    state.counters["l1d_misses"]   = benchmark::Counter((double)l1d_misses / (double)items);
+}
+
+struct Payload {
+    std::uint64_t value[2];
+};
+
+using Queue = daking::MPSC_queue<Payload, 16>;
+
+constexpr int64_t kPerProducer = 1 << 18;
+
+static void BM_Pool(benchmark::State& state) {
+    const int num_producers = (int)state.range(0);
+    std::uint64_t cache_misses = 0, l1d_misses = 0;
+    bool available = false;
+
+    for (auto _ : state) {
+        Queue queue;
+        PerfCounters counters; // Opened before the threads exist, so that they inherit it
+        available = counters.available();
+        std::atomic<bool> start{ false };
+        std::vector<std::thread> producers;
+        for (int p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&]() {
+                while (!start.load(std::memory_order_acquire));
+                Payload payload{};
+                for (int64_t i = 0; i < kPerProducer; ++i) {
+                    payload.value[0] = (std::uint64_t)i;
+                    queue.enqueue(payload);
+                }
+            });
+        }
+
+        counters.start();
+        start.store(true, std::memory_order_release);
+        Payload payload;
+        for (int64_t received = 0; received < kPerProducer * num_producers;) {
+            if (queue.try_dequeue(payload)) {
+                received++;
+            }
+        }
+        for (auto& t : producers) {
+            t.join();
+        }
+        counters.stop(cache_misses, l1d_misses);
+    }
+
+    report(state, available, cache_misses, l1d_misses, state.iterations() * kPerProducer * num_producers);
+}
+
+// The former declarations: the chunk stack top and the manager pointer could end up on one line, here they always do.
+struct alignas(64) Adjacent {
+    std::atomic<std::uint64_t> top_{ 0 };
+    std::atomic<void*>         manager_{ nullptr };
+};
+
+struct Isolated {
+    alignas(64) std::atomic<std::uint64_t> top_{ 0 };
+    alignas(64) std::atomic<void*>         manager_{ nullptr };
+};
+
+template <typename Layout>
+static void BM_Layout(benchmark::State& state) {
+    const int num_readers = (int)state.range(0) - 1;
+    std::uint64_t cache_misses = 0, l1d_misses = 0;
+    bool available = false;
+
+    for (auto _ : state) {
+        Layout layout;
+        layout.manager_.store(&layout, std::memory_order_relaxed);
+        PerfCounters counters;
+        available = counters.available();
+        std::atomic<bool> start{ false };
+        std::vector<std::thread> readers;
+        for (int r = 0; r < num_readers; ++r) {
+            readers.emplace_back([&]() {
+                while (!start.load(std::memory_order_acquire));
+                for (int64_t i = 0; i < kPerProducer; ++i) {
+                    benchmark::DoNotOptimize(layout.manager_.load(std::memory_order_acquire)); // _get_global_manager()
+                }
+            });
+        }
+
+        counters.start();
+        start.store(true, std::memory_order_release);
+        for (int64_t i = 0; i < kPerProducer; ++i) {
+            std::uint64_t top = layout.top_.load(std::memory_order_relaxed);
+            while (!layout.top_.compare_exchange_weak(top, top + 1, std::memory_order_acq_rel, std::memory_order_relaxed)); // Refill
+        }
+        for (auto& t : readers) {
+            t.join();
+        }
+        counters.stop(cache_misses, l1d_misses);
+    }
+
+    report(state, available, cache_misses, l1d_misses, state.iterations() * kPerProducer * (num_readers + 1));
+}
+
+BENCHMARK(BM_Pool)->Arg(8)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Layout, Adjacent)->Arg(8)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Layout, Isolated)->Arg(8)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
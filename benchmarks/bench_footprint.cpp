@@ -0,0 +1,172 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#include "daking/MPSC_queue.hpp"
+#include "bench_utils.hpp"
+
+/*
+     Memory footprint over time. Pages are only released by the last instance of a queue type,
+     and exited threads park their thread-local pools, so the pool is sized by the worst moment it has seen.
+     - BM_Footprint_BurstIdle/{P}/{burst}: P long-lived producers each push a burst while the consumer is idle,
+       then the consumer drains everything and the process idles, for a number of cycles.
+     - BM_Footprint_ThreadChurn/{threads}: waves of short-lived producer threads, each sends a few messages and exits.
+     Reported (bytes):
+       peak_pool / steady_pool: global pool size at its peak and after the last cycle,
+       peak_rss:                growth of the process RSS over the run,
+       peak_per_inflight:       peak_pool / largest number of messages in flight,
+       steady_per_inflight:     steady_pool / largest number of messages in flight,
+     and where the nodes sit at the end: free (global chunk stack), parked (exited threads), in_use (the rest).
+*/
+
+struct Message {
+    std::uint64_t sequence;
+    char          payload[56];
+};
+
+using FootprintQueue = daking::MPSC_queue<Message>;
+
+struct footprint_t {
+    std::size_t rss_baseline_   = 0;
+    std::size_t peak_rss_       = 0;
+    std::size_t peak_pool_      = 0;
+    std::size_t peak_inflight_  = 0;
+    std::size_t peak_parked_    = 0;
+
+    void sample(std::size_t inflight) {
+        daking::MPSC_pool_stats stats = FootprintQueue::global_pool_stats();
+        peak_rss_      = std::max(peak_rss_, bench::current_rss_bytes());
+        peak_pool_     = std::max(peak_pool_, stats.byte_count_);
+        peak_inflight_ = std::max(peak_inflight_, inflight);
+        peak_parked_   = std::max(peak_parked_, stats.parked_node_count_);
+    }
+
+    void report(benchmark::State& state) const {
+        daking::MPSC_pool_stats stats = FootprintQueue::global_pool_stats();
+        double inflight = (double)std::max<std::size_t>(1, peak_inflight_);
+        state.counters["peak_pool"]           = (double)peak_pool_;
+        state.counters["steady_pool"]         = (double)stats.byte_count_;
+        state.counters["peak_rss"]            = (double)(peak_rss_ > rss_baseline_ ? peak_rss_ - rss_baseline_ : 0);
+        state.counters["peak_per_inflight"]   = (double)peak_pool_ / inflight;
+        state.counters["steady_per_inflight"] = (double)stats.byte_count_ / inflight;
+        state.counters["pages"]               = (double)stats.page_count_;
+        state.counters["free_nodes"]          = (double)stats.free_node_count_;
+        state.counters["parked_nodes"]        = (double)stats.parked_node_count_;
+        state.counters["peak_parked_nodes"]   = (double)peak_parked_;
+        state.counters["in_use_nodes"]        = (double)stats.in_use_node_count();
+    }
+};
+
+static void BM_Footprint_BurstIdle(benchmark::State& state) {
+    const int         num_producers = (int)state.range(0);
+    const std::size_t burst         = (std::size_t)state.range(1);
+    constexpr int     cycles        = 20;
+
+    for (auto _ : state) {
+        footprint_t footprint;
+        footprint.rss_baseline_ = bench::current_rss_bytes();
+        FootprintQueue q;
+
+        std::atomic<int> go{0};
+        std::atomic<int> done{0};
+        std::vector<std::thread> producers;
+        for (int i = 0; i < num_producers; ++i) {
+            producers.emplace_back([&, i]() {
+                for (int cycle = 1; cycle <= cycles; ++cycle) {
+                    while (go.load(std::memory_order_acquire) < cycle) {
+                        std::this_thread::yield();
+                    }
+                    for (std::size_t k = 0; k < burst; ++k) {
+                        q.enqueue(Message{ k, {} });
+                    }
+                    done.fetch_add(1, std::memory_order_release);
+                }
+            });
+        }
+
+        Message message;
+        for (int cycle = 1; cycle <= cycles; ++cycle) {
+            go.store(cycle, std::memory_order_release);
+            while (done.load(std::memory_order_acquire) < cycle * num_producers) {
+                std::this_thread::yield();
+            }
+            footprint.sample(burst * num_producers);
+            for (std::size_t k = 0; k < burst * num_producers; ++k) {
+                while (!q.try_dequeue(message));
+            }
+            footprint.sample(0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        for (auto& t : producers) t.join();
+
+        footprint.sample(0);
+        footprint.report(state);
+    }
+    state.SetLabel("P=" + std::to_string(num_producers) + ", burst " + std::to_string(burst));
+}
+
+BENCHMARK(BM_Footprint_BurstIdle)
+    ->ArgNames({ "P", "burst" })
+    ->ArgsProduct({ { 1, 4, 8 }, { 1024, 65536 } })
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_Footprint_ThreadChurn(benchmark::State& state) {
+    const int         threads_per_wave = (int)state.range(0);
+    constexpr int     waves            = 50;
+    constexpr std::size_t per_thread   = 100;
+
+    for (auto _ : state) {
+        footprint_t footprint;
+        footprint.rss_baseline_ = bench::current_rss_bytes();
+        FootprintQueue q;
+
+        std::atomic<bool> stop{false};
+        std::atomic<std::size_t> consumed{0};
+        std::thread consumer([&]() {
+            Message message;
+            while (!stop.load(std::memory_order_acquire) || !q.empty()) {
+                if (q.try_dequeue(message)) {
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+
+        std::size_t sent = 0;
+        for (int wave = 0; wave < waves; ++wave) {
+            std::vector<std::thread> producers;
+            for (int i = 0; i < threads_per_wave; ++i) {
+                producers.emplace_back([&]() {
+                    for (std::size_t k = 0; k < per_thread; ++k) {
+                        q.enqueue(Message{ k, {} });
+                    }
+                });
+            }
+            for (auto& t : producers) t.join();
+            sent += threads_per_wave * per_thread;
+            footprint.sample(sent - consumed.load(std::memory_order_relaxed));
+        }
+        stop.store(true, std::memory_order_release);
+        consumer.join();
+
+        footprint.sample(0);
+        footprint.report(state);
+    }
+    state.SetLabel(std::to_string(threads_per_wave) + " threads x " + std::to_string(waves) + " waves");
+}
+
+BENCHMARK(BM_Footprint_ThreadChurn)
+    ->ArgName("threads")
+    ->Arg(4)->Arg(16)->Arg(64)
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
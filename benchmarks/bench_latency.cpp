@@ -3,48 +3,32 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <string>
 #include <cstdio>
-#include <iostream>
+#include <cstdint>
+#include <algorithm>
 
 #include <hdr/hdr_histogram.h>
 
 #include "daking/MPSC_queue.hpp" 
+#include "bench_utils.hpp"
 // #include <moodycamel/concurrentqueue.h>
 
-#if defined(__x86_64__) || defined(__i386__)
-
-#if defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-#include <intrin.h>
-#else
-#include <sched.h>
-#include <pthread.h>
-#include <x86intrin.h>
-#endif
-
-void pin_thread(int cpu_id) {
-#if defined(_WIN32) || defined(_WIN64)
-    HANDLE thread = GetCurrentThread();
-    DWORD_PTR mask = (static_cast<DWORD_PTR>(1) << cpu_id);
-    SetThreadAffinityMask(thread, mask);
-#else
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(cpu_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-#endif
-}
-
+using bench::pin_thread;
+using bench::tsc_clock;
 
-const double CYCLES_PER_NS    = 3.992; // My CPU
-const bool   OUTPUT_DATA_FILE = false;  // Get hdr file
+const bool OUTPUT_DATA_FILE = false;  // Get hdr file of the pure enqueue/dequeue latency
 // using TestQueue = moodycamel::ConcurrentQueue<int>;
 using TestQueue = daking::MPSC_queue<int>;
 
+// All histograms hold nanoseconds, from 1ns to 60s with 3 significant digits.
+constexpr int64_t HDR_MAX_NS = 60ll * 1000 * 1000 * 1000;
+
 static void BM_MPSC_PureEnqueueLatency(benchmark::State& state) {
     TestQueue q;
     hdr_histogram* hist;
-    hdr_init(1, 1000000, 3, &hist);
+    hdr_init(1, HDR_MAX_NS, 3, &hist);
+    tsc_clock::ticks_per_ns(); // calibrate outside the measured region
 
     const int num_producers = (int)state.range(0);
     std::atomic<bool> running{true};
@@ -74,10 +58,10 @@ static void BM_MPSC_PureEnqueueLatency(benchmark::State& state) {
 
     for (auto _ : state) {
         for (int i = 0; i < 10000; ++i) {
-            uint64_t start = __rdtsc();
+            uint64_t start = tsc_clock::now();
             q.enqueue(42);
-            uint64_t end = __rdtsc();
-            hdr_record_value(hist, end - start);
+            uint64_t end = tsc_clock::now();
+            hdr_record_value(hist, std::max<int64_t>(1, (int64_t)tsc_clock::to_ns(end - start)));
         }
     }
 
@@ -93,15 +77,16 @@ static void BM_MPSC_PureEnqueueLatency(benchmark::State& state) {
         }
     }
 
-    state.counters["P99_ns"] = hdr_value_at_percentile(hist, 99.0) / CYCLES_PER_NS;
-    state.counters["P99.9_ns"] = hdr_value_at_percentile(hist, 99.9) / CYCLES_PER_NS;
+    state.counters["P99_ns"] = (double)hdr_value_at_percentile(hist, 99.0);
+    state.counters["P99.9_ns"] = (double)hdr_value_at_percentile(hist, 99.9);
     hdr_close(hist);
 }
 
 static void BM_MPSC_PureDequeueLatency(benchmark::State& state) {
     TestQueue q;
     hdr_histogram* hist;
-    hdr_init(1, 1000000, 3, &hist);
+    hdr_init(1, HDR_MAX_NS, 3, &hist);
+    tsc_clock::ticks_per_ns();
 
     pin_thread(0);
     for (auto _ : state) {
@@ -111,10 +96,10 @@ static void BM_MPSC_PureDequeueLatency(benchmark::State& state) {
 
         for(int i=0; i<10000; ++i) {
             int val;
-            uint64_t start = __rdtsc();
+            uint64_t start = tsc_clock::now();
             if (q.try_dequeue(val)) {
-                uint64_t end = __rdtsc();
-                hdr_record_value(hist, end - start);
+                uint64_t end = tsc_clock::now();
+                hdr_record_value(hist, std::max<int64_t>(1, (int64_t)tsc_clock::to_ns(end - start)));
             }
         }
     }
@@ -127,17 +112,120 @@ static void BM_MPSC_PureDequeueLatency(benchmark::State& state) {
         }
     }
 
-    state.counters["P99_ns"] = hdr_value_at_percentile(hist, 99.0) / CYCLES_PER_NS;
-    state.counters["P99.9_ns"] = hdr_value_at_percentile(hist, 99.9) / CYCLES_PER_NS;
+    state.counters["P99_ns"] = (double)hdr_value_at_percentile(hist, 99.0);
+    state.counters["P99.9_ns"] = (double)hdr_value_at_percentile(hist, 99.9);
     hdr_close(hist);
 }
 
 BENCHMARK(BM_MPSC_PureEnqueueLatency)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->Unit(benchmark::kMicrosecond);
 BENCHMARK(BM_MPSC_PureDequeueLatency)->Unit(benchmark::kMicrosecond);
 
-BENCHMARK_MAIN();
+/*
+     End-to-end latency: a producer stamps a message at enqueue, the consumer measures it at dequeue.
+     Every producer offers a fixed rate. Message k is due at start + k * interval, and its latency is measured
+     from that due time, not from the moment enqueue actually ran. A producer that is stalled (by the queue,
+     a page fault or preemption) therefore charges the stall to every message it should have sent meanwhile,
+     which corrects the coordinated omission of a closed-loop measurement.
+     The uncorrected latency (measured from the real send time) is reported next to it for comparison.
+
+     Args: {producers, messages per second per producer}.
+     One .hgrm file (HdrHistogram percentile output) is written per argument pair.
+*/
+struct e2e_stamp_t {
+    uint64_t due_;  // when the message should have been sent
+    uint64_t sent_; // when it was sent
+};
+using StampQueue = daking::MPSC_queue<e2e_stamp_t>;
+
+static void BM_MPSC_EndToEndLatency(benchmark::State& state) {
+    const int     num_producers = (int)state.range(0);
+    const int64_t rate          = state.range(1);
+    const int64_t per_producer  = std::max<int64_t>(1000, rate / 20); // ~50ms of traffic per iteration
+    const uint64_t interval     = tsc_clock::from_ns(1e9 / (double)rate);
+
+    StampQueue q;
+    hdr_histogram* corrected;
+    hdr_histogram* uncorrected;
+    hdr_init(1, HDR_MAX_NS, 3, &corrected);
+    hdr_init(1, HDR_MAX_NS, 3, &uncorrected);
+
+    pin_thread(0);
+    for (auto _ : state) {
+        std::atomic<uint64_t> start_tick{0};
+        std::atomic<int>      ready{0};
+        std::vector<std::thread> producers;
+        producers.reserve(num_producers);
+        for (int i = 0; i < num_producers; ++i) {
+            producers.emplace_back([&, i]() {
+                pin_thread(i + 1);
+                StampQueue::prepare_thread(2);
+                ready.fetch_add(1, std::memory_order_release);
+                uint64_t start;
+                while ((start = start_tick.load(std::memory_order_acquire)) == 0);
+                for (int64_t k = 0; k < per_producer; ++k) {
+                    uint64_t due = start + (uint64_t)k * interval;
+                    uint64_t now;
+                    while ((now = tsc_clock::now()) < due) {
+                        bench::cpu_relax();
+                    }
+                    q.enqueue(e2e_stamp_t{ due, now });
+                }
+            });
+        }
+        while (ready.load(std::memory_order_acquire) != num_producers);
+        start_tick.store(tsc_clock::now() + tsc_clock::from_ns(1e6), std::memory_order_release);
+
+        e2e_stamp_t stamp;
+        for (int64_t popped = 0; popped < per_producer * num_producers;) {
+            if (q.try_dequeue(stamp)) {
+                uint64_t now = tsc_clock::now();
+                hdr_record_value(corrected, std::max<int64_t>(1, (int64_t)tsc_clock::to_ns(now - stamp.due_)));
+                hdr_record_value(uncorrected, std::max<int64_t>(1, (int64_t)tsc_clock::to_ns(now - stamp.sent_)));
+                ++popped;
+            }
+        }
+        for (auto& t : producers) t.join();
+    }
+
+    std::string file = "mpsc_e2e_latency_p" + std::to_string(num_producers) + "_r" + std::to_string(rate) + ".hgrm";
+    if (FILE* fp = fopen(file.c_str(), "w")) {
+        hdr_percentiles_print(corrected, fp, 5, 1.0, CLASSIC);
+        fclose(fp);
+    }
+
+    state.SetItemsProcessed(per_producer * num_producers * state.iterations());
+    state.SetLabel("P=" + std::to_string(num_producers) + ", " + std::to_string(rate) + " msg/s each");
+    state.counters["P50_ns"]     = (double)hdr_value_at_percentile(corrected, 50.0);
+    state.counters["P99_ns"]     = (double)hdr_value_at_percentile(corrected, 99.0);
+    state.counters["P99.9_ns"]   = (double)hdr_value_at_percentile(corrected, 99.9);
+    state.counters["P99.99_ns"]  = (double)hdr_value_at_percentile(corrected, 99.99);
+    state.counters["Max_ns"]     = (double)hdr_max(corrected);
+    state.counters["P99_raw_ns"] = (double)hdr_value_at_percentile(uncorrected, 99.0);
+    hdr_close(corrected);
+    hdr_close(uncorrected);
+}
+
+BENCHMARK(BM_MPSC_EndToEndLatency)
+    ->ArgsProduct({ { 1, 2, 4, 8 }, { 100000, 1000000 } })
+    ->Iterations(20)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    // Calibrate before any benchmark runs, and print it: every number below depends on it.
+    std::printf("tsc_clock: %.4f ticks/ns\n", tsc_clock::ticks_per_ns());
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
 
 /*
+Recorded before the clock calibration, with a fixed 3.992 cycles/ns.
+
 daking:
 Run on (16 X 3992 MHz CPU s)
 CPU Caches:
@@ -173,12 +261,3 @@ BM_MPSC_PureEnqueueLatency/8       0.132 us        0.121 us     10000000 P99.9_n
 BM_MPSC_PureEnqueueLatency/16      0.736 us        0.328 us      2836924 P99.9_ns=11.3985k P99_ns=300.601
 BM_MPSC_PureDequeueLatency          25.4 us         23.5 us        28047 P99.9_ns=20.0401 P99_ns=20.0401
 */
-
-#else
-
-int main(int argc, char** argv) {
-    std::cout << "This test is only for x86." << std::endl;
-    return 0;
-}
-
-#endif
\ No newline at end of file
@@ -3,12 +3,9 @@
 #include <vector>
 #include <atomic>
 #include <cassert>
-#include <iostream>
 
 #include "daking/MPSC_queue.hpp" 
 
-#if DAKING_HAS_CXX20_OR_ABOVE
-
 struct Message {
     int producer_id;
     uint64_t seq;
@@ -79,13 +76,4 @@ BENCHMARK(BM_MPSC_Test_Linearizable)
     ->UseRealTime()
     ->Unit(benchmark::kMillisecond);
 
-BENCHMARK_MAIN();
-
-#else
-
-int main(int argc, char** argv) {
-    std::cout << "This test is only for C++20 and above. Modify CMakeLists.txt \"set(CMAKE_CXX_STANDARD 17)\"->\"set(CMAKE_CXX_STANDARD 20)\"" << std::endl;
-    return 0;
-}
-
-#endif
\ No newline at end of file
+BENCHMARK_MAIN();
\ No newline at end of file
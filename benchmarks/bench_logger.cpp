@@ -0,0 +1,148 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+
+#include "daking/MPSC_queue.hpp"
+#include "daking/async_logger.hpp"
+#include "bench_utils.hpp"
+
+using bench::tsc_clock;
+
+/*
+     Producer-side cost of one log call, what the hot thread pays.
+     - BM_LogCall_AsyncLogger/{P}:     daking::async_logger, arguments and a tick count are captured,
+                                        formatting and the writev happen on the logger thread.
+     - BM_LogCall_FormatOnProducer/{P}: the examples/log_system.cpp way, snprintf + strftime into a 290-byte
+                                        LogEntry on the producer, which is then moved into an MPSC_queue.
+                                        A consumer thread drains it and writes one line at a time.
+     Every call is timed with the calibrated tsc_clock, reported as mean / P50 / P99 / P99.9 / max in ns.
+*/
+
+constexpr int CALLS_PER_PRODUCER = 100000;
+const char* const LOG_PATH = "mpsc_bench_logger.log";
+
+static void report(benchmark::State& state, std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double ns : samples) {
+        sum += ns;
+    }
+    std::size_t n = samples.size();
+    state.counters["mean_ns"]  = sum / (double)n;
+    state.counters["P50_ns"]   = samples[n / 2];
+    state.counters["P99_ns"]   = samples[std::min(n - 1, n * 99 / 100)];
+    state.counters["P99.9_ns"] = samples[std::min(n - 1, n * 999 / 1000)];
+    state.counters["Max_ns"]   = samples.back();
+}
+
+template <typename Log>
+static void run_producers(benchmark::State& state, Log&& log) {
+    const int num_producers = (int)state.range(0);
+    std::vector<std::vector<std::uint64_t>> ticks(num_producers, std::vector<std::uint64_t>(CALLS_PER_PRODUCER));
+    std::vector<double> samples;
+
+    for (auto _ : state) {
+        std::vector<std::thread> producers;
+        for (int p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&, p]() {
+                for (int i = 0; i < CALLS_PER_PRODUCER; ++i) {
+                    std::uint64_t begin = tsc_clock::now();
+                    log(p, i);
+                    ticks[p][i] = tsc_clock::now() - begin;
+                }
+            });
+        }
+        for (auto& t : producers) t.join();
+        for (auto& per_producer : ticks) {
+            for (std::uint64_t t : per_producer) {
+                samples.push_back(tsc_clock::to_ns(t));
+            }
+        }
+    }
+    report(state, samples);
+    state.SetItemsProcessed((int64_t)num_producers * CALLS_PER_PRODUCER * state.iterations());
+    state.SetLabel("P=" + std::to_string(num_producers));
+}
+
+static void BM_LogCall_AsyncLogger(benchmark::State& state) {
+    std::remove(LOG_PATH);
+    daking::async_logger logger(LOG_PATH);
+    run_producers(state, [&](int worker_id, int task) {
+        logger.info("Worker %d processed task #%d", worker_id, task);
+    });
+    logger.flush();
+}
+
+struct LogEntry {
+    int  level;
+    char timestamp[32];
+    char message[256];
+};
+
+static void BM_LogCall_FormatOnProducer(benchmark::State& state) {
+    std::remove(LOG_PATH);
+    daking::MPSC_queue<LogEntry> queue;
+    std::atomic<bool> stop{false};
+    std::thread consumer([&]() {
+        std::FILE* file = std::fopen(LOG_PATH, "w");
+        LogEntry entry;
+        while (!stop.load(std::memory_order_acquire) || !queue.empty()) {
+            if (queue.try_dequeue(entry)) {
+                std::fprintf(file, "[%s] [INFO] %s\n", entry.timestamp, entry.message);
+            }
+        }
+        std::fclose(file);
+    });
+
+    run_producers(state, [&](int worker_id, int task) {
+        LogEntry entry;
+        entry.level = 0;
+        std::snprintf(entry.message, sizeof(entry.message), "Worker %d processed task #%d", worker_id, task);
+        std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm local_tm{};
+#if defined(_WIN32) || defined(_WIN64)
+        localtime_s(&local_tm, &now);
+#else
+        localtime_r(&now, &local_tm);
+#endif
+        std::strftime(entry.timestamp, sizeof(entry.timestamp), "%Y-%m-%d %H:%M:%S", &local_tm);
+        queue.enqueue(std::move(entry));
+    });
+    stop.store(true, std::memory_order_release);
+    consumer.join();
+}
+
+BENCHMARK(BM_LogCall_AsyncLogger)
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_LogCall_FormatOnProducer)
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    std::printf("tsc_clock: %.4f ticks/ns\n", tsc_clock::ticks_per_ns());
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    std::remove(LOG_PATH);
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "daking/merge_consumer.hpp"
+
+/*
+     One consumer over N feeds, one producer per feed, timestamps increasing within each feed and interleaved across them:
+     - BM_Merge_Independent/{N}: the consumer drains the feeds round-robin with try_dequeue_bulk, no ordering at all.
+     - BM_Merge_Strict/{N}:      MPSC_merge_consumer without a window, the output is in global timestamp order.
+     - BM_Merge_Window/{N}:      MPSC_merge_consumer with a reorder window of 1024 ticks.
+     Reported: items/s, where an item is one event handed to the consumer.
+*/
+
+constexpr std::int64_t kEventsPerFeed = 200000;
+constexpr std::size_t  kBulk          = 256;
+
+struct Event {
+    std::uint64_t ts;
+    std::uint64_t payload[3];
+};
+
+struct EventTime {
+    std::uint64_t operator()(const Event& e) const noexcept { return e.ts; }
+};
+
+using Feed = daking::MPSC_queue<Event>;
+
+static std::vector<std::thread> start_feeds(std::vector<std::unique_ptr<Feed>>& feeds) {
+    std::vector<std::thread> producers;
+    const std::uint64_t n = feeds.size();
+    for (std::uint64_t f = 0; f < n; ++f) {
+        producers.emplace_back([&feeds, f, n]() {
+            for (std::int64_t i = 0; i < kEventsPerFeed; ++i) {
+                feeds[f]->enqueue(Event{ (std::uint64_t)i * n + f, {} });
+            }
+            feeds[f]->close();
+        });
+    }
+    return producers;
+}
+
+static std::vector<std::unique_ptr<Feed>> make_feeds(int n) {
+    std::vector<std::unique_ptr<Feed>> feeds;
+    for (int i = 0; i < n; ++i) {
+        feeds.push_back(std::make_unique<Feed>());
+    }
+    return feeds;
+}
+
+static void BM_Merge_Independent(benchmark::State& state) {
+    const int num_feeds = (int)state.range(0);
+    Event out[kBulk];
+
+    for (auto _ : state) {
+        auto feeds = make_feeds(num_feeds);
+        auto producers = start_feeds(feeds);
+
+        std::uint64_t sum = 0;
+        std::vector<bool> closed(num_feeds, false);
+        int open = num_feeds;
+        while (open != 0) {
+            for (int f = 0; f < num_feeds; ++f) {
+                if (closed[f]) continue;
+                std::size_t count = feeds[f]->try_dequeue_bulk(out, kBulk);
+                for (std::size_t i = 0; i < count; ++i) sum += out[i].ts;
+                if (count == 0 && feeds[f]->try_dequeue_status(out[0]) == daking::MPSC_dequeue_status::closed) {
+                    closed[f] = true;
+                    --open;
+                }
+                else if (count == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        for (auto& t : producers) t.join();
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(kEventsPerFeed * num_feeds * state.iterations());
+    state.SetLabel("N=" + std::to_string(num_feeds));
+}
+
+template <bool Windowed>
+static void BM_Merge(benchmark::State& state) {
+    const int num_feeds = (int)state.range(0);
+    Event out[kBulk];
+
+    for (auto _ : state) {
+        auto feeds = make_feeds(num_feeds);
+        std::vector<Feed*> raw;
+        for (auto& f : feeds) raw.push_back(f.get());
+        std::optional<std::uint64_t> window;
+        if (Windowed) window = 1024;
+        daking::MPSC_merge_consumer<Feed, EventTime> merger(raw, EventTime{}, window);
+        auto producers = start_feeds(feeds);
+
+        std::uint64_t sum = 0;
+        while (!merger.drained()) {
+            std::size_t count = merger.try_dequeue_bulk(out, kBulk);
+            for (std::size_t i = 0; i < count; ++i) sum += out[i].ts;
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+        }
+        for (auto& t : producers) t.join();
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(kEventsPerFeed * num_feeds * state.iterations());
+    state.SetLabel("N=" + std::to_string(num_feeds));
+}
+
+BENCHMARK(BM_Merge_Independent)
+    ->ArgName("N")
+    ->Arg(2)->Arg(4)->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Merge, false)
+    ->Name("BM_Merge_Strict")
+    ->ArgName("N")
+    ->Arg(2)->Arg(4)->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Merge, true)
+    ->Name("BM_Merge_Window")
+    ->ArgName("N")
+    ->Arg(2)->Arg(4)->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "daking/MPSC_queue.hpp"
+
+/*
+     One thread enqueues a batch of 64 elements and dequeues it, under each policy of MPSC_queue:
+     - BM_Policy_Default:          MPSC_queue<Payload>, no policy at all.
+     - BM_Policy_ExplicitDefaults: every category spelled out with its default, must match BM_Policy_Default,
+                                   the static_asserts below check that it also has the same layout.
+     - BM_Policy_CollectStats:     MPSC_collect_stats, one relaxed fetch_add per enqueue, relaxed stores per dequeue.
+     - BM_Policy_TrackSize:        MPSC_track_size, same counters, and size_apprx() read once per batch.
+     - BM_Policy_WaitPoll:         MPSC_wait_poll, enqueue skips the load of the parked flag.
+     - BM_Policy_PaddedNodes:      MPSC_padded_nodes, one node per cache line instead of two or three.
+     Reported: items/s (elements).
+     The default must compile to the same code as before policies existed, and as the explicit defaults:
+         objdump -d --no-show-raw-insn mpsc_bench_policies | c++filt > policies.s
+     then compare run_batches<...Payload<0>...> with run_batches<...Payload<1>...>, only symbol names differ.
+*/
+
+template <int Tag>
+struct Payload {
+    std::uint64_t value[2];
+};
+
+template <int Tag, typename... Policies>
+using Queue = daking::MPSC_queue<Payload<Tag>, 256, 64, std::allocator<Payload<Tag>>, Policies...>;
+
+using ExplicitDefaults = daking::MPSC_policies<daking::MPSC_own_pool, daking::MPSC_recycle_local, daking::MPSC_wait_notify,
+    daking::MPSC_no_stats, daking::MPSC_no_size, daking::MPSC_compact_nodes>;
+
+static_assert(sizeof(Queue<0>) == sizeof(Queue<1, ExplicitDefaults>), "Default policies add no member");
+static_assert(alignof(Queue<0>) == alignof(Queue<1, ExplicitDefaults>));
+static_assert(!Queue<1, ExplicitDefaults>::shares_pool && !Queue<1, ExplicitDefaults>::returns_to_sender &&
+    !Queue<1, ExplicitDefaults>::polls && !Queue<1, ExplicitDefaults>::collects_stats &&
+    !Queue<1, ExplicitDefaults>::tracks_size && !Queue<1, ExplicitDefaults>::pads_nodes);
+static_assert(sizeof(Queue<2, daking::MPSC_collect_stats>) > sizeof(Queue<0>), "The counters live in the queue");
+
+constexpr int kBatch = 64;
+
+template <typename Q>
+static void run_batches(benchmark::State& state) {
+    Q queue;
+    typename Q::value_type payload{};
+
+    for (auto _ : state) {
+        for (int i = 0; i < kBatch; ++i) {
+            payload.value[0] = (std::uint64_t)i;
+            queue.enqueue(payload);
+        }
+        if constexpr (Q::tracks_size) {
+            benchmark::DoNotOptimize(queue.size_apprx());
+        }
+        while (queue.try_dequeue(payload)) {
+            benchmark::DoNotOptimize(payload);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * kBatch);
+}
+
+static void BM_Policy_Default(benchmark::State& state) {
+    run_batches<Queue<0>>(state);
+}
+
+static void BM_Policy_ExplicitDefaults(benchmark::State& state) {
+    run_batches<Queue<1, ExplicitDefaults>>(state);
+}
+
+static void BM_Policy_CollectStats(benchmark::State& state) {
+    run_batches<Queue<2, daking::MPSC_collect_stats>>(state);
+}
+
+static void BM_Policy_TrackSize(benchmark::State& state) {
+    run_batches<Queue<3, daking::MPSC_track_size>>(state);
+}
+
+static void BM_Policy_WaitPoll(benchmark::State& state) {
+    run_batches<Queue<4, daking::MPSC_wait_poll>>(state);
+}
+
+static void BM_Policy_PaddedNodes(benchmark::State& state) {
+    run_batches<Queue<5, daking::MPSC_padded_nodes>>(state);
+}
+
+BENCHMARK(BM_Policy_Default);
+BENCHMARK(BM_Policy_ExplicitDefaults);
+BENCHMARK(BM_Policy_CollectStats);
+BENCHMARK(BM_Policy_TrackSize);
+BENCHMARK(BM_Policy_WaitPoll);
+BENCHMARK(BM_Policy_PaddedNodes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,151 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <random>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "daking/MPSC_queue.hpp"
+
+/*
+     Mixed-size byte messages, 16 B to 4 KiB (log-uniform, the same sequence for every queue):
+     - BM_Records_RecordQueue/{P}: MPSC_record_queue, each record takes its own length (rounded to 8) in a block.
+     - BM_Records_FixedQueue/{P}:  MPSC_queue of a 4 KiB slot + length, the only way to carry 4 KiB without truncation.
+       The producer writes in place through prepare/commit, the consumer moves the whole slot out.
+     Reported: items/s, payload bytes/s (only the meaningful bytes are counted), and pool_bytes,
+     the size of the global pool after the run.
+*/
+
+constexpr std::size_t kMinRecord    = 16;
+constexpr std::size_t kMaxRecord    = 4096;
+constexpr std::size_t kTotalRecords = 1u << 18; // The fixed queue needs 4 KiB per record in flight
+
+struct FixedRecord {
+    std::uint32_t size;
+    unsigned char bytes[kMaxRecord];
+};
+
+using RecordQueue = daking::MPSC_record_queue<>;
+using FixedQueue  = daking::MPSC_queue<FixedRecord>;
+
+static const std::vector<std::uint32_t>& record_sizes() {
+    static const std::vector<std::uint32_t> sizes = [] {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> exponent(std::log2((double)kMinRecord), std::log2((double)kMaxRecord));
+        std::vector<std::uint32_t> result(4096);
+        for (auto& size : result) {
+            size = (std::uint32_t)std::exp2(exponent(rng));
+        }
+        return result;
+    }();
+    return sizes;
+}
+
+static std::size_t payload_bytes(std::size_t records_per_producer, int num_producers) {
+    const auto& sizes = record_sizes();
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < records_per_producer; ++i) {
+        bytes += sizes[i % sizes.size()];
+    }
+    return bytes * (std::size_t)num_producers;
+}
+
+struct RecordTraits {
+    using queue_type = RecordQueue;
+
+    static void produce(queue_type& q, const unsigned char* source, std::uint32_t size) {
+        q.enqueue(source, size);
+    }
+
+    static bool consume(queue_type& q, std::size_t& bytes) {
+        return q.try_dequeue([&](daking::MPSC_record_view record) {
+            benchmark::DoNotOptimize(record.data()[record.size() - 1]);
+            bytes += record.size();
+        });
+    }
+};
+
+struct FixedTraits {
+    using queue_type = FixedQueue;
+
+    static void produce(queue_type& q, const unsigned char* source, std::uint32_t size) {
+        auto slot = q.prepare();
+        FixedRecord* record = static_cast<FixedRecord*>(slot.data());
+        record->size = size;
+        std::memcpy(record->bytes, source, size);
+        slot.commit();
+    }
+
+    static bool consume(queue_type& q, std::size_t& bytes) {
+        static thread_local FixedRecord record;
+        if (!q.try_dequeue(record)) {
+            return false;
+        }
+        benchmark::DoNotOptimize(record.bytes[record.size - 1]);
+        bytes += record.size;
+        return true;
+    }
+};
+
+template <typename Traits>
+static void BM_Records(benchmark::State& state) {
+    const int         num_producers        = (int)state.range(0);
+    const std::size_t records_per_producer = kTotalRecords / (std::size_t)num_producers;
+    const std::size_t total_records        = records_per_producer * (std::size_t)num_producers;
+    const auto&       sizes                = record_sizes();
+    std::vector<unsigned char> source(kMaxRecord, 0x5a);
+
+    for (auto _ : state) {
+        typename Traits::queue_type q;
+        std::atomic<bool> start{false};
+        std::vector<std::thread> producers;
+        for (int p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&]() {
+                while (!start.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (std::size_t i = 0; i < records_per_producer; ++i) {
+                    Traits::produce(q, source.data(), sizes[i % sizes.size()]);
+                }
+            });
+        }
+
+        start.store(true, std::memory_order_release);
+        std::size_t consumed = 0;
+        std::size_t bytes = 0;
+        while (consumed < total_records) {
+            if (Traits::consume(q, bytes)) {
+                ++consumed;
+            }
+        }
+        for (auto& t : producers) t.join();
+        benchmark::DoNotOptimize(bytes);
+        state.counters["pool_bytes"] = (double)Traits::queue_type::global_pool_stats().byte_count_;
+    }
+
+    state.SetItemsProcessed((int64_t)(total_records * state.iterations()));
+    state.SetBytesProcessed((int64_t)(payload_bytes(records_per_producer, num_producers) * state.iterations()));
+    state.SetLabel("P=" + std::to_string(num_producers));
+}
+
+BENCHMARK_TEMPLATE(BM_Records, RecordTraits)
+    ->Name("BM_Records_RecordQueue")
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Records, FixedTraits)
+    ->Name("BM_Records_FixedQueue")
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
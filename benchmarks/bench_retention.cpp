@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "daking/MPSC_queue.hpp"
+
+/*
+     A request handler that creates a queue, passes 64 messages through it and destroys it, so every request
+     destroys the last instance of the pool:
+     - BM_ShortLivedQueue_Release:  default retention, every request frees the pages and the next one allocates them again.
+     - BM_ShortLivedQueue_KeepAll:  keep_all(), the next request starts on warm pages and a warm thread-local cache.
+     - BM_ShortLivedQueue_KeepUpTo: keep_up_to(256 nodes), same, as long as a request fits in what is kept.
+     Reported: items/s (requests).
+*/
+
+template <int Tag>
+struct Message {
+    std::uint64_t payload[2];
+};
+
+constexpr int kMessagesPerRequest = 64;
+
+template <int Tag>
+static void run_short_lived_queues(benchmark::State& state, daking::MPSC_retention_policy policy) {
+    using Queue = daking::MPSC_queue<Message<Tag>, 64>;
+    Queue::set_global_retention_policy(policy);
+
+    for (auto _ : state) {
+        Queue queue;
+        for (int i = 0; i < kMessagesPerRequest; ++i) {
+            queue.enqueue(Message<Tag>{ { (std::uint64_t)i, 0 } });
+        }
+        Message<Tag> message;
+        while (queue.try_dequeue(message)) {
+            benchmark::DoNotOptimize(message);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    Queue::release_global_pool();
+}
+
+static void BM_ShortLivedQueue_Release(benchmark::State& state) {
+    run_short_lived_queues<0>(state, daking::MPSC_retention_policy::release());
+}
+
+static void BM_ShortLivedQueue_KeepAll(benchmark::State& state) {
+    run_short_lived_queues<1>(state, daking::MPSC_retention_policy::keep_all());
+}
+
+static void BM_ShortLivedQueue_KeepUpTo(benchmark::State& state) {
+    run_short_lived_queues<2>(state, daking::MPSC_retention_policy::keep_up_to(256));
+}
+
+BENCHMARK(BM_ShortLivedQueue_Release);
+BENCHMARK(BM_ShortLivedQueue_KeepAll);
+BENCHMARK(BM_ShortLivedQueue_KeepUpTo);
+
+BENCHMARK_MAIN();
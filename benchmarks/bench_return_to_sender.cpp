@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "daking/MPSC_queue.hpp"
+
+/*
+     K independent SPSC pipelines (one producer, one queue, one consumer each) over one global pool:
+     - BM_Pipelines_Default/{K}:        freed chunks go back to the global chunk stack, any producer may pop them.
+     - BM_Pipelines_ReturnToSender/{K}: MPSC_return_to_sender, freed chunks go straight back to their producer.
+     Reported: items/s over all pipelines.
+*/
+
+constexpr std::uint64_t kItemsPerPipeline = 2000000;
+
+struct Message {
+    std::uint64_t seq;
+    std::uint64_t payload[7];
+};
+
+using DefaultQueue        = daking::MPSC_queue<Message>;
+using ReturnToSenderQueue = daking::MPSC_queue<Message, 256, 64, std::allocator<Message>, daking::MPSC_return_to_sender>;
+
+template <typename Queue>
+static void BM_Pipelines(benchmark::State& state) {
+    const int num_pipelines = (int)state.range(0);
+
+    for (auto _ : state) {
+        std::vector<std::unique_ptr<Queue>> queues;
+        for (int i = 0; i < num_pipelines; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_pipelines; ++i) {
+            Queue* q = queues[i].get();
+            threads.emplace_back([q]() {
+                for (std::uint64_t seq = 0; seq < kItemsPerPipeline; ++seq) {
+                    q->enqueue(Message{ seq, {} });
+                }
+            });
+            threads.emplace_back([q]() {
+                Message message;
+                std::uint64_t sum = 0;
+                for (std::uint64_t got = 0; got < kItemsPerPipeline;) {
+                    if (q->try_dequeue(message)) {
+                        sum += message.seq;
+                        ++got;
+                    }
+                    else {
+                        std::this_thread::yield();
+                    }
+                }
+                benchmark::DoNotOptimize(sum);
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+
+    state.SetItemsProcessed((std::int64_t)kItemsPerPipeline * num_pipelines * state.iterations());
+    state.SetLabel("K=" + std::to_string(num_pipelines));
+}
+
+BENCHMARK_TEMPLATE(BM_Pipelines, DefaultQueue)
+    ->Name("BM_Pipelines_Default")
+    ->ArgName("K")
+    ->Arg(1)->Arg(2)->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Pipelines, ReturnToSenderQueue)
+    ->Name("BM_Pipelines_ReturnToSender")
+    ->ArgName("K")
+    ->Arg(1)->Arg(2)->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,194 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "daking/shm_queue.hpp"
+
+/*
+     P producer processes feeding one aggregator process (this one), 32-byte messages:
+     - BM_Shm_Queue/{P}:              MPSC_shm_queue, one enqueue per message, the aggregator drains with try_dequeue_bulk.
+     - BM_Shm_QueueBulk/{P}:          MPSC_shm_queue, try_enqueue_bulk of 16 messages.
+     - BM_Shm_UnixSocket/{P}:         one AF_UNIX datagram socket shared by the producers, one send per message.
+     - BM_Shm_UnixSocketBatched/{P}:  the same socket, 16 messages per datagram.
+     Producers are forked before the clock starts and wait on a flag in a shared page.
+     Reported: items/s, where an item is one message received by the aggregator.
+*/
+
+constexpr std::uint32_t kMessagesPerProducer = 200000;
+constexpr std::uint32_t kBatch               = 16;
+
+struct Message {
+    std::uint32_t producer;
+    std::uint32_t seq;
+    std::uint64_t payload[3];
+};
+
+using Queue = daking::MPSC_shm_queue<Message>;
+
+struct start_flag {
+    start_flag() {
+        void* page = ::mmap(nullptr, sizeof(std::atomic<int>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        flag = ::new (page) std::atomic<int>(0);
+    }
+    ~start_flag() { ::munmap(flag, sizeof(std::atomic<int>)); }
+
+    void wait() const {
+        while (flag->load(std::memory_order_acquire) == 0) ::sched_yield();
+    }
+    void go() { flag->store(1, std::memory_order_release); }
+
+    std::atomic<int>* flag;
+};
+
+template <typename Child>
+static std::vector<pid_t> fork_producers(int num_producers, start_flag& start, Child&& child) {
+    std::vector<pid_t> children;
+    for (int p = 0; p < num_producers; ++p) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            start.wait();
+            child((std::uint32_t)p);
+            ::_exit(0);
+        }
+        children.push_back(pid);
+    }
+    return children;
+}
+
+static void join_producers(const std::vector<pid_t>& children) {
+    for (pid_t pid : children) ::waitpid(pid, nullptr, 0);
+}
+
+template <bool Bulk>
+static void BM_Shm_Queue(benchmark::State& state) {
+    const int num_producers = (int)state.range(0);
+    const std::uint64_t total = (std::uint64_t)num_producers * kMessagesPerProducer;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Queue queue = Queue::create_anonymous(1 << 16);
+        start_flag start;
+        int fd = queue.fd();
+        auto children = fork_producers(num_producers, start, [fd](std::uint32_t p) {
+            Queue attached = Queue::attach_fd(fd);
+            auto producer = attached.make_producer();
+            if (Bulk) {
+                Message batch[kBatch];
+                for (std::uint32_t seq = 0; seq < kMessagesPerProducer;) {
+                    for (std::uint32_t i = 0; i < kBatch; ++i) batch[i] = Message{ p, seq + i, {} };
+                    std::size_t sent = producer.try_enqueue_bulk(batch, std::min(kBatch, kMessagesPerProducer - seq));
+                    seq += (std::uint32_t)sent;
+                    if (sent == 0) ::sched_yield();
+                }
+            }
+            else {
+                for (std::uint32_t seq = 0; seq < kMessagesPerProducer; ++seq) {
+                    producer.enqueue(Message{ p, seq, {} });
+                }
+            }
+        });
+        state.ResumeTiming();
+
+        start.go();
+        Message buf[64];
+        std::uint64_t sum = 0;
+        for (std::uint64_t received = 0; received < total;) {
+            std::size_t n = queue.try_dequeue_bulk(buf, 64);
+            for (std::size_t i = 0; i < n; ++i) sum += buf[i].seq;
+            received += n;
+            if (n == 0) ::sched_yield();
+        }
+        benchmark::DoNotOptimize(sum);
+
+        state.PauseTiming();
+        join_producers(children);
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed((std::int64_t)total * state.iterations());
+    state.SetLabel("P=" + std::to_string(num_producers));
+}
+
+template <std::uint32_t PerDatagram>
+static void BM_Shm_UnixSocket(benchmark::State& state) {
+    const int num_producers = (int)state.range(0);
+    const std::uint64_t total = (std::uint64_t)num_producers * kMessagesPerProducer;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) != 0) {
+            state.SkipWithError("socketpair failed");
+            return;
+        }
+        start_flag start;
+        auto children = fork_producers(num_producers, start, [&](std::uint32_t p) {
+            ::close(fds[0]);
+            Message batch[PerDatagram];
+            for (std::uint32_t seq = 0; seq < kMessagesPerProducer; seq += PerDatagram) {
+                std::uint32_t n = std::min(PerDatagram, kMessagesPerProducer - seq);
+                for (std::uint32_t i = 0; i < n; ++i) batch[i] = Message{ p, seq + i, {} };
+                ::send(fds[1], batch, n * sizeof(Message), 0);
+            }
+        });
+        ::close(fds[1]);
+        state.ResumeTiming();
+
+        start.go();
+        Message buf[PerDatagram];
+        std::uint64_t sum = 0;
+        for (std::uint64_t received = 0; received < total;) {
+            ssize_t bytes = ::recv(fds[0], buf, sizeof(buf), 0);
+            if (bytes <= 0) break;
+            std::size_t n = (std::size_t)bytes / sizeof(Message);
+            for (std::size_t i = 0; i < n; ++i) sum += buf[i].seq;
+            received += n;
+        }
+        benchmark::DoNotOptimize(sum);
+
+        state.PauseTiming();
+        join_producers(children);
+        ::close(fds[0]);
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed((std::int64_t)total * state.iterations());
+    state.SetLabel("P=" + std::to_string(num_producers));
+}
+
+BENCHMARK_TEMPLATE(BM_Shm_Queue, false)
+    ->Name("BM_Shm_Queue")
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Shm_Queue, true)
+    ->Name("BM_Shm_QueueBulk")
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Shm_UnixSocket, 1)
+    ->Name("BM_Shm_UnixSocket")
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Shm_UnixSocket, kBatch)
+    ->Name("BM_Shm_UnixSocketBatched")
+    ->ArgName("P")
+    ->Arg(1)->Arg(2)->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include "daking/MPSC_queue.hpp"
+#include "bench_utils.hpp"
+
+using bench::tsc_clock;
+
+/*
+     Cost of a short-lived producer thread: create, register to the pool on the first enqueue, exit.
+     BM_ThreadChurn/{threads}/{grow}: a wave of threads is started at once, each does one enqueue and exits.
+     With grow=1 another thread keeps growing the global pool meanwhile, holding the global mutex,
+     which registration used to serialise with.
+     Reported: first_enqueue_*_ns, from just before std::thread is constructed to the return of the first enqueue,
+     and wave_per_thread_ns, the wall time of the whole wave (until every thread is joined) per thread.
+*/
+
+using ChurnQueue = daking::MPSC_queue<std::uint64_t>;
+
+static void BM_ThreadChurn(benchmark::State& state) {
+    const int  num_threads = (int)state.range(0);
+    const bool grow        = state.range(1) != 0;
+
+    ChurnQueue q;
+    std::atomic<bool> stop{false};
+    std::thread consumer([&]() {
+        std::uint64_t value;
+        while (!stop.load(std::memory_order_acquire)) {
+            q.try_dequeue(value);
+        }
+        while (q.try_dequeue(value));
+    });
+    std::thread grower;
+    if (grow) {
+        grower = std::thread([&]() {
+            // Grow up to 4096 chunks (16 MiB), then keep taking the global mutex through the statistics.
+            for (ChurnQueue::size_type chunks = 16; !stop.load(std::memory_order_acquire); chunks += 16) {
+                if (chunks <= 4096) {
+                    ChurnQueue::reserve_global_chunk(chunks);
+                }
+                else {
+                    benchmark::DoNotOptimize(ChurnQueue::global_pool_stats());
+                }
+            }
+        });
+    }
+
+    std::vector<double> first_enqueue_ns;
+    std::vector<std::uint64_t> done(num_threads);
+    double wave_ns = 0;
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+        std::uint64_t wave_start = tsc_clock::now();
+        for (int i = 0; i < num_threads; ++i) {
+            std::uint64_t spawn = tsc_clock::now();
+            threads.emplace_back([&, i, spawn]() {
+                q.enqueue(spawn);
+                done[i] = tsc_clock::now() - spawn;
+            });
+        }
+        for (auto& t : threads) t.join();
+        wave_ns += tsc_clock::to_ns(tsc_clock::now() - wave_start);
+        for (int i = 0; i < num_threads; ++i) {
+            first_enqueue_ns.push_back(tsc_clock::to_ns(done[i]));
+        }
+    }
+    stop.store(true, std::memory_order_release);
+    consumer.join();
+    if (grower.joinable()) {
+        grower.join();
+    }
+
+    std::sort(first_enqueue_ns.begin(), first_enqueue_ns.end());
+    double sum = 0;
+    for (double ns : first_enqueue_ns) {
+        sum += ns;
+    }
+    std::size_t n = first_enqueue_ns.size();
+    state.counters["first_enqueue_mean_ns"] = sum / (double)n;
+    state.counters["first_enqueue_P50_ns"]  = first_enqueue_ns[n / 2];
+    state.counters["first_enqueue_P99_ns"]  = first_enqueue_ns[std::min(n - 1, n * 99 / 100)];
+    state.counters["first_enqueue_max_ns"]  = first_enqueue_ns.back();
+    state.counters["wave_per_thread_ns"]    = wave_ns / (double)(state.iterations() * num_threads);
+    state.SetItemsProcessed(state.iterations() * num_threads);
+    state.SetLabel(std::to_string(num_threads) + " threads" + (grow ? ", growing pool" : ""));
+}
+
+BENCHMARK(BM_ThreadChurn)
+    ->ArgNames({ "threads", "grow" })
+    ->ArgsProduct({ { 1, 2, 4, 8, 16, 32, 64 }, { 0, 1 } })
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+    std::printf("tsc_clock: %.4f ticks/ns\n", tsc_clock::ticks_per_ns());
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,316 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrentqueue.h"
+#include "daking/MPSC_queue.hpp"
+
+/*
+    Throughput matrix: payload size x bulk batch size x ThreadLocalCapacity x producer count,
+    for daking::MPSC_queue and three baselines:
+    - moodycamel::ConcurrentQueue (MPMC, with producer tokens),
+    - std::mutex + std::deque,
+    - a plain Vyukov intrusive MPSC queue, nodes from new/delete (what MPSC_queue is without its pool).
+
+    Every run reports payload_bytes, batch, tlc and producers as counters, so that the machine readable output
+    can be pivoted directly:
+        mpsc_bench_throughput_matrix --benchmark_out=matrix.json --benchmark_out_format=json
+        mpsc_bench_throughput_matrix --benchmark_out=matrix.csv  --benchmark_out_format=csv
+*/
+
+namespace {
+
+constexpr std::size_t kTotalBytes = 128u << 20; // bytes pushed per run
+constexpr std::size_t kMaxOps     = 4u << 20;   // cap for small payloads
+
+template <std::size_t Size>
+struct Payload {
+    static_assert(Size > sizeof(std::uint64_t));
+    std::uint64_t sequence;
+    unsigned char bytes[Size - sizeof(std::uint64_t)];
+};
+
+template <>
+struct Payload<sizeof(std::uint64_t)> {
+    std::uint64_t sequence;
+};
+
+template <std::size_t Size>
+constexpr std::size_t total_ops() {
+    return std::min(kMaxOps, kTotalBytes / Size);
+}
+
+class MutexDequeTag {};
+class VyukovTag {};
+
+template <typename T>
+class MutexDequeQueue {
+public:
+    void enqueue_bulk(const T* items, std::size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        deque_.insert(deque_.end(), items, items + count);
+    }
+
+    bool try_dequeue(T& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (deque_.empty()) {
+            return false;
+        }
+        value = std::move(deque_.front());
+        deque_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex    mutex_;
+    std::deque<T> deque_;
+};
+
+template <typename T>
+class VyukovQueue {
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        T                  value;
+    };
+
+public:
+    VyukovQueue() : head_(&stub_), tail_(&stub_) {}
+
+    ~VyukovQueue() {
+        T value;
+        while (try_dequeue(value));
+    }
+
+    void enqueue_bulk(const T* items, std::size_t count) {
+        // Link the batch privately, publish it with one exchange.
+        Node* first = new Node{ {}, items[0] };
+        Node* last = first;
+        for (std::size_t i = 1; i < count; ++i) {
+            Node* node = new Node{ {}, items[i] };
+            last->next.store(node, std::memory_order_relaxed);
+            last = node;
+        }
+        Node* prev = head_.exchange(last, std::memory_order_acq_rel);
+        prev->next.store(first, std::memory_order_release);
+    }
+
+    bool try_dequeue(T& value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) {
+                return false;
+            }
+            tail_ = tail = next;
+            next = tail->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            value = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return false; // a producer is between exchange and store
+        }
+        stub_.next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = head_.exchange(&stub_, std::memory_order_acq_rel);
+        prev->next.store(&stub_, std::memory_order_release);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            value = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    alignas(64) std::atomic<Node*> head_;
+    alignas(64) Node*              tail_;
+    Node                           stub_;
+};
+
+template <typename Kind, std::size_t Size, std::size_t TLC>
+struct QueueTraits;
+
+template <std::size_t Size, std::size_t TLC>
+struct QueueTraits<daking::MPSC_queue<int>, Size, TLC> {
+    using value_type = Payload<Size>;
+    using queue_type = daking::MPSC_queue<value_type, TLC>;
+    static constexpr const char* name = "daking_mpsc";
+
+    struct producer_type {
+        explicit producer_type(queue_type&) {}
+    };
+
+    static void enqueue_bulk(queue_type& queue, producer_type&, const value_type* items, std::size_t count) {
+        if (count == 1) {
+            queue.enqueue(items[0]);
+        }
+        else {
+            queue.enqueue_bulk(items, count);
+        }
+    }
+
+    static bool try_dequeue(queue_type& queue, value_type& value) {
+        return queue.try_dequeue(value);
+    }
+};
+
+template <std::size_t Size, std::size_t TLC>
+struct QueueTraits<moodycamel::ConcurrentQueue<int>, Size, TLC> {
+    using value_type = Payload<Size>;
+    using queue_type = moodycamel::ConcurrentQueue<value_type>;
+    static constexpr const char* name = "moody_mpmc";
+
+    struct producer_type {
+        explicit producer_type(queue_type& queue) : token(queue) {}
+        moodycamel::ProducerToken token;
+    };
+
+    static void enqueue_bulk(queue_type& queue, producer_type& producer, const value_type* items, std::size_t count) {
+        queue.enqueue_bulk(producer.token, items, count);
+    }
+
+    static bool try_dequeue(queue_type& queue, value_type& value) {
+        return queue.try_dequeue(value);
+    }
+};
+
+template <std::size_t Size, std::size_t TLC>
+struct QueueTraits<MutexDequeTag, Size, TLC> {
+    using value_type = Payload<Size>;
+    using queue_type = MutexDequeQueue<value_type>;
+    static constexpr const char* name = "mutex_deque";
+
+    struct producer_type {
+        explicit producer_type(queue_type&) {}
+    };
+
+    static void enqueue_bulk(queue_type& queue, producer_type&, const value_type* items, std::size_t count) {
+        queue.enqueue_bulk(items, count);
+    }
+
+    static bool try_dequeue(queue_type& queue, value_type& value) {
+        return queue.try_dequeue(value);
+    }
+};
+
+template <std::size_t Size, std::size_t TLC>
+struct QueueTraits<VyukovTag, Size, TLC> {
+    using value_type = Payload<Size>;
+    using queue_type = VyukovQueue<value_type>;
+    static constexpr const char* name = "vyukov_new_delete";
+
+    struct producer_type {
+        explicit producer_type(queue_type&) {}
+    };
+
+    static void enqueue_bulk(queue_type& queue, producer_type&, const value_type* items, std::size_t count) {
+        queue.enqueue_bulk(items, count);
+    }
+
+    static bool try_dequeue(queue_type& queue, value_type& value) {
+        return queue.try_dequeue(value);
+    }
+};
+
+template <typename Kind, std::size_t Size, std::size_t TLC>
+void run_matrix_cell(std::size_t producer_count, std::size_t batch) {
+    using Traits = QueueTraits<Kind, Size, TLC>;
+    using value_type = typename Traits::value_type;
+
+    typename Traits::queue_type queue;
+    std::atomic_bool start{ false };
+    const std::size_t items_per_producer = total_ops<Size>() / producer_count;
+    const std::size_t total_items = items_per_producer * producer_count;
+
+    std::vector<std::thread> producers;
+    producers.reserve(producer_count);
+    for (std::size_t producer = 0; producer < producer_count; ++producer) {
+        producers.emplace_back([&] {
+            typename Traits::producer_type handle(queue);
+            std::vector<value_type> items(batch);
+            for (std::size_t i = 0; i < batch; ++i) {
+                items[i].sequence = i;
+                if constexpr (Size > sizeof(std::uint64_t)) {
+                    std::memset(items[i].bytes, (int)i, sizeof(items[i].bytes));
+                }
+            }
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (std::size_t sent = 0; sent < items_per_producer; sent += batch) {
+                const std::size_t count = std::min(batch, items_per_producer - sent);
+                Traits::enqueue_bulk(queue, handle, items.data(), count);
+            }
+        });
+    }
+
+    start.store(true, std::memory_order_release);
+    value_type value;
+    std::size_t popped_count = 0;
+    while (popped_count < total_items) {
+        if (Traits::try_dequeue(queue, value)) {
+            benchmark::DoNotOptimize(value.sequence);
+            ++popped_count;
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+}
+
+template <typename Kind, std::size_t Size, std::size_t TLC>
+void bm_matrix(benchmark::State& state) {
+    const std::size_t producer_count = static_cast<std::size_t>(state.range(0));
+    const std::size_t batch = static_cast<std::size_t>(state.range(1));
+    const std::size_t total_items = total_ops<Size>() / producer_count * producer_count;
+    for (auto _ : state) {
+        run_matrix_cell<Kind, Size, TLC>(producer_count, batch);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(total_items * state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(total_items * Size * state.iterations()));
+    state.counters["payload_bytes"] = static_cast<double>(Size);
+    state.counters["batch"]         = static_cast<double>(batch);
+    state.counters["tlc"]           = static_cast<double>(TLC);
+    state.counters["producers"]     = static_cast<double>(producer_count);
+    state.SetLabel(QueueTraits<Kind, Size, TLC>::name);
+}
+
+void matrix_args(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({ "P", "batch" })
+         ->ArgsProduct({ { 1, 2, 4, 8 }, { 1, 16, 128, 1024 } })
+         ->UseRealTime()
+         ->Iterations(3);
+}
+
+using Daking = daking::MPSC_queue<int>;
+using Moody  = moodycamel::ConcurrentQueue<int>;
+
+} // namespace
+
+#define DAKING_MATRIX_PAYLOAD(Size)                                                   \
+    BENCHMARK_TEMPLATE(bm_matrix, Daking, Size, 64)->Apply(matrix_args);              \
+    BENCHMARK_TEMPLATE(bm_matrix, Daking, Size, 256)->Apply(matrix_args);             \
+    BENCHMARK_TEMPLATE(bm_matrix, Daking, Size, 1024)->Apply(matrix_args);            \
+    BENCHMARK_TEMPLATE(bm_matrix, Moody, Size, 0)->Apply(matrix_args);               \
+    BENCHMARK_TEMPLATE(bm_matrix, MutexDequeTag, Size, 0)->Apply(matrix_args);       \
+    BENCHMARK_TEMPLATE(bm_matrix, VyukovTag, Size, 0)->Apply(matrix_args)
+
+DAKING_MATRIX_PAYLOAD(8);
+DAKING_MATRIX_PAYLOAD(64);
+DAKING_MATRIX_PAYLOAD(256);
+DAKING_MATRIX_PAYLOAD(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,114 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "daking/MPSC_queue.hpp"
+
+/*
+     Producer and consumer tokens against the implicit thread_local lookup:
+     - BM_Batch<Implicit|Token>:           one thread enqueues 64 elements one by one and dequeues them,
+                                           so every element is one _allocate and one _deallocate.
+     - BM_Producers<Implicit|Token>/{n}:   n producers enqueue one by one, one consumer drains, all with or without tokens.
+     Reported: items/s (elements).
+     In an executable the lookup is a guard test and a load relative to the thread pointer, so the gap is small;
+     from a shared library every lookup may be a __tls_get_addr call.
+*/
+
+struct Payload {
+    std::uint64_t value[2];
+};
+
+using Queue = daking::MPSC_queue<Payload>;
+
+constexpr int     kBatch       = 64;
+constexpr int64_t kPerProducer = 1 << 20;
+
+struct Implicit {
+    struct producer {
+        explicit producer(Queue&) {}
+        void enqueue(Queue& queue, const Payload& payload) { queue.enqueue(payload); }
+    };
+    struct consumer {
+        explicit consumer(Queue&) {}
+        bool try_dequeue(Queue& queue, Payload& payload) { return queue.try_dequeue(payload); }
+    };
+};
+
+struct Token {
+    struct producer {
+        explicit producer(Queue& queue) : token_(queue) {}
+        void enqueue(Queue& queue, const Payload& payload) { queue.enqueue(token_, payload); }
+        Queue::producer_token token_;
+    };
+    struct consumer {
+        explicit consumer(Queue& queue) : token_(queue) {}
+        bool try_dequeue(Queue& queue, Payload& payload) { return queue.try_dequeue(token_, payload); }
+        Queue::consumer_token token_;
+    };
+};
+
+template <typename Access>
+static void BM_Batch(benchmark::State& state) {
+    Queue queue;
+    typename Access::producer producer(queue);
+    typename Access::consumer consumer(queue);
+    Payload payload{};
+
+    for (auto _ : state) {
+        for (int i = 0; i < kBatch; ++i) {
+            payload.value[0] = (std::uint64_t)i;
+            producer.enqueue(queue, payload);
+        }
+        while (consumer.try_dequeue(queue, payload)) {
+            benchmark::DoNotOptimize(payload);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * kBatch);
+}
+
+template <typename Access>
+static void BM_Producers(benchmark::State& state) {
+    const int num_producers = (int)state.range(0);
+
+    for (auto _ : state) {
+        Queue queue;
+        std::atomic<bool> start{ false };
+        std::vector<std::thread> producers;
+        for (int p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&]() {
+                typename Access::producer producer(queue);
+                while (!start.load(std::memory_order_acquire));
+                Payload payload{};
+                for (int64_t i = 0; i < kPerProducer; ++i) {
+                    payload.value[0] = (std::uint64_t)i;
+                    producer.enqueue(queue, payload);
+                }
+            });
+        }
+
+        typename Access::consumer consumer(queue);
+        start.store(true, std::memory_order_release);
+        Payload payload;
+        for (int64_t received = 0; received < kPerProducer * num_producers;) {
+            if (consumer.try_dequeue(queue, payload)) {
+                received++;
+            }
+        }
+        for (auto& t : producers) {
+            t.join();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * kPerProducer * num_producers);
+}
+
+BENCHMARK_TEMPLATE(BM_Batch, Implicit);
+BENCHMARK_TEMPLATE(BM_Batch, Token);
+BENCHMARK_TEMPLATE(BM_Producers, Implicit)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Producers, Token)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
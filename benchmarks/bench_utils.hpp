@@ -0,0 +1,153 @@
+#ifndef DAKING_BENCH_UTILS_HPP
+#define DAKING_BENCH_UTILS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <intrin.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <cstdio>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <time.h>
+#endif
+
+namespace bench {
+
+    inline void pin_thread(int cpu_id) {
+        // Best effort, a no-op where affinity is not available.
+        unsigned cpu_count = std::thread::hardware_concurrency();
+        if (cpu_count != 0) {
+            cpu_id %= (int)cpu_count;
+        }
+#if defined(_WIN32) || defined(_WIN64)
+        HANDLE thread = GetCurrentThread();
+        DWORD_PTR mask = (static_cast<DWORD_PTR>(1) << cpu_id);
+        SetThreadAffinityMask(thread, mask);
+#elif defined(__linux__)
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu_id, &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+#else
+        (void)cpu_id;
+#endif
+    }
+
+    /*
+         Cheap timestamps for latency measurement.
+         - x86:     rdtsc, an invariant TSC is assumed (every CPU of the last decade has one).
+         - AArch64: the virtual counter cntvct_el0.
+         - others:  clock_gettime(CLOCK_MONOTONIC) / steady_clock, already in ns.
+         The tick rate is calibrated once against steady_clock, replacing a hard-coded CPU frequency.
+    */
+    struct tsc_clock {
+        static inline std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+            return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+            std::uint64_t ticks;
+            asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+            return ticks;
+#elif !defined(_WIN32) && !defined(_WIN64)
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (std::uint64_t)ts.tv_sec * 1000000000ull + (std::uint64_t)ts.tv_nsec;
+#else
+            return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        static double ticks_per_ns() {
+            static const double value = calibrate();
+            return value;
+        }
+
+        static double to_ns(std::uint64_t ticks) {
+            return (double)ticks / ticks_per_ns();
+        }
+
+        static std::uint64_t from_ns(double ns) {
+            return (std::uint64_t)(ns * ticks_per_ns());
+        }
+
+    private:
+        static double calibrate() {
+            // Take the median of a few short windows, so that one preemption does not skew the result.
+            constexpr int rounds = 5;
+            double samples[rounds];
+            for (int r = 0; r < rounds; r++) {
+                auto wall_begin = std::chrono::steady_clock::now();
+                std::uint64_t tick_begin = now();
+                while (std::chrono::steady_clock::now() - wall_begin < std::chrono::milliseconds(20));
+                auto wall_end = std::chrono::steady_clock::now();
+                std::uint64_t tick_end = now();
+                double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(wall_end - wall_begin).count();
+                samples[r] = (double)(tick_end - tick_begin) / ns;
+            }
+            for (int i = 1; i < rounds; i++) {
+                for (int j = i; j > 0 && samples[j - 1] > samples[j]; j--) {
+                    double t = samples[j - 1];
+                    samples[j - 1] = samples[j];
+                    samples[j] = t;
+                }
+            }
+            return samples[rounds / 2];
+        }
+    };
+
+    // Resident set size of this process in bytes, 0 where unknown.
+    inline std::size_t current_rss_bytes() {
+#if defined(_WIN32) || defined(_WIN64)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return (std::size_t)counters.WorkingSetSize;
+        }
+        return 0;
+#elif defined(__linux__)
+        std::size_t pages = 0, resident = 0;
+        if (FILE* fp = std::fopen("/proc/self/statm", "r")) {
+            if (std::fscanf(fp, "%zu %zu", &pages, &resident) != 2) {
+                resident = 0;
+            }
+            std::fclose(fp);
+        }
+        return resident * (std::size_t)sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) {
+            return (std::size_t)info.resident_size;
+        }
+        return 0;
+#else
+        return 0;
+#endif
+    }
+
+    inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+        asm volatile("yield");
+#endif
+    }
+}
+
+#endif // !DAKING_BENCH_UTILS_HPP
@@ -0,0 +1,183 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include <hdr/hdr_histogram.h>
+
+#include "daking/MPSC_queue.hpp"
+#include "bench_utils.hpp"
+
+using bench::pin_thread;
+using bench::tsc_clock;
+
+/*
+     What the blocking API costs:
+     - BM_PingPong_RTT<Spin|Block>: request/response over two MPSC_queues, the echo side and the requester
+       either spin on try_dequeue or park in dequeue (a futex on Linux).
+     - BM_WakeupLatency/{idle_us}: a consumer parked in dequeue, a producer that stays idle for idle_us,
+       then enqueues a timestamp. Measured from just before enqueue to the moment dequeue returns,
+       so it is the futex wake + the OS wake-up + the re-check of next_.
+     All numbers are HdrHistogram percentiles in ns.
+*/
+
+const bool OUTPUT_DATA_FILE = false; // Get hdr files
+
+constexpr int64_t  HDR_MAX_NS    = 60ll * 1000 * 1000 * 1000;
+constexpr uint64_t STOP          = ~uint64_t(0);
+constexpr int      ROUND_TRIPS   = 10000;
+constexpr int      WAKEUPS       = 200;
+
+using StampQueue = daking::MPSC_queue<uint64_t>;
+
+struct Spin {
+    static constexpr const char* name = "spin";
+    static uint64_t pop(StampQueue& q) {
+        uint64_t value;
+        while (!q.try_dequeue(value)) {
+            bench::cpu_relax();
+        }
+        return value;
+    }
+};
+
+struct Block {
+    static constexpr const char* name = "block";
+    static uint64_t pop(StampQueue& q) {
+        uint64_t value;
+        q.dequeue(value);
+        return value;
+    }
+};
+
+static void report(benchmark::State& state, hdr_histogram* hist, const std::string& file) {
+    if (OUTPUT_DATA_FILE) {
+        if (FILE* fp = fopen(file.c_str(), "w")) {
+            hdr_percentiles_print(hist, fp, 5, 1.0, CLASSIC);
+            fclose(fp);
+        }
+    }
+    state.counters["P50_ns"]    = (double)hdr_value_at_percentile(hist, 50.0);
+    state.counters["P99_ns"]    = (double)hdr_value_at_percentile(hist, 99.0);
+    state.counters["P99.9_ns"]  = (double)hdr_value_at_percentile(hist, 99.9);
+    state.counters["P99.99_ns"] = (double)hdr_value_at_percentile(hist, 99.99);
+    state.counters["Max_ns"]    = (double)hdr_max(hist);
+}
+
+template <typename Wait>
+static void BM_PingPong_RTT(benchmark::State& state) {
+    StampQueue ping;
+    StampQueue pong;
+    hdr_histogram* hist;
+    hdr_init(1, HDR_MAX_NS, 3, &hist);
+
+    std::thread echo([&]() {
+        pin_thread(1);
+        StampQueue::prepare_thread();
+        while (true) {
+            uint64_t value = Wait::pop(ping);
+            pong.enqueue(value);
+            if (value == STOP) {
+                return;
+            }
+        }
+    });
+
+    pin_thread(0);
+    StampQueue::prepare_thread();
+    for (auto _ : state) {
+        for (int i = 0; i < ROUND_TRIPS; ++i) {
+            uint64_t start = tsc_clock::now();
+            ping.enqueue(start);
+            uint64_t back = Wait::pop(pong);
+            uint64_t end = tsc_clock::now();
+            hdr_record_value(hist, std::max<int64_t>(1, (int64_t)tsc_clock::to_ns(end - back)));
+        }
+    }
+    ping.enqueue(STOP);
+    Wait::pop(pong);
+    echo.join();
+
+    state.SetItemsProcessed((int64_t)ROUND_TRIPS * state.iterations());
+    state.SetLabel(Wait::name);
+    report(state, hist, std::string("mpsc_ping_pong_") + Wait::name + ".hgrm");
+    hdr_close(hist);
+}
+
+BENCHMARK_TEMPLATE(BM_PingPong_RTT, Spin)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_PingPong_RTT, Block)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_WakeupLatency(benchmark::State& state) {
+    const uint64_t idle = tsc_clock::from_ns(1000.0 * (double)state.range(0));
+    StampQueue q;
+    hdr_histogram* hist;
+    hdr_init(1, HDR_MAX_NS, 3, &hist);
+    std::atomic<int> consumed{0};
+
+    std::thread consumer([&]() {
+        pin_thread(1);
+        StampQueue::prepare_thread();
+        uint64_t stamp;
+        while (true) {
+            q.dequeue(stamp);
+            uint64_t end = tsc_clock::now();
+            if (stamp == STOP) {
+                return;
+            }
+            hdr_record_value(hist, std::max<int64_t>(1, (int64_t)tsc_clock::to_ns(end - stamp)));
+            consumed.fetch_add(1, std::memory_order_release);
+        }
+    });
+
+    pin_thread(0);
+    StampQueue::prepare_thread();
+    int sent = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < WAKEUPS; ++i) {
+            // The consumer is back in dequeue (or about to be) before the idle period starts.
+            while (consumed.load(std::memory_order_acquire) != sent) {
+                bench::cpu_relax();
+            }
+            uint64_t deadline = tsc_clock::now() + idle;
+            if (idle > tsc_clock::from_ns(200000.0)) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds((int64_t)tsc_clock::to_ns(idle) - 100000));
+            }
+            while (tsc_clock::now() < deadline) {
+                bench::cpu_relax();
+            }
+            q.enqueue(tsc_clock::now());
+            sent++;
+        }
+    }
+    q.enqueue(STOP);
+    consumer.join();
+
+    state.SetItemsProcessed((int64_t)WAKEUPS * state.iterations());
+    state.SetLabel("idle " + std::to_string(state.range(0)) + "us");
+    report(state, hist, "mpsc_wakeup_idle" + std::to_string(state.range(0)) + "us.hgrm");
+    hdr_close(hist);
+}
+
+BENCHMARK(BM_WakeupLatency)
+    ->ArgName("idle_us")
+    ->Arg(0)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000)
+    ->Iterations(5)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    std::printf("tsc_clock: %.4f ticks/ns\n", tsc_clock::ticks_per_ns());
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
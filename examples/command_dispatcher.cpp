@@ -9,7 +9,7 @@
 
 using namespace daking;
 
-enum class CommandType { MOVE_ENTITY, ROTATE_ENTITY, LOAD_ASSET, QUIT };
+enum class CommandType { MOVE_ENTITY, ROTATE_ENTITY, LOAD_ASSET };
 
 struct Command {
     CommandType type;
@@ -30,15 +30,15 @@ struct Command {
 };
 
 MPSC_queue<Command> g_command_queue;
-std::atomic<bool> g_running{ true };
 
 void command_dispatcher_thread() {
     Command cmd;
 
     std::cout << "Dispatcher: Command thread started." << std::endl;
 
-    while (g_running.load(std::memory_order_acquire)) {
-        if (g_command_queue.try_dequeue(cmd)) {
+    while (true) {
+        MPSC_dequeue_status status = g_command_queue.try_dequeue_status(cmd);
+        if (status == MPSC_dequeue_status::dequeued) {
             switch (cmd.type) {
             case CommandType::MOVE_ENTITY:
                 break;
@@ -47,18 +47,16 @@ void command_dispatcher_thread() {
             case CommandType::LOAD_ASSET:
                 std::cout << "  > Dispatcher: LOAD_ASSET " << cmd.entity_id << "\n";
                 break;
-            case CommandType::QUIT:
-                g_running.store(false, std::memory_order_release);
-                break;
             }
         }
-        else {
+        else if (status == MPSC_dequeue_status::empty) {
             std::this_thread::yield();
         }
+        else {
+            break; // Closed and drained: nothing is left behind.
+        }
     }
 
-    while (g_command_queue.try_dequeue(cmd)) { }
-
     std::cout << "Dispatcher: Command thread shut down." << std::endl;
 }
 
@@ -120,7 +118,7 @@ int main() {
         p.join();
     }
 
-    g_command_queue.enqueue(Command(CommandType::QUIT, 0));
+    g_command_queue.close();
 
     dispatcher_thread.join();
 
@@ -51,6 +51,10 @@ struct LogEntry {
         std::strncpy(message, msg.c_str(), sizeof(message) - 1);
         message[sizeof(message) - 1] = '\0';
 
+        stamp_now();
+    }
+
+    void stamp_now() {
         auto now = std::chrono::system_clock::now();
 
         auto ms_part = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -78,17 +82,15 @@ struct LogEntry {
 
 MPSC_queue<LogEntry> g_log_queue;
 
-std::atomic<bool> g_running{ true };
-
 void log_consumer_thread(const std::string& filename) {
     std::ofstream log_file(filename, std::ios::out | std::ios::trunc);
     LogEntry entry;
 
     std::cout << "Consumer: Log file opened at " << filename << std::endl;
 
-    while (g_running.load(std::memory_order_acquire) || !g_log_queue.empty()) {
-
-        if (g_log_queue.try_dequeue(entry)) {
+    while (true) {
+        MPSC_dequeue_status status = g_log_queue.try_dequeue_status(entry);
+        if (status == MPSC_dequeue_status::dequeued) {
 
             const char* level_str = (entry.level == LogLevel::INFO) ? "INFO" :
                 (entry.level == LogLevel::WARN) ? "WARN" : "ERROR";
@@ -97,9 +99,12 @@ void log_consumer_thread(const std::string& filename) {
                 << "[" << level_str << "] "
                 << entry.message << "\n";
         }
-        else {
+        else if (status == MPSC_dequeue_status::empty) {
             std::this_thread::yield();
         }
+        else {
+            break; // Closed, and every entry before close() is written.
+        }
     }
 
     log_file.flush();
@@ -109,20 +114,25 @@ void log_consumer_thread(const std::string& filename) {
 
 void worker_producer_task(int worker_id, int messages_to_send) {
     for (int i = 1; i <= messages_to_send; ++i) {
-        std::stringstream ss;
-        ss << "Worker " << worker_id << " processed task #" << i;
-
-        LogLevel current_level = LogLevel::INFO;
+        // Build the entry directly in the queue node: the ~290 bytes are written once, never moved.
+        auto slot = g_log_queue.prepare();
+        if (!slot) {
+            break; // The queue is closed.
+        }
+        LogEntry* entry = new (slot.data()) LogEntry();
 
+        const char* suffix = "";
         if (i % 10000 == 0) {
-            current_level = LogLevel::ERROR;
-            ss << " !!! FATAL ERROR DETECTED !!!";
+            entry->level = LogLevel::ERROR;
+            suffix = " !!! FATAL ERROR DETECTED !!!";
         }
         else if (i % 1000 == 0) {
-            current_level = LogLevel::WARN;
+            entry->level = LogLevel::WARN;
         }
 
-        g_log_queue.enqueue(LogEntry(current_level, ss.str()));
+        std::snprintf(entry->message, sizeof(entry->message), "Worker %d processed task #%d%s", worker_id, i, suffix);
+        entry->stamp_now();
+        slot.commit();
     }
     std::cout << "Producer " << worker_id << " finished sending " << messages_to_send << " messages." << std::endl;
 }
@@ -146,7 +156,7 @@ int main() {
         p.join();
     }
 
-    g_running.store(false, std::memory_order_release);
+    g_log_queue.close();
 
     consumer_thread.join();
 
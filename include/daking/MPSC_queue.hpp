@@ -65,6 +65,14 @@ SOFTWARE.
     #endif
 #endif // !DAKING_HAS_CXX20_OR_ABOVE
 
+#ifndef DAKING_HAS_FUTEX
+#   if defined(__linux__)
+#       define DAKING_HAS_FUTEX 1
+#   else
+#       define DAKING_HAS_FUTEX 0
+#   endif
+#endif // !DAKING_HAS_FUTEX
+
 #ifndef DAKING_ALWAYS_INLINE
 #   if defined(_MSC_VER)
 #       define DAKING_ALWAYS_INLINE [[msvc::forceinline]]
@@ -90,15 +98,32 @@ SOFTWARE.
 #endif // !DAKING_UNLIKELY
 
 #include <memory>
+#include <new>
+#include <algorithm>
 #include <type_traits>
 #include <iterator>
 #include <utility>
 #include <atomic>
 #include <mutex>
 #include <thread>
-#include <unordered_map>
 #include <vector>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+
+#if DAKING_HAS_CXX20_OR_ABOVE
+#include <span>
+#endif
+
+#if DAKING_HAS_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <climits>
+#include <unistd.h>
+#elif !(DAKING_HAS_CXX20_OR_ABOVE)
+#include <condition_variable>
+#endif
 
 namespace daking {
 
@@ -147,10 +172,205 @@ namespace daking {
                nullptr
     */
 
+    /*
+         Growth policy of the global pool.
+         When the global chunk stack runs dry, the pool asks its growth policy how many nodes the next page should hold.
+         The answer is always rounded up to a whole number of chunks, and is clamped by the node budget (if any).
+
+         doubling(): next page = max(ThreadLocalCapacity, node_count), the default, pages grow 1x, 1x, 2x, 4x, ...
+         linear(n):  next page = n chunks, memory grows in fixed steps.
+         capped(n):  like doubling, but a single page never exceeds n chunks.
+         custom(fn): next page = fn(node_count, ThreadLocalCapacity) nodes.
+    */
+    struct MPSC_growth_policy {
+        using custom_t = std::size_t(*)(std::size_t node_count, std::size_t chunk_size);
+
+        enum class kind_t { doubling, linear, capped, custom };
+
+        static constexpr MPSC_growth_policy doubling() noexcept {
+            return MPSC_growth_policy{ kind_t::doubling, 0, nullptr };
+        }
+
+        static constexpr MPSC_growth_policy linear(std::size_t step_chunk_count) noexcept {
+            return MPSC_growth_policy{ kind_t::linear, step_chunk_count, nullptr };
+        }
+
+        static constexpr MPSC_growth_policy capped(std::size_t max_step_chunk_count) noexcept {
+            return MPSC_growth_policy{ kind_t::capped, max_step_chunk_count, nullptr };
+        }
+
+        static constexpr MPSC_growth_policy custom(custom_t fn) noexcept {
+            return MPSC_growth_policy{ kind_t::custom, 0, fn };
+        }
+
+        // Number of nodes for the next page, always a positive multiple of chunk_size.
+        constexpr std::size_t next(std::size_t node_count, std::size_t chunk_size) const noexcept {
+            std::size_t count = 0;
+            switch (kind_) {
+            case kind_t::linear:
+                count = step_chunk_count_ * chunk_size;
+                break;
+            case kind_t::capped:
+                count = std::min(std::max(chunk_size, node_count), step_chunk_count_ * chunk_size);
+                break;
+            case kind_t::custom:
+                count = fn_ ? fn_(node_count, chunk_size) : 0;
+                break;
+            default:
+                count = std::max(chunk_size, node_count);
+                break;
+            }
+            return count < chunk_size ? chunk_size : (count + chunk_size - 1) / chunk_size * chunk_size;
+        }
+
+        kind_t      kind_;
+        std::size_t step_chunk_count_;
+        custom_t    fn_;
+    };
+
+    /*
+         What a global pool keeps once its last instance is destroyed:
+         - release() (default): every page is freed, the next instance grows the pool again.
+         - keep_all(): pages, chunks and thread-local caches stay as they are, the next instance starts warm.
+         - keep_up_to(n): pages are kept while they hold at most n nodes in total, the others are freed.
+         - release_after_idle(t): everything is kept, trim_global_pool() frees it once no instance was alive for t.
+    */
+    struct MPSC_retention_policy {
+        enum class kind_t { release, keep_all, keep_up_to, release_after_idle };
+
+        static constexpr MPSC_retention_policy release() noexcept {
+            return MPSC_retention_policy{ kind_t::release, 0, std::chrono::milliseconds(0) };
+        }
+
+        static constexpr MPSC_retention_policy keep_all() noexcept {
+            return MPSC_retention_policy{ kind_t::keep_all, 0, std::chrono::milliseconds(0) };
+        }
+
+        static constexpr MPSC_retention_policy keep_up_to(std::size_t node_count) noexcept {
+            return MPSC_retention_policy{ kind_t::keep_up_to, node_count, std::chrono::milliseconds(0) };
+        }
+
+        static constexpr MPSC_retention_policy release_after_idle(std::chrono::milliseconds idle_time) noexcept {
+            return MPSC_retention_policy{ kind_t::release_after_idle, 0, idle_time };
+        }
+
+        kind_t                    kind_;
+        std::size_t               node_count_;
+        std::chrono::milliseconds idle_time_;
+    };
+
+    // Called by enqueue/emplace when the node budget is exhausted and no chunk is available.
+    // Return true to retry the allocation, false to give up (enqueue will throw std::bad_alloc).
+    // Without a handler, enqueue blocks (yields) until a consumer pushes a chunk back to the global pool.
+    // try_enqueue/try_emplace never call the handler, they simply return false.
+    using MPSC_overflow_handler = bool(*)(std::size_t global_node_count);
+
+    // A snapshot of one global pool, taken under the global mutex.
+    // Live threads' caches are never read (they change without the mutex), so nodes cached by live threads
+    // and nodes inside queues (values and dummy nodes) are only known together as node_count_ - free - parked.
+    struct MPSC_pool_stats {
+        std::size_t node_count_        = 0; // nodes owned by the pool, all of them live in pages
+        std::size_t page_count_        = 0;
+        std::size_t byte_count_        = 0; // node_count_ * node size, without the page headers
+        std::size_t free_node_count_   = 0; // nodes in the global chunk stack, approximate under contention
+        std::size_t parked_node_count_ = 0; // nodes cached by thread-local pools of exited threads
+        std::size_t thread_count_      = 0; // live threads registered to the pool
+
+        std::size_t in_use_node_count() const noexcept {
+            // cached by live threads or inside queues
+            std::size_t idle = free_node_count_ + parked_node_count_;
+            return node_count_ > idle ? node_count_ - idle : 0;
+        }
+    };
+
     namespace detail {
-        template <typename Queue>
-        struct MPSC_node {
-            using value_type = typename Queue::value_type;
+        // The smallest page size of mainstream platforms, touching at this stride faults in every page.
+        inline constexpr std::size_t os_page_size = 4096;
+
+        // Alignment of the shared pool state. A type declared with it fills whole lines, so a neighbour
+        // placed by the linker can never land on the same line. Not std::hardware_destructive_interference_size,
+        // whose value GCC warns may change between compiler versions, and the pool is shared across TUs.
+        inline constexpr std::size_t cache_line_size = 64;
+
+        /*
+             The word a parked consumer, or a producer waiting for the node budget, sleeps on. Every wake bumps it:
+                 std::uint32_t seen = word.load();
+                 ... announce, re-check ...
+                 word.wait(seen);      // Returns at once if a wake came after load(), may return spuriously.
+             Linux: a raw futex on the word, with any standard. Elsewhere: atomic::wait with C++20, a condition variable before.
+        */
+        class MPSC_wait_word {
+        public:
+            DAKING_ALWAYS_INLINE std::uint32_t load() const noexcept {
+                return seq_.load(std::memory_order_acquire);
+            }
+
+            void wait(std::uint32_t seen) noexcept {
+#if DAKING_HAS_FUTEX
+                static_assert(sizeof(seq_) == sizeof(std::uint32_t) && std::atomic<std::uint32_t>::is_always_lock_free);
+                ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&seq_), FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0);
+#elif DAKING_HAS_CXX20_OR_ABOVE
+                seq_.wait(seen, std::memory_order_acquire);
+#else
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [&]() { return seq_.load(std::memory_order_relaxed) != seen; });
+#endif
+            }
+
+            void wake_one() noexcept {
+#if DAKING_HAS_FUTEX
+                seq_.fetch_add(1, std::memory_order_release);
+                ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&seq_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#elif DAKING_HAS_CXX20_OR_ABOVE
+                seq_.fetch_add(1, std::memory_order_release);
+                seq_.notify_one();
+#else
+                {
+                    std::lock_guard<std::mutex> guard(mutex_);
+                    seq_.fetch_add(1, std::memory_order_release);
+                }
+                cond_.notify_one();
+#endif
+            }
+
+            void wake_all() noexcept {
+#if DAKING_HAS_FUTEX
+                seq_.fetch_add(1, std::memory_order_release);
+                ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&seq_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#elif DAKING_HAS_CXX20_OR_ABOVE
+                seq_.fetch_add(1, std::memory_order_release);
+                seq_.notify_all();
+#else
+                {
+                    std::lock_guard<std::mutex> guard(mutex_);
+                    seq_.fetch_add(1, std::memory_order_release);
+                }
+                cond_.notify_all();
+#endif
+            }
+
+        private:
+            std::atomic<std::uint32_t> seq_{ 0 };
+#if !DAKING_HAS_FUTEX && !(DAKING_HAS_CXX20_OR_ABOVE)
+            std::mutex                 mutex_;
+            std::condition_variable    cond_;
+#endif
+        };
+
+        template <typename Pool, bool = Pool::return_to_sender>
+        struct MPSC_node_owner {};
+
+        template <typename Pool>
+        struct MPSC_node_owner<Pool, true> {
+            typename Pool::thread_local_t* owner_; /* Thread-local pool that allocated the node, stamped by _allocate */
+        };
+
+        // Pool::node_align is 1 unless MPSC_padded_nodes asks for whole cache lines, the natural alignment then wins.
+        // One alignas only: GCC keeps the first of several dependent ones.
+        template <typename Pool>
+        struct alignas(std::max({ Pool::node_align, alignof(typename Pool::value_type), alignof(std::atomic<void*>) }))
+        MPSC_node : MPSC_node_owner<Pool> {
+            using value_type = typename Pool::value_type;
             
             using node_t = MPSC_node;
 
@@ -166,11 +386,11 @@ namespace daking {
             std::atomic<node_t*> next_;
         };
 
-        template <typename Queue>
+        template <typename Pool>
         struct MPSC_page{
-            using size_type = typename Queue::size_type;
+            using size_type = typename Pool::size_type;
 
-            using node_t      = MPSC_node<Queue>;
+            using node_t      = MPSC_node<Pool>;
             using page_t      = MPSC_page;
 
             MPSC_page(node_t* node, size_type count, page_t* next) 
@@ -182,11 +402,12 @@ namespace daking {
             page_t*   next_;
         };
 
-        template <typename Queue>
-        struct MPSC_chunk_stack {
-            using size_type = typename Queue::size_type;
+        // Every refill and every flush CASes top_, the stack owns its line.
+        template <typename Pool>
+        struct alignas(cache_line_size) MPSC_chunk_stack {
+            using size_type = typename Pool::size_type;
 
-            using node_t = MPSC_node<Queue>;
+            using node_t = MPSC_node<Pool>;
 
             struct tagged_ptr {
                node_t*   node_ = nullptr;
@@ -198,9 +419,16 @@ namespace daking {
 
             DAKING_ALWAYS_INLINE void reset() noexcept {
                 top_.store(tagged_ptr{ nullptr, 0 });
+                count_.store(0, std::memory_order_relaxed);
+            }
+
+            DAKING_ALWAYS_INLINE size_type count() const noexcept {
+                return count_.load(std::memory_order_relaxed);
             }
 
             DAKING_ALWAYS_INLINE void push(node_t* chunk) noexcept /* Pointer Swap */ {
+                // Count before publishing, so that a racing pop never drives count_ below zero.
+                count_.fetch_add(1, std::memory_order_relaxed);
                 tagged_ptr new_top{ chunk, 0 };
                 tagged_ptr old_top = top_.load(std::memory_order_relaxed);
                 // If TB read old_top, and TA pop the old_top then
@@ -239,61 +467,163 @@ namespace daking {
                 ));
 
                 chunk = old_top.node_;
+                count_.fetch_sub(1, std::memory_order_relaxed);
 
                 return true;
             }
 
             std::atomic<tagged_ptr> top_{};
+            std::atomic<size_type>  count_{ 0 }; /* Statistics only, may lag behind top_ */
+        };
+
+        template <typename Pool>
+        struct MPSC_thread_local {
+            using size_type = typename Pool::size_type;
+
+            using node_t = MPSC_node<Pool>;
+
+            DAKING_ALWAYS_INLINE void clear() noexcept {
+                node_list_    = nullptr;
+                node_size_    = 0;
+                spare_chunks_ = nullptr;
+                spare_count_  = 0;
+                returned_chunks_.store(nullptr, std::memory_order_relaxed);
+                return_owner_ = nullptr;
+                return_list_  = nullptr;
+                return_size_  = 0;
+            }
+
+            node_t*   node_list_    = nullptr;
+            size_type node_size_    = 0;
+            node_t*   spare_chunks_ = nullptr; /* Whole chunks reserved by prepare_thread, linked by next_chunk_ */
+            size_type spare_count_  = 0;
+
+            /* MPSC_return_to_sender only */
+            std::atomic<node_t*> returned_chunks_{ nullptr }; /* Chunks consumers handed back to this thread, linked by next_chunk_ */
+            MPSC_thread_local*   return_owner_ = nullptr;     /* Consumer side: the thread the pending batch goes back to */
+            node_t*              return_list_  = nullptr;
+            size_type            return_size_  = 0;
         };
 
-        template <typename Queue>
+        template <typename Pool>
         struct MPSC_thread_hook {
-            using size_type = typename Queue::size_type;
+            using size_type = typename Pool::size_type;
 
-            using node_t         = MPSC_node<Queue>;
-            using thread_local_t = typename Queue::thread_local_t;
+            using node_t         = MPSC_node<Pool>;
+            using thread_local_t = typename Pool::thread_local_t;
 
-            MPSC_thread_hook() : tid_(std::this_thread::get_id()) {
-                std::lock_guard<std::mutex> guard(Queue::global_mutex_);
+            MPSC_thread_hook() {
                 // Only being called after global_manager is not a nullptr.
-                pair_ = Queue::_get_global_manager().register_for(tid_);
+                // Lock free: a short-lived thread never waits for the global mutex (held during pool growth).
+                local_ = Pool::_get_global_manager().register_thread();
             }
 
             ~MPSC_thread_hook() {
                 // If this is consumer hook, release the queue tail to help destructor thread.
                 std::atomic_thread_fence(std::memory_order_release);
-                if (Queue::_is_global_manager_alive()) {
-                    std::lock_guard<std::mutex> guard(Queue::global_mutex_);
-                    Queue::_get_global_manager().unregister_for(tid_);
+                if (Pool::_is_global_manager_alive()) {
+                    Pool::_get_global_manager().unregister_thread(local_);
+                }
+            }
+
+            DAKING_ALWAYS_INLINE thread_local_t& local() noexcept {
+                return *local_;
+            }
+
+            thread_local_t* local_;
+        };
+
+        /*
+             Append-only list of blocks of cache-line-padded slots, one slot per registered thread.
+             A thread claims a free slot by CAS on in_use_, and gives it back by clearing in_use_.
+             The thread-local pool stays in the slot: nodes an exited thread cached are parked there
+             until the next thread claims the slot, which replaces the old recycler vector.
+             Blocks are only freed with the manager.
+        */
+        template <typename Pool, typename ThreadLocalType>
+        struct MPSC_thread_registry {
+            using size_type      = typename Pool::size_type;
+            using thread_local_t = ThreadLocalType;
+
+            static constexpr std::size_t block_capacity = 64;
+
+            struct alignas(cache_line_size) slot_t {
+                std::atomic<bool> in_use_{ false };
+                thread_local_t    local_{};
+            };
+
+            struct block_t {
+                slot_t                slots_[block_capacity];
+                std::atomic<block_t*> next_{ nullptr };
+            };
+
+            MPSC_thread_registry()  = default;
+            ~MPSC_thread_registry() {
+                block_t* block = head_.load(std::memory_order_acquire);
+                while (block) {
+                    delete std::exchange(block, block->next_.load(std::memory_order_relaxed));
+                }
+            }
+
+            thread_local_t* acquire() {
+                for (block_t* block = head_.load(std::memory_order_acquire); block; block = block->next_.load(std::memory_order_acquire)) {
+                    for (slot_t& slot : block->slots_) {
+                        if (try_claim(slot)) {
+                            return &slot.local_;
+                        }
+                    }
+                }
+
+                // Every slot is taken: publish a new block whose first slot is already ours.
+                block_t* new_block = new block_t();
+                new_block->slots_[0].in_use_.store(true, std::memory_order_relaxed);
+                block_t* old_head = head_.load(std::memory_order_relaxed);
+                do {
+                    new_block->next_.store(old_head, std::memory_order_relaxed);
+                } while (!head_.compare_exchange_weak(old_head, new_block, std::memory_order_acq_rel, std::memory_order_relaxed));
+                return &new_block->slots_[0].local_;
+            }
+
+            DAKING_ALWAYS_INLINE void release(thread_local_t* local) noexcept {
+                _slot_of(local)->in_use_.store(false, std::memory_order_release);
+            }
+
+            template <typename Func>
+            void for_each(Func&& func) {
+                for (block_t* block = head_.load(std::memory_order_acquire); block; block = block->next_.load(std::memory_order_acquire)) {
+                    for (slot_t& slot : block->slots_) {
+                        func(slot);
+                    }
                 }
             }
 
-            DAKING_ALWAYS_INLINE node_t*& node_list() noexcept {
-                return pair_->first;
+            DAKING_ALWAYS_INLINE static bool try_claim(slot_t& slot) noexcept {
+                bool expected = false;
+                return !slot.in_use_.load(std::memory_order_relaxed) &&
+                    slot.in_use_.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed);
             }
 
-            DAKING_ALWAYS_INLINE size_type& node_size() noexcept {
-                return pair_->second;
+            DAKING_ALWAYS_INLINE static slot_t* _slot_of(thread_local_t* local) noexcept {
+                return reinterpret_cast<slot_t*>(reinterpret_cast<unsigned char*>(local) - offsetof(slot_t, local_));
             }
 
-            std::thread::id tid_;
-            thread_local_t* pair_;
+            std::atomic<block_t*> head_{ nullptr };
         };
 
         // If allocator is stateless, there is no data race.
         // But if it has stateful member: construct/destroy, you should protect these two functions by yourself,
         // and other functions are protected by daking.
-        template <typename Queue, typename ThreadLocalType, typename Alloc>
-        struct MPSC_manager : 
-            public std::allocator_traits<Alloc>::template rebind_alloc<detail::MPSC_node<Queue>>,
-            public std::allocator_traits<Alloc>::template rebind_alloc<detail::MPSC_page<Queue>> {
-            using size_type             = typename Queue::size_type;
-
-            using node_t                  = MPSC_node<Queue>;
-            using page_t                  = MPSC_page<Queue>;
+        // Aligned, so the page list and the node count, written while the pool grows, share no line with another static.
+        template <typename Pool, typename ThreadLocalType, typename Alloc>
+        struct alignas(cache_line_size) MPSC_manager : 
+            public std::allocator_traits<Alloc>::template rebind_alloc<detail::MPSC_node<Pool>>,
+            public std::allocator_traits<Alloc>::template rebind_alloc<detail::MPSC_page<Pool>> {
+            using size_type             = typename Pool::size_type;
+
+            using node_t                  = MPSC_node<Pool>;
+            using page_t                  = MPSC_page<Pool>;
             using thread_local_t          = ThreadLocalType;
-            using thread_local_manager_t  = std::unordered_map<std::thread::id, std::unique_ptr<thread_local_t>>;
-            using thread_local_recycler_t = std::vector<std::unique_ptr<thread_local_t>>;
+            using thread_registry_t       = MPSC_thread_registry<Pool, thread_local_t>;
             using alloc_node_t            = typename std::allocator_traits<Alloc>::template rebind_alloc<node_t>;
             using altraits_node_t         = std::allocator_traits<alloc_node_t>;
             using alloc_page_t            = typename std::allocator_traits<Alloc>::template rebind_alloc<page_t>;
@@ -305,270 +635,1478 @@ namespace daking {
 
             ~MPSC_manager() {
                 reset();
-                Queue::global_manager_instance_ = nullptr;
+                Pool::global_manager_instance_ = nullptr;
                 std::atomic_thread_fence(std::memory_order_release);
             }
 
             void reset() {
                 /* Already locked */
-                for (auto& [tid, pair_ptr] : global_thread_local_manager_) {
-                    auto& [node, size] = *pair_ptr;
-                    node = nullptr;
-                    size = 0;
-                }
-                for (auto& pair_ptr : global_thread_local_recycler_) {
-                    auto& [node, size] = *pair_ptr;
-                    node = nullptr;
-                    size = 0;
-                }
+                global_thread_registry_.for_each([](auto& slot) {
+                    slot.local_.clear();
+                });
 
                 while (global_page_list_) {
                     altraits_node_t::deallocate(*this, global_page_list_->node_, global_page_list_->count_);
                     altraits_page_t::deallocate(*this, std::exchange(global_page_list_, global_page_list_->next_), 1);
                 }
+                global_page_count_ = 0;
 
                 global_node_count_.store(0, std::memory_order_release);
             }
 
-            void reserve(size_type count) {
+            void reserve(size_type count, bool touch_pages = false) {
                 /* Already locked */
                 node_t* new_nodes = altraits_node_t::allocate(*this, count);
+                if (touch_pages) {
+                    // Fault in every page now instead of on the first message of some producer.
+                    volatile unsigned char* bytes = reinterpret_cast<unsigned char*>(new_nodes);
+                    std::size_t byte_count = count * sizeof(node_t);
+                    for (std::size_t offset = 0; offset < byte_count; offset += os_page_size) {
+                        bytes[offset] = 0;
+                    }
+                    bytes[byte_count - 1] = 0;
+                }
                 page_t* new_page = altraits_page_t::allocate(*this, 1);
                 altraits_page_t::construct(*this, new_page, new_nodes, count, global_page_list_);
                 global_page_list_ = new_page;
+                global_page_count_++;
+
+                _push_chunks(new_nodes, count);
+
+                global_node_count_.store(global_node_count_ + count, std::memory_order_release);
+            }
+
+            bool shrink(size_type max_node_count) {
+                /* Already locked, no instance alive, the chunk stack is reset */
+                // Every node is free: forget the thread-local caches, free the pages over max_node_count
+                // and chunk the kept pages again.
+                global_thread_registry_.for_each([](auto& slot) {
+                    slot.local_.clear();
+                });
+
+                bool freed = false;
+                page_t* kept = nullptr;
+                page_t** kept_tail = &kept;
+                size_type kept_node_count = 0;
+                global_page_count_ = 0;
+                while (global_page_list_) {
+                    page_t* page = std::exchange(global_page_list_, global_page_list_->next_);
+                    if (kept_node_count + page->count_ <= max_node_count) {
+                        kept_node_count += page->count_;
+                        global_page_count_++;
+                        page->next_ = nullptr;
+                        *std::exchange(kept_tail, &page->next_) = page;
+                        _push_chunks(page->node_, page->count_);
+                    }
+                    else {
+                        altraits_node_t::deallocate(*this, page->node_, page->count_);
+                        altraits_page_t::deallocate(*this, page, 1);
+                        freed = true;
+                    }
+                }
+                global_page_list_ = kept;
+
+                global_node_count_.store(kept_node_count, std::memory_order_release);
+                return freed;
+            }
 
+            static void _push_chunks(node_t* nodes, size_type count) noexcept {
                 for (size_type i = 0; i < count; i++) {
-                    new_nodes[i].next_ = new_nodes + i + 1; // seq_cst
-                    if ((i & (Queue::thread_local_capacity - 1)) == Queue::thread_local_capacity - 1) DAKING_UNLIKELY {
+                    nodes[i].next_ = nodes + i + 1; // seq_cst
+                    if ((i & (Pool::thread_local_capacity - 1)) == Pool::thread_local_capacity - 1) DAKING_UNLIKELY {
                         // chunk_count = count / ThreadLocalCapacity
-                        new_nodes[i].next_ = nullptr;
+                        nodes[i].next_ = nullptr;
                         std::atomic_thread_fence(std::memory_order_acq_rel);
                         // mutex don't protect global_chunk_stack_
-                        Queue::global_chunk_stack_.push(&new_nodes[i - Queue::thread_local_capacity + 1]);
+                        Pool::global_chunk_stack_.push(&nodes[i - Pool::thread_local_capacity + 1]);
                     }
                 }
-
-                global_node_count_.store(global_node_count_ + count, std::memory_order_release);
             }
 
-            DAKING_ALWAYS_INLINE thread_local_t* register_for(std::thread::id tid) {
-                /* Already locked */
-                if (!global_thread_local_recycler_.empty()) {
-                    global_thread_local_manager_[tid] = std::move(global_thread_local_recycler_.back());
-                    global_thread_local_recycler_.pop_back();
-                }
-                else {
-                    global_thread_local_manager_[tid] = std::make_unique<thread_local_t>(nullptr, 0);
-                }
-                return global_thread_local_manager_[tid].get();
+            DAKING_ALWAYS_INLINE thread_local_t* register_thread() {
+                return global_thread_registry_.acquire();
             }
 
-            DAKING_ALWAYS_INLINE void unregister_for(std::thread::id tid) {
-                /* Already locked */
-                global_thread_local_recycler_.push_back(std::move(global_thread_local_manager_[tid]));
-                global_thread_local_manager_.erase(tid);
+            DAKING_ALWAYS_INLINE void unregister_thread(thread_local_t* local) noexcept {
+                global_thread_registry_.release(local);
             }
 
             DAKING_ALWAYS_INLINE size_type node_count() noexcept {
                 return global_node_count_.load(std::memory_order_acquire);
             }
 
+            void count_threads(size_type& thread_count, size_type& parked_node_count) noexcept {
+                // A free slot is claimed while it is read, so that no new thread takes it meanwhile.
+                thread_count = parked_node_count = 0;
+                global_thread_registry_.for_each([&](auto& slot) {
+                    if (thread_registry_t::try_claim(slot)) {
+                        parked_node_count += slot.local_.node_size_ + slot.local_.return_size_ +
+                            (slot.local_.spare_count_ + _count_chunks(slot.local_.returned_chunks_.load(std::memory_order_acquire))) * Pool::thread_local_capacity;
+                        slot.in_use_.store(false, std::memory_order_release);
+                    }
+                    else {
+                        thread_count++;
+                    }
+                });
+            }
+
+            DAKING_ALWAYS_INLINE static size_type _count_chunks(node_t* chunk) noexcept {
+                size_type count = 0;
+                for (; chunk; chunk = chunk->next_chunk_) {
+                    count++;
+                }
+                return count;
+            }
+
             DAKING_ALWAYS_INLINE static MPSC_manager* create_global_manager(const Alloc& alloc) {
                 static MPSC_manager global_manager(alloc);
                 return &global_manager;
             }
 
             page_t*                 global_page_list_  = nullptr;
+            size_type               global_page_count_ = 0;
             std::atomic<size_type>  global_node_count_ = 0;
-            thread_local_manager_t  global_thread_local_manager_;
-            thread_local_recycler_t global_thread_local_recycler_;
+            thread_registry_t       global_thread_registry_;
         };
-    }
 
-    template <
-        typename Ty,                          
-        std::size_t ThreadLocalCapacity = 256,
-        std::size_t Align               = 64, /* std::hardware_destructive_interference_size */
-        typename Alloc                  = std::allocator<Ty>
-    >
-    class MPSC_queue {
-    public:
-        static_assert(std::is_object_v<Ty>, "Ty must be object.");
-		static_assert((ThreadLocalCapacity & (ThreadLocalCapacity - 1)) == 0, "ThreadLocalCapacity must be a power of 2.");
+        template <std::size_t Size, std::size_t Align>
+        struct MPSC_storage {
+            alignas(Align) unsigned char bytes_[Size];
+        };
 
-        using value_type      = Ty;
-        using allocator_type  = Alloc;
-        using size_type       = typename std::allocator_traits<allocator_type>::size_type;
-        using pointer         = typename std::allocator_traits<allocator_type>::pointer;
-        using reference       = Ty&;
-        using const_reference = const Ty&;
+        /*
+             The global pool: pages, chunk stack, thread-local pools and their configuration.
+             Every distinct Key owns exactly one pool, MPSC_queue picks the key:
+             - by default, the MPSC_queue instantiation itself, so every queue type owns its pool;
+             - with MPSC_shared_pool, the tag itself, Storage and Alloc then only depend on the size and alignment class of Ty,
+               so all queue types of the same class share one pool.
+             ReturnToSender (MPSC_return_to_sender) is part of the pool type, a pool either stamps owners on all its nodes or on none.
+             So is NodeAlign (MPSC_padded_nodes), queues of one storage class but different layouts never share nodes.
+        */
+        template <typename Key, typename Storage, std::size_t ThreadLocalCapacity, typename Alloc, bool ReturnToSender = false, std::size_t NodeAlign = 1>
+        struct MPSC_pool {
+            using value_type     = Storage;
+            using allocator_type = Alloc;
+            using size_type      = typename std::allocator_traits<allocator_type>::size_type;
+
+            static constexpr std::size_t thread_local_capacity = ThreadLocalCapacity;
+            static constexpr bool        return_to_sender      = ReturnToSender;
+            static constexpr std::size_t node_align            = NodeAlign;
+
+            using node_t          = MPSC_node<MPSC_pool>;
+            using page_t          = MPSC_page<MPSC_pool>;
+            using chunk_stack_t   = MPSC_chunk_stack<MPSC_pool>;
+            using thread_hook_t   = MPSC_thread_hook<MPSC_pool>;
+            using thread_local_t  = MPSC_thread_local<MPSC_pool>;
+            using manager_t       = MPSC_manager<MPSC_pool, thread_local_t, allocator_type>;
+            using alloc_node_t    = typename manager_t::alloc_node_t;
+            using altraits_node_t = typename manager_t::altraits_node_t;
+            using alloc_page_t    = typename manager_t::alloc_page_t;
+            using altraits_page_t = typename manager_t::altraits_page_t;
+
+            struct config_t {
+                MPSC_growth_policy    growth_policy_    = MPSC_growth_policy::doubling();
+                size_type             node_budget_      = 0; /* 0 means unlimited */
+                MPSC_overflow_handler overflow_handler_ = nullptr;
+                MPSC_retention_policy retention_policy_ = MPSC_retention_policy::release();
+            };
 
-        static constexpr std::size_t thread_local_capacity = ThreadLocalCapacity;
-        static constexpr std::size_t align                 = Align;
+            static_assert(std::is_empty_v<allocator_type>, 
+                "In the global manager design, Alloc must be stateless to avoid dangling references. "
+            );
 
-    private:
-        using node_t          = detail::MPSC_node<MPSC_queue>;
-        using page_t          = detail::MPSC_page<MPSC_queue>;
-        using chunk_stack_t   = detail::MPSC_chunk_stack<MPSC_queue>;
-        using thread_hook_t   = detail::MPSC_thread_hook<MPSC_queue>;
-        using thread_local_t  = std::pair<node_t*, size_type>;
-        using manager_t       = detail::MPSC_manager<MPSC_queue, thread_local_t, allocator_type>;
-        using alloc_node_t    = typename manager_t::alloc_node_t;
-        using altraits_node_t = typename manager_t::altraits_node_t;
-        using alloc_page_t    = typename manager_t::alloc_page_t;
-        using altraits_page_t = typename manager_t::altraits_page_t;
-
-        static_assert(std::is_empty_v<allocator_type>, 
-            "In the global manager design, Alloc must be stateless to avoid dangling references. "
-        );
+            static_assert(
+                std::is_constructible_v<alloc_node_t, allocator_type> && std::is_constructible_v<alloc_page_t, allocator_type>,        
+                "Alloc should have a template constructor like 'Alloc(const Alloc<T>& alloc)' to meet internal conversion."
+            );
 
-        static_assert(
-            std::is_constructible_v<alloc_node_t, allocator_type> && std::is_constructible_v<alloc_page_t, allocator_type>,        
-            "Alloc should have a template constructor like 'Alloc(const Alloc<T>& alloc)' to meet internal conversion."
-        );
+            DAKING_ALWAYS_INLINE static void _attach(const allocator_type& alloc) {
+                global_instance_count_++;
+                std::lock_guard<std::mutex> guard(global_mutex_);
+                global_manager_instance_ = manager_t::create_global_manager(alloc); // single instance
+            }
 
-        friend thread_hook_t;
-        friend manager_t;
-        friend altraits_node_t;
-        friend altraits_page_t;
+            DAKING_ALWAYS_INLINE static void _detach() {
+                if (--global_instance_count_ == 0) {
+                    // only the last instance free the global resource
+                    std::lock_guard<std::mutex> lock(global_mutex_);
+                    // if a new instance constructed before i get mutex, I do nothing.
+                    if (global_instance_count_ == 0) {
+                        _retain_global();
+                    }
+                }
+            }
 
-    public:
-        MPSC_queue() : MPSC_queue(allocator_type()) {}
+            DAKING_ALWAYS_INLINE static size_type node_count() noexcept {
+                return _is_global_manager_alive() ? _get_global_manager().node_count() : 0;
+            }
 
-        MPSC_queue(const allocator_type& alloc) {
-            /* Alloc<Ty> -> Alloc<...>, which means Alloc should have a template constructor */
-            global_instance_count_++;
-            _initial(alloc);
-        }
+            DAKING_ALWAYS_INLINE static bool reserve_chunk(size_type chunk_count, bool touch_pages) {
+                return _is_global_manager_alive() ? _reserve_global_external(chunk_count, touch_pages) : false;
+            }
 
-        explicit MPSC_queue(size_type initial_global_chunk_count, const allocator_type& alloc = allocator_type()) 
-            : MPSC_queue(alloc) {
-            reserve_global_chunk(initial_global_chunk_count);
-        }
+            static bool prepare_thread(size_type chunk_count) {
+                if (!_is_global_manager_alive()) {
+                    return false;
+                }
+                thread_local_t& local = _get_thread_hook().local();
+                size_type prepared = (local.node_size_ != 0) + local.spare_count_;
+                for (; prepared < chunk_count; prepared++) {
+                    node_t* chunk;
+                    if (!_try_pop_global_chunk(chunk)) {
+                        return false;
+                    }
+                    if (local.node_size_ == 0) {
+                        local.node_list_ = chunk;
+                        local.node_size_ = thread_local_capacity;
+                    }
+                    else {
+                        chunk->next_chunk_ = local.spare_chunks_;
+                        local.spare_chunks_ = chunk;
+                        local.spare_count_++;
+                    }
+                }
+                return true;
+            }
 
-        ~MPSC_queue() {
-            node_t* next = tail_->next_.load(std::memory_order_acquire);
-            while (next) {
-                altraits_node_t::destroy(_get_global_manager(), std::addressof(next->value_));
-                _deallocate(std::exchange(tail_, next));
-                next = tail_->next_.load(std::memory_order_acquire);
+            static void set_growth_policy(MPSC_growth_policy policy) {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                global_pool_config_.growth_policy_ = policy;
             }
-            _deallocate(tail_);
 
-            if (--global_instance_count_ == 0) {
-                // only the last instance free the global resource
-				std::lock_guard<std::mutex> lock(global_mutex_);
-                // if a new instance constructed before i get mutex, I do nothing.
-                if (global_instance_count_ == 0) {
-                    _free_global();
+            static MPSC_growth_policy growth_policy() {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                return global_pool_config_.growth_policy_;
+            }
+
+            static void set_node_budget(size_type max_node_count, MPSC_overflow_handler handler) {
+                {
+                    std::lock_guard<std::mutex> lock(global_mutex_);
+                    global_pool_config_.node_budget_      = max_node_count;
+                    global_pool_config_.overflow_handler_ = handler;
                 }
+                global_budget_word_.wake_all(); // A raised budget, or a handler now: waiting producers try again.
             }
-        }
 
-        MPSC_queue(const MPSC_queue&)            = delete;
-        MPSC_queue(MPSC_queue&&)                 = delete;
-        MPSC_queue& operator=(const MPSC_queue&) = delete;
-        MPSC_queue& operator=(MPSC_queue&&)      = delete;
+            static size_type node_budget() {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                return global_pool_config_.node_budget_;
+            }
 
-        template <typename...Args>
-        DAKING_ALWAYS_INLINE void emplace(Args&&... args) {
-            node_t* new_node = _allocate();
-            altraits_node_t::construct(_get_global_manager(), std::addressof(new_node->value_), std::forward<Args>(args)...);
+            static void set_retention_policy(MPSC_retention_policy policy) {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                global_pool_config_.retention_policy_ = policy;
+            }
 
-            node_t* old_head = head_.exchange(new_node, std::memory_order_acq_rel);
-            old_head->next_.store(new_node, std::memory_order_release);
-#if DAKING_HAS_CXX20_OR_ABOVE
-            old_head->next_.notify_one();
-#endif 
-        }
+            static MPSC_retention_policy retention_policy() {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                return global_pool_config_.retention_policy_;
+            }
 
-        DAKING_ALWAYS_INLINE void enqueue(const_reference value) {
-            emplace(value);
-        }
+            static bool release() {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                if (global_instance_count_ != 0 || !_is_global_manager_alive() || _get_global_manager().node_count() == 0) {
+                    return false;
+                }
+                _free_global();
+                return true;
+            }
 
-        DAKING_ALWAYS_INLINE void enqueue(value_type&& value) {
-            emplace(std::move(value));
-        }
+            static bool trim() {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                if (global_instance_count_ != 0 || !_is_global_manager_alive() || _get_global_manager().node_count() == 0) {
+                    return false;
+                }
+                const MPSC_retention_policy& policy = global_pool_config_.retention_policy_;
+                switch (policy.kind_) {
+                case MPSC_retention_policy::kind_t::keep_all:
+                    return false;
+                case MPSC_retention_policy::kind_t::keep_up_to:
+                    return _shrink_global(policy.node_count_);
+                case MPSC_retention_policy::kind_t::release_after_idle:
+                    if (std::chrono::steady_clock::now() - global_idle_since_ < policy.idle_time_) {
+                        return false;
+                    }
+                    [[fallthrough]];
+                default:
+                    _free_global();
+                    return true;
+                }
+            }
 
-        DAKING_ALWAYS_INLINE void enqueue_bulk(const_reference value, size_type n) {
-            // N times thread_local operation, One time CAS operation.
-            // So it is more efficient than N times enqueue.
-            if (n == 0) DAKING_UNLIKELY {
-                return;
+            static MPSC_pool_stats stats() {
+                MPSC_pool_stats stats;
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                if (!_is_global_manager_alive()) {
+                    return stats;
+                }
+                manager_t& manager = _get_global_manager();
+                stats.node_count_        = manager.node_count();
+                stats.page_count_        = manager.global_page_count_;
+                stats.byte_count_        = stats.node_count_ * sizeof(node_t);
+                stats.free_node_count_   = global_chunk_stack_.count() * thread_local_capacity;
+                manager.count_threads(stats.thread_count_, stats.parked_node_count_);
+                return stats;
             }
 
-            node_t* first_new_node = _allocate();
-            node_t* prev_node = first_new_node;
-            altraits_node_t::construct(_get_global_manager(), std::addressof(first_new_node->value_), value);
-            for (size_type i = 1; i < n; i++) {
-                node_t* new_node = _allocate();
-                altraits_node_t::construct(_get_global_manager(), std::addressof(new_node->value_), value);
-                prev_node->next_.store(new_node, std::memory_order_relaxed);
-                prev_node = new_node;
+            DAKING_ALWAYS_INLINE static manager_t& _get_global_manager() noexcept {
+                return *global_manager_instance_;
             }
-            node_t* old_head = head_.exchange(prev_node, std::memory_order_acq_rel);
-            old_head->next_.store(first_new_node, std::memory_order_release);
-#if DAKING_HAS_CXX20_OR_ABOVE
-            old_head->next_.notify_one();
-#endif
-        }
 
-		template <typename InputIt>
-        DAKING_ALWAYS_INLINE void enqueue_bulk(InputIt it, size_type n) {
-			// Enqueue n elements from input iterator.
-            static_assert(std::is_base_of_v<std::input_iterator_tag,
-                typename std::iterator_traits<InputIt>::iterator_category>,
-                "Iterator must be at least input iterator.");
-            static_assert(std::is_same_v<typename std::iterator_traits<InputIt>::value_type, value_type>,
-                "The value type of iterator must be same as MPSC_queue::value_type.");
-            if (n == 0) DAKING_UNLIKELY {
-                return;
+            DAKING_ALWAYS_INLINE static bool _is_global_manager_alive() noexcept {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return global_manager_instance_ != nullptr;
             }
 
-            node_t* first_new_node = _allocate();
-            node_t* prev_node = first_new_node;
-            altraits_node_t::construct(_get_global_manager(), std::addressof(first_new_node->value_), *it);
-            ++it;
-            for (size_type i = 1; i < n; i++) {
-                node_t* new_node = _allocate();
-                altraits_node_t::construct(_get_global_manager(), std::addressof(new_node->value_), *it);
-                prev_node->next_.store(new_node,  std::memory_order_relaxed);
-                prev_node = new_node;
-                ++it;
+            DAKING_ALWAYS_INLINE static thread_hook_t& _get_thread_hook() {
+                static thread_local thread_hook_t thread_hook;
+                return thread_hook;
             }
-            node_t* old_head = head_.exchange(prev_node, std::memory_order_acq_rel);
-			old_head->next_.store(first_new_node, std::memory_order_release);
-#if DAKING_HAS_CXX20_OR_ABOVE
-            old_head->next_.notify_one();
-#endif 
-		}
 
-        template <typename ForwardIt, std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag,
-            typename std::iterator_traits<ForwardIt>::iterator_category>, int> = 0>
-        DAKING_ALWAYS_INLINE void enqueue_bulk(ForwardIt begin, ForwardIt end) {
-            enqueue_bulk(begin, (size_type)std::distance(begin, end));
-        }
+            // Every thread-local operation has an overload taking the thread's slot, for the callers that cache it (tokens).
+            DAKING_ALWAYS_INLINE static node_t* _allocate() {
+                return _allocate(_get_thread_hook().local());
+            }
 
-        template <typename T>
-        DAKING_ALWAYS_INLINE bool try_dequeue(T& value) 
-            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> && 
-                std::is_nothrow_destructible_v<value_type>) {
-            static_assert(std::is_assignable_v<T&, value_type&&>);
+            DAKING_ALWAYS_INLINE static node_t* _allocate(thread_local_t& local) {
+                if (local.node_size_ == 0) DAKING_UNLIKELY {
+                    while (!_try_refill_thread_local(local) && !_on_global_budget_exhausted(local));
+                }
+                return _pop_thread_local(local);
+            }
 
-            node_t* next = tail_->next_.load(std::memory_order_acquire);
-            if (next) DAKING_LIKELY {
-                value = std::move(next->value_);
-                altraits_node_t::destroy(_get_global_manager(), std::addressof(next->value_));
-                _deallocate(std::exchange(tail_, next));
+            DAKING_ALWAYS_INLINE static node_t* _try_allocate() {
+                thread_local_t& local = _get_thread_hook().local();
+                if (local.node_size_ == 0) DAKING_UNLIKELY {
+                    if (!_try_refill_thread_local(local)) {
+                        return nullptr;
+                    }
+                }
+                return _pop_thread_local(local);
+            }
+
+            DAKING_ALWAYS_INLINE static node_t* _pop_thread_local(thread_local_t& local) noexcept {
+                local.node_size_--;
+                DAKING_TSAN_ANNOTATE_ACQUIRE(local.node_list_);
+                DAKING_TSAN_ANNOTATE_ACQUIRE(local.node_list_->next_);
+                node_t* res = std::exchange(local.node_list_, local.node_list_->next_.load(std::memory_order_relaxed));
+                res->next_.store(nullptr, std::memory_order_relaxed);
+                if constexpr (return_to_sender) {
+                    res->owner_ = &local;
+                }
+                return res;
+            }
+
+            DAKING_ALWAYS_INLINE static bool _try_refill_thread_local(thread_local_t& local) {
+                if (local.spare_chunks_) {
+                    // Prepared by prepare_thread.
+                    local.node_list_ = std::exchange(local.spare_chunks_, local.spare_chunks_->next_chunk_);
+                    local.spare_count_--;
+                }
+                else if (!_try_take_returned_chunks(local) && !_try_pop_global_chunk(local.node_list_)) {
+                    return false;
+                }
+                local.node_size_ = thread_local_capacity;
                 return true;
             }
-            else {
+
+            DAKING_ALWAYS_INLINE static bool _try_take_returned_chunks(thread_local_t& local) noexcept {
+                // Chunks our consumers handed back: one becomes the node list, the rest are kept as spare chunks.
+                if constexpr (return_to_sender) {
+                    if (local.returned_chunks_.load(std::memory_order_relaxed)) {
+                        node_t* chunk = local.returned_chunks_.exchange(nullptr, std::memory_order_acquire);
+                        local.node_list_    = chunk;
+                        local.spare_chunks_ = chunk->next_chunk_;
+                        local.spare_count_  = manager_t::_count_chunks(local.spare_chunks_);
+                        return true;
+                    }
+                }
                 return false;
             }
-        }
 
-        template <typename OutputIt>
-        DAKING_ALWAYS_INLINE size_type try_dequeue_bulk(OutputIt it, size_type n) 
+            DAKING_ALWAYS_INLINE static bool _try_allocate_segment(size_type n, node_t*& first, node_t*& last) {
+                // On failure the nodes taken so far go back to the thread-local pool.
+                first = last = _try_allocate();
+                if (!first) DAKING_UNLIKELY {
+                    return false;
+                }
+                for (size_type i = 1; i < n; i++) {
+                    node_t* new_node = _try_allocate();
+                    if (!new_node) DAKING_UNLIKELY {
+                        while (first) {
+                            _deallocate(std::exchange(first, first->next_.load(std::memory_order_relaxed)));
+                        }
+                        return false;
+                    }
+                    last->next_.store(new_node, std::memory_order_relaxed);
+                    last = new_node;
+                }
+                return true;
+            }
+
+            DAKING_ALWAYS_INLINE static void _deallocate(node_t* node) noexcept {
+                _deallocate(_get_thread_hook().local(), node);
+            }
+
+            DAKING_ALWAYS_INLINE static void _deallocate(thread_local_t& local, node_t* node) noexcept {
+                if constexpr (return_to_sender) {
+                    if (node->owner_ != &local) {
+                        _return_to_sender(local, node);
+                        return;
+                    }
+                }
+                _deallocate_local(local, node);
+            }
+
+            DAKING_ALWAYS_INLINE static void _deallocate_local(thread_local_t& local, node_t* node) noexcept {
+                node->next_.store(local.node_list_, std::memory_order_relaxed);
+                local.node_list_ = node;
+                DAKING_TSAN_ANNOTATE_RELEASE(node);
+                if (++local.node_size_ >= thread_local_capacity) DAKING_UNLIKELY {
+                    global_chunk_stack_.push(local.node_list_);
+                    local.node_list_ = nullptr;
+                    local.node_size_ = 0;
+                    _wake_budget_waiters(false);
+                }
+            }
+
+            DAKING_ALWAYS_INLINE static void _return_to_sender(thread_local_t& local, node_t* node) noexcept {
+                // Nodes are gathered per owner, a full chunk goes onto the owner's returned_chunks_.
+                // A batch broken off by another owner is too small to hand back: it goes through the local path.
+                if (node->owner_ != local.return_owner_) DAKING_UNLIKELY {
+                    while (local.return_list_) {
+                        _deallocate_local(local, std::exchange(local.return_list_, local.return_list_->next_.load(std::memory_order_relaxed)));
+                    }
+                    local.return_owner_ = node->owner_;
+                    local.return_size_  = 0;
+                }
+                node->next_.store(local.return_list_, std::memory_order_relaxed);
+                local.return_list_ = node;
+                DAKING_TSAN_ANNOTATE_RELEASE(node);
+                if (++local.return_size_ == thread_local_capacity) DAKING_UNLIKELY {
+                    thread_local_t* owner = std::exchange(local.return_owner_, nullptr);
+                    node_t* chunk = std::exchange(local.return_list_, nullptr);
+                    local.return_size_ = 0;
+                    node_t* old_top = owner->returned_chunks_.load(std::memory_order_relaxed);
+                    do {
+                        chunk->next_chunk_ = old_top;
+                    } while (!owner->returned_chunks_.compare_exchange_weak(
+                        old_top, chunk, std::memory_order_release, std::memory_order_relaxed));
+                    _wake_budget_waiters(true); // Only the owner can take it, so wake them all.
+                }
+            }
+
+            DAKING_ALWAYS_INLINE static bool _reserve_global_external(size_type chunk_count, bool touch_pages) {
+                manager_t& manager = _get_global_manager();
+                size_type global_node_count = manager.node_count();
+                if (global_node_count / thread_local_capacity >= chunk_count) {
+                    return false;
+                }
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                global_node_count = manager.node_count();
+                if (global_node_count / thread_local_capacity >= chunk_count) {
+                    return false;
+                }
+
+                size_type count = _clamp_to_global_budget(
+                    (chunk_count - global_node_count / thread_local_capacity) * thread_local_capacity, global_node_count);
+                if (count == 0) {
+                    return false;
+                }
+                manager.reserve(count, touch_pages);
+                return true;
+            }
+
+            DAKING_ALWAYS_INLINE static bool _reserve_global_internal() {
+                std::lock_guard<std::mutex> lock(global_mutex_);
+                if (global_chunk_stack_.top_.load(std::memory_order_acquire).node_) {
+                    // if anyone have already allocate chunks, I return.
+                    return true;
+                }
+
+                manager_t& manager = _get_global_manager();
+                size_type global_node_count = manager.node_count();
+                size_type count = _clamp_to_global_budget(
+                    global_pool_config_.growth_policy_.next(global_node_count, thread_local_capacity), global_node_count);
+                if (count == 0) DAKING_UNLIKELY {
+                    // budget exhausted
+                    return false;
+                }
+                manager.reserve(count);
+                return true;
+            }
+
+            DAKING_ALWAYS_INLINE static size_type _clamp_to_global_budget(size_type count, size_type global_node_count) noexcept {
+                /* Already locked */
+                size_type budget = global_pool_config_.node_budget_;
+                if (budget == 0) DAKING_LIKELY {
+                    return count;
+                }
+                size_type room = budget > global_node_count ? budget - global_node_count : 0;
+                return std::min(count, room / thread_local_capacity * thread_local_capacity);
+            }
+
+            DAKING_ALWAYS_INLINE static bool _try_pop_global_chunk(node_t*& chunk) {
+                while (!global_chunk_stack_.try_pop(chunk)) {
+                    if (!_reserve_global_internal()) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            static bool _on_global_budget_exhausted(thread_local_t& local) {
+                // Returns whether local was refilled meanwhile, otherwise _allocate tries again.
+                MPSC_overflow_handler handler;
+                size_type global_node_count;
+                {
+                    std::lock_guard<std::mutex> lock(global_mutex_);
+                    handler = global_pool_config_.overflow_handler_;
+                    global_node_count = _get_global_manager().node_count();
+                }
+                if (!handler) {
+                    return _wait_for_chunk(local);
+                }
+                if (!handler(global_node_count)) {
+                    throw std::bad_alloc();
+                }
+                return false;
+            }
+
+            static bool _wait_for_chunk(thread_local_t& local) {
+                // Sleep until a chunk is freed or the budget changes. Announce, re-check, sleep: the consumer's parking rule.
+                // Chunks cached by thread-local pools are never freed: if the budget fits inside them, this never returns.
+                std::uint32_t seen = global_budget_word_.load();
+                global_budget_waiters_.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                bool refilled;
+                try {
+                    refilled = _try_refill_thread_local(local);
+                }
+                catch (...) {
+                    global_budget_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    throw;
+                }
+                if (!refilled) {
+                    global_budget_word_.wait(seen);
+                }
+                global_budget_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                return refilled;
+            }
+
+            DAKING_ALWAYS_INLINE static void _wake_budget_waiters(bool all) noexcept {
+                // Pairs with _wait_for_chunk: either the waiter sees the chunk, or we see it waiting. One fence per chunk.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (global_budget_waiters_.load(std::memory_order_relaxed) != 0) DAKING_UNLIKELY {
+                    all ? global_budget_word_.wake_all() : global_budget_word_.wake_one();
+                }
+            }
+
+            static void _retain_global() {
+                /* Already locked, the last instance is gone */
+                switch (global_pool_config_.retention_policy_.kind_) {
+                case MPSC_retention_policy::kind_t::keep_all:
+                    break;
+                case MPSC_retention_policy::kind_t::keep_up_to:
+                    _shrink_global(global_pool_config_.retention_policy_.node_count_);
+                    break;
+                case MPSC_retention_policy::kind_t::release_after_idle:
+                    global_idle_since_ = std::chrono::steady_clock::now();
+                    break;
+                default:
+                    _free_global();
+                    break;
+                }
+            }
+
+            static bool _shrink_global(size_type max_node_count) {
+                /* Already locked */
+                if (!_is_global_manager_alive() || _get_global_manager().node_count() <= max_node_count) {
+                    return false; // Nothing to free, the caches stay warm.
+                }
+                global_chunk_stack_.reset();
+                bool freed = _get_global_manager().shrink(max_node_count);
+                global_generation_.fetch_add(1, std::memory_order_release);
+                return freed;
+            }
+
+            DAKING_ALWAYS_INLINE static void _free_global() {
+                /* Already locked */
+                global_chunk_stack_.reset();
+                if (_is_global_manager_alive()) {
+                    _get_global_manager().reset();
+                }
+                global_generation_.fetch_add(1, std::memory_order_release);
+            }
+
+            /* 
+                 Every group starts a cache line, and chunk_stack_t fills its own:
+                 - the chunk stack is CASed by every refill and flush,
+                 - the manager pointer is read by every emplace and dequeue, the generation by every record queue block,
+                 - the budget waiters are read by every flush, written only while the budget is used up,
+                 - the instance count and the mutex group change only when queues are created or destroyed.
+            */
+
+            /* Global LockFree*/
+            inline static chunk_stack_t          global_chunk_stack_{};
+            alignas(cache_line_size)
+            inline static manager_t*             global_manager_instance_ = nullptr;
+            alignas(cache_line_size)
+            inline static std::atomic<size_type> global_generation_     = 0; /* Bumped whenever the pages are freed */
+            alignas(cache_line_size)
+            inline static std::atomic<size_type> global_budget_waiters_ = 0; /* Producers in _wait_for_chunk */
+            inline static MPSC_wait_word         global_budget_word_{};
+            alignas(cache_line_size)
+            inline static std::atomic<size_type> global_instance_count_ = 0;
+
+            /* Global Mutex*/ 
+            alignas(cache_line_size)
+            inline static std::mutex             global_mutex_{};
+            inline static config_t               global_pool_config_{};
+            inline static std::chrono::steady_clock::time_point global_idle_since_{}; /* When the last instance was destroyed */
+        };
+    }
+
+    /*
+         Policies are the trailing template arguments of MPSC_queue, at most one per category, in any order:
+             using Queue = daking::MPSC_queue<Order, 256, 64, std::allocator<Order>, daking::MPSC_shared_pool, daking::MPSC_track_size>;
+         A bundle groups them under one name, bundles may nest:
+             using low_latency = daking::MPSC_policies<daking::MPSC_wait_poll, daking::MPSC_padded_nodes>;
+             using Queue = daking::MPSC_queue<Order, 256, 64, std::allocator<Order>, low_latency>;
+         A category left out takes its default (the first policy listed below), which is the queue without any policy.
+         Every default compiles to nothing: no member, no branch, no instruction on the hot path.
+    */
+    struct MPSC_pool_sharing_category {};
+    struct MPSC_recycling_category {};
+    struct MPSC_wait_category {};
+    struct MPSC_stats_category {};
+    struct MPSC_size_category {};
+    struct MPSC_layout_category {};
+
+    // Pool policy (default): every MPSC_queue type owns its global pool.
+    struct MPSC_own_pool { using category = MPSC_pool_sharing_category; };
+
+    // Pool policy: key the global pool by the size and alignment class of Ty instead of the full MPSC_queue type.
+    // MPSC_queue<OrderEvent, 256, 64, std::allocator<OrderEvent>, MPSC_shared_pool> and the FillEvent one
+    // then share pages, chunks and thread-local pools as long as both round up to the same storage class.
+    struct MPSC_shared_pool { using category = MPSC_pool_sharing_category; };
+
+    // Recycling policy (default): freed nodes go to the thread-local pool of the thread that frees them.
+    struct MPSC_recycle_local { using category = MPSC_recycling_category; };
+
+    // Pool policy for SPSC-like flows: the consumer hands freed nodes back to the producer thread that allocated them,
+    // a whole chunk at a time, instead of pushing them onto the global chunk stack for any thread to pop.
+    // The nodes stay in the producer's cache (and on its NUMA node), and the global stack sees far fewer CAS.
+    // Costs one owner pointer per node. Interleaved producers degrade to the default path, batch by batch.
+    struct MPSC_return_to_sender { using category = MPSC_recycling_category; };
+
+    // Wait policy (default): a consumer blocked in dequeue() parks, and the enqueue that finds it parked wakes it.
+    struct MPSC_wait_notify { using category = MPSC_wait_category; };
+
+    // Wait policy for consumers that only poll: enqueue never looks for a parked consumer, dequeue() spins with yield instead.
+    struct MPSC_wait_poll { using category = MPSC_wait_category; };
+
+    // Stats policy (default): no counters.
+    struct MPSC_no_stats { using category = MPSC_stats_category; };
+
+    // Stats policy: MPSC_queue::stats() counts elements enqueued, dequeued, and dequeues that found the queue empty.
+    // Costs one relaxed fetch_add per enqueue call, on a cache line of its own that every producer writes,
+    // and relaxed stores on the consumer side.
+    struct MPSC_collect_stats { using category = MPSC_stats_category; };
+
+    // Size policy (default): the queue does not know its size, empty() is all there is.
+    struct MPSC_no_size { using category = MPSC_size_category; };
+
+    // Size policy: MPSC_queue::size_apprx(), from the same counters as MPSC_collect_stats.
+    struct MPSC_track_size { using category = MPSC_size_category; };
+
+    // Layout policy (default): nodes are as small as Ty and the link allow.
+    struct MPSC_compact_nodes { using category = MPSC_layout_category; };
+
+    // Layout policy: every node is aligned to (and padded to a multiple of) the Align of the queue,
+    // so that a producer writing a node never shares its cache line with the node the consumer reads.
+    struct MPSC_padded_nodes { using category = MPSC_layout_category; };
+
+    template <typename... Policies>
+    struct MPSC_policies {};
+
+    // What MPSC_queue::stats() returns with MPSC_collect_stats, a snapshot of relaxed counters.
+    struct MPSC_queue_stats {
+        std::size_t enqueued_count_      = 0;
+        std::size_t dequeued_count_      = 0;
+        std::size_t empty_dequeue_count_ = 0; // try_dequeue calls that found nothing
+    };
+
+    namespace detail {
+        template <typename... Policies>
+        struct MPSC_policy_list {};
+
+        // Bundles are expanded in place, so that MPSC_policies<A, MPSC_policies<B>> is the list A, B.
+        template <typename List, typename... Policies>
+        struct MPSC_flatten_policies {
+            using type = List;
+        };
+
+        template <typename... Out, typename Policy, typename... Rest>
+        struct MPSC_flatten_policies<MPSC_policy_list<Out...>, Policy, Rest...>
+            : MPSC_flatten_policies<MPSC_policy_list<Out..., Policy>, Rest...> {};
+
+        template <typename... Out, typename... Inner, typename... Rest>
+        struct MPSC_flatten_policies<MPSC_policy_list<Out...>, MPSC_policies<Inner...>, Rest...>
+            : MPSC_flatten_policies<MPSC_policy_list<Out...>, Inner..., Rest...> {};
+
+        template <typename Policy, typename = void>
+        struct MPSC_policy_category {
+            using type = void;
+        };
+
+        template <typename Policy>
+        struct MPSC_policy_category<Policy, std::void_t<typename Policy::category>> {
+            using type = typename Policy::category;
+        };
+
+        template <typename Category, typename List>
+        struct MPSC_count_policies;
+
+        template <typename Category, typename... Policies>
+        struct MPSC_count_policies<Category, MPSC_policy_list<Policies...>>
+            : std::integral_constant<std::size_t,
+                (std::size_t(0) + ... + std::size_t(std::is_same_v<typename MPSC_policy_category<Policies>::type, Category>))> {};
+
+        template <typename Policy>
+        struct MPSC_policy_identity {
+            using type = Policy;
+        };
+
+        // The policy of the list in Category, or Default.
+        template <typename Category, typename Default, typename List>
+        struct MPSC_select_policy;
+
+        template <typename Category, typename Default>
+        struct MPSC_select_policy<Category, Default, MPSC_policy_list<>> {
+            using type = Default;
+        };
+
+        template <typename Category, typename Default, typename Policy, typename... Rest>
+        struct MPSC_select_policy<Category, Default, MPSC_policy_list<Policy, Rest...>>
+            : std::conditional_t<std::is_same_v<typename MPSC_policy_category<Policy>::type, Category>,
+                MPSC_policy_identity<Policy>, MPSC_select_policy<Category, Default, MPSC_policy_list<Rest...>>> {};
+
+        template <typename List>
+        struct MPSC_policy_set;
+
+        template <typename... Policies>
+        struct MPSC_policy_set<MPSC_policy_list<Policies...>> {
+            template <typename Category, typename Default>
+            using select = typename MPSC_select_policy<Category, Default, MPSC_policy_list<Policies...>>::type;
+
+            template <typename Category>
+            static constexpr bool unique = MPSC_count_policies<Category, MPSC_policy_list<Policies...>>::value <= 1;
+
+            static constexpr bool known = (... && !std::is_void_v<typename MPSC_policy_category<Policies>::type>);
+        };
+
+        template <typename... Policies>
+        struct MPSC_queue_config {
+            using set = MPSC_policy_set<typename MPSC_flatten_policies<MPSC_policy_list<>, Policies...>::type>;
+
+            static_assert(set::known, "Every policy of MPSC_queue must name its category.");
+            static_assert(set::template unique<MPSC_pool_sharing_category>, "At most one pool sharing policy.");
+            static_assert(set::template unique<MPSC_recycling_category>, "At most one recycling policy.");
+            static_assert(set::template unique<MPSC_wait_category>, "At most one wait policy.");
+            static_assert(set::template unique<MPSC_stats_category>, "At most one stats policy.");
+            static_assert(set::template unique<MPSC_size_category>, "At most one size policy.");
+            static_assert(set::template unique<MPSC_layout_category>, "At most one layout policy.");
+
+            static constexpr bool shares_pool       = std::is_same_v<typename set::template select<MPSC_pool_sharing_category, MPSC_own_pool>, MPSC_shared_pool>;
+            static constexpr bool returns_to_sender = std::is_same_v<typename set::template select<MPSC_recycling_category, MPSC_recycle_local>, MPSC_return_to_sender>;
+            static constexpr bool polls             = std::is_same_v<typename set::template select<MPSC_wait_category, MPSC_wait_notify>, MPSC_wait_poll>;
+            static constexpr bool collects_stats    = std::is_same_v<typename set::template select<MPSC_stats_category, MPSC_no_stats>, MPSC_collect_stats>;
+            static constexpr bool tracks_size       = std::is_same_v<typename set::template select<MPSC_size_category, MPSC_no_size>, MPSC_track_size>;
+            static constexpr bool pads_nodes        = std::is_same_v<typename set::template select<MPSC_layout_category, MPSC_compact_nodes>, MPSC_padded_nodes>;
+            static constexpr bool counts            = collects_stats || tracks_size;
+        };
+
+        // Element counters of MPSC_collect_stats and MPSC_track_size, an empty base otherwise.
+        template <std::size_t Align, bool Enabled>
+        struct MPSC_queue_counters {};
+
+        template <std::size_t Align>
+        struct MPSC_queue_counters<Align, true> {
+            alignas(Align) std::atomic<std::size_t> enqueued_count_{ 0 };       /* Producers */
+            alignas(Align) std::atomic<std::size_t> dequeued_count_{ 0 };       /* Consumer only writes */
+            std::atomic<std::size_t>                empty_dequeue_count_{ 0 };  /* Consumer only writes */
+        };
+    }
+
+    // Result of MPSC_queue::try_dequeue_status: closed means close() was called and everything before it was dequeued.
+    enum class MPSC_dequeue_status { dequeued, empty, closed };
+
+    template <
+        typename Ty,                          
+        std::size_t ThreadLocalCapacity = 256,
+        std::size_t Align               = 64, /* std::hardware_destructive_interference_size */
+        typename Alloc                  = std::allocator<Ty>,
+        typename... Policies
+    >
+    class MPSC_queue : private detail::MPSC_queue_counters<Align, detail::MPSC_queue_config<Policies...>::counts> {
+    public:
+        static_assert(std::is_object_v<Ty>, "Ty must be object.");
+		static_assert((ThreadLocalCapacity & (ThreadLocalCapacity - 1)) == 0, "ThreadLocalCapacity must be a power of 2.");
+
+        using value_type      = Ty;
+        using allocator_type  = Alloc;
+        using size_type       = typename std::allocator_traits<allocator_type>::size_type;
+        using pointer         = typename std::allocator_traits<allocator_type>::pointer;
+        using reference       = Ty&;
+        using const_reference = const Ty&;
+
+        static constexpr std::size_t thread_local_capacity = ThreadLocalCapacity;
+        static constexpr std::size_t align                 = Align;
+        static constexpr bool        shares_pool           = detail::MPSC_queue_config<Policies...>::shares_pool;
+        static constexpr bool        returns_to_sender     = detail::MPSC_queue_config<Policies...>::returns_to_sender;
+        static constexpr bool        polls                 = detail::MPSC_queue_config<Policies...>::polls;
+        static constexpr bool        collects_stats        = detail::MPSC_queue_config<Policies...>::collects_stats;
+        static constexpr bool        tracks_size           = detail::MPSC_queue_config<Policies...>::tracks_size;
+        static constexpr bool        pads_nodes            = detail::MPSC_queue_config<Policies...>::pads_nodes;
+
+    private:
+        static constexpr bool        counts_elements = detail::MPSC_queue_config<Policies...>::counts;
+        static constexpr std::size_t storage_align   = std::max(alignof(Ty), alignof(void*));
+        static constexpr std::size_t storage_size    = (sizeof(Ty) + storage_align - 1) / storage_align * storage_align;
+
+        using storage_t       = std::conditional_t<shares_pool, detail::MPSC_storage<storage_size, storage_align>, Ty>;
+        using pool_alloc_t    = typename std::allocator_traits<allocator_type>::template rebind_alloc<storage_t>;
+        using pool_key_t      = std::conditional_t<shares_pool, MPSC_shared_pool, MPSC_queue>;
+        using pool_t          = detail::MPSC_pool<pool_key_t, storage_t, ThreadLocalCapacity, pool_alloc_t, returns_to_sender, pads_nodes ? Align : 1>;
+        using node_t          = typename pool_t::node_t;
+        using thread_local_t  = typename pool_t::thread_local_t;
+        using altraits_node_t = typename pool_t::altraits_node_t;
+
+        static_assert(std::is_constructible_v<pool_alloc_t, allocator_type>,
+            "Alloc should have a template constructor like 'Alloc(const Alloc<T>& alloc)' to meet internal conversion."
+        );
+
+    public:
+        /*
+             A node taken from the thread-local pool, not yet linked: build the value in place, then publish it.
+                 auto slot = queue.prepare();
+                 if (!slot) return;           // The queue is closed.
+                 new (slot.data()) Ty(...);   // or slot.emplace(...)
+                 slot.commit();               // One time exchange.
+             data() and emplace() need a slot that is not empty, commit() on an empty slot returns false.
+             A slot that is destroyed without commit returns its node to the pool.
+             The slot never destroys a value: abandon it before constructing one, or destroy the value yourself.
+        */
+        class prepared_slot {
+        public:
+            prepared_slot() noexcept = default;
+
+            prepared_slot(prepared_slot&& other) noexcept
+                : queue_(std::exchange(other.queue_, nullptr)), node_(std::exchange(other.node_, nullptr)) {}
+
+            prepared_slot& operator=(prepared_slot&& other) noexcept {
+                if (this != &other) {
+                    abandon();
+                    queue_ = std::exchange(other.queue_, nullptr);
+                    node_  = std::exchange(other.node_, nullptr);
+                }
+                return *this;
+            }
+
+            ~prepared_slot() {
+                abandon();
+            }
+
+            // Empty if try_prepare found no node, or after commit / abandon.
+            explicit operator bool() const noexcept {
+                return node_ != nullptr;
+            }
+
+            // Raw storage of sizeof(Ty) bytes, aligned for Ty. The slot must not be empty.
+            DAKING_ALWAYS_INLINE void* data() const noexcept {
+                return std::addressof(node_->value_);
+            }
+
+            template <typename...Args>
+            DAKING_ALWAYS_INLINE reference emplace(Args&&... args) {
+                _construct_value(node_, std::forward<Args>(args)...);
+                return _value(node_);
+            }
+
+            DAKING_ALWAYS_INLINE bool commit() noexcept {
+                // The value must have been constructed. If the queue was closed meanwhile, it is destroyed here,
+                // or with the queue if close() raced with the link.
+                if (!node_) DAKING_UNLIKELY {
+                    return false; // prepare() after close(), or already committed.
+                }
+                bool linked = queue_->_try_link_segment(node_, node_, 1);
+                queue_ = nullptr;
+                node_  = nullptr;
+                return linked;
+            }
+
+            DAKING_ALWAYS_INLINE void abandon() noexcept {
+                if (node_) {
+                    pool_t::_deallocate(node_);
+                    queue_ = nullptr;
+                    node_  = nullptr;
+                }
+            }
+
+        private:
+            friend class MPSC_queue;
+
+            prepared_slot(MPSC_queue* queue, node_t* node) noexcept : queue_(queue), node_(node) {}
+
+            MPSC_queue* queue_ = nullptr;
+            node_t*     node_  = nullptr;
+        };
+
+        /*
+             n nodes linked privately, published together by commit_all.
+                 auto batch = queue.prepare_n(n);
+                 for (void* storage : batch) new (storage) Ty(...);
+                 batch.commit_all();          // One time exchange for all n.
+             Same rules as prepared_slot: every value must be constructed before commit_all,
+             abandoning returns all n nodes to the pool and destroys nothing.
+        */
+        class prepared_batch {
+        public:
+            class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type        = void*;
+                using difference_type   = std::ptrdiff_t;
+                using pointer           = void**;
+                using reference         = void*;
+
+                iterator() noexcept = default;
+
+                reference operator*() const noexcept {
+                    return std::addressof(node_->value_);
+                }
+
+                iterator& operator++() noexcept {
+                    node_ = node_->next_.load(std::memory_order_relaxed);
+                    return *this;
+                }
+
+                iterator operator++(int) noexcept {
+                    iterator old = *this;
+                    ++*this;
+                    return old;
+                }
+
+                bool operator==(const iterator& other) const noexcept {
+                    return node_ == other.node_;
+                }
+
+                bool operator!=(const iterator& other) const noexcept {
+                    return node_ != other.node_;
+                }
+
+            private:
+                friend class prepared_batch;
+
+                explicit iterator(node_t* node) noexcept : node_(node) {}
+
+                node_t* node_ = nullptr;
+            };
+
+            prepared_batch() noexcept = default;
+
+            prepared_batch(prepared_batch&& other) noexcept
+                : queue_(std::exchange(other.queue_, nullptr)), first_(std::exchange(other.first_, nullptr)),
+                  last_(std::exchange(other.last_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+            prepared_batch& operator=(prepared_batch&& other) noexcept {
+                if (this != &other) {
+                    abandon();
+                    queue_ = std::exchange(other.queue_, nullptr);
+                    first_ = std::exchange(other.first_, nullptr);
+                    last_  = std::exchange(other.last_, nullptr);
+                    size_  = std::exchange(other.size_, 0);
+                }
+                return *this;
+            }
+
+            ~prepared_batch() {
+                abandon();
+            }
+
+            explicit operator bool() const noexcept {
+                return first_ != nullptr;
+            }
+
+            size_type size() const noexcept {
+                return size_;
+            }
+
+            iterator begin() const noexcept {
+                return iterator(first_);
+            }
+
+            iterator end() const noexcept {
+                return iterator();
+            }
+
+            DAKING_ALWAYS_INLINE bool commit_all() noexcept {
+                // Same as prepared_slot::commit, all or nothing.
+                bool linked = !first_ || queue_->_try_link_segment(first_, last_, size_);
+                _reset();
+                return linked;
+            }
+
+            DAKING_ALWAYS_INLINE void abandon() noexcept {
+                while (first_) {
+                    pool_t::_deallocate(std::exchange(first_, first_->next_.load(std::memory_order_relaxed)));
+                }
+                _reset();
+            }
+
+        private:
+            friend class MPSC_queue;
+
+            prepared_batch(MPSC_queue* queue, node_t* first, node_t* last, size_type size) noexcept
+                : queue_(queue), first_(first), last_(last), size_(size) {}
+
+            void _reset() noexcept {
+                queue_ = nullptr;
+                first_ = last_ = nullptr;
+                size_  = 0;
+            }
+
+            MPSC_queue* queue_ = nullptr;
+            node_t*     first_ = nullptr;
+            node_t*     last_  = nullptr;
+            size_type   size_  = 0;
+        };
+
+        /*
+             The right to touch tail_, handed from thread to thread with acquire/release.
+                 auto lease = queue.acquire_consumer();   // On the core that consumes now.
+                 lease.try_dequeue_bulk(out, 64);
+                 lease.release();                         // Another thread may acquire it next.
+             Several leases may be held at once: then each call claims the consumer side with a CAS on
+             the claim word next to tail_, takes up to n elements and gives it back, so helpers split a backlog in batches.
+             While only one lease is held, it keeps the claim between calls, a call is the plain try_dequeue loop
+             plus one relaxed load of the lease count. A helper that joins gets in at the holder's next call,
+             or at once if the last call found nothing. Use either leases or the plain consumer functions, not both.
+        */
+        class consumer_lease {
+        public:
+            consumer_lease() noexcept = default;
+
+            consumer_lease(consumer_lease&& other) noexcept
+                : queue_(std::exchange(other.queue_, nullptr)), claimed_(std::exchange(other.claimed_, false)) {}
+
+            consumer_lease& operator=(consumer_lease&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    queue_   = std::exchange(other.queue_, nullptr);
+                    claimed_ = std::exchange(other.claimed_, false);
+                }
+                return *this;
+            }
+
+            ~consumer_lease() {
+                release();
+            }
+
+            explicit operator bool() const noexcept {
+                return queue_ != nullptr;
+            }
+
+            template <typename T>
+            DAKING_ALWAYS_INLINE bool try_dequeue(T& value) {
+                return try_dequeue_status(value) == MPSC_dequeue_status::dequeued;
+            }
+
+            template <typename T>
+            DAKING_ALWAYS_INLINE MPSC_dequeue_status try_dequeue_status(T& value) {
+                _claim();
+                MPSC_dequeue_status status = queue_->try_dequeue_status(value);
+                _unclaim(status == MPSC_dequeue_status::dequeued);
+                return status;
+            }
+
+            template <typename OutputIt>
+            DAKING_ALWAYS_INLINE size_type try_dequeue_bulk(OutputIt it, size_type n) {
+                // One claim for the whole batch.
+                _claim();
+                size_type count = queue_->try_dequeue_bulk(it, n);
+                _unclaim(count != 0);
+                return count;
+            }
+
+            bool empty() {
+                _claim();
+                bool result = queue_->empty();
+                _unclaim(!result);
+                return result;
+            }
+
+            // Give the claim back now instead of at the next call, e.g. before running something long.
+            DAKING_ALWAYS_INLINE void unclaim() noexcept {
+                if (claimed_) {
+                    queue_->consumer_claim_.store(false, std::memory_order_release);
+                    claimed_ = false;
+                }
+            }
+
+            void release() noexcept {
+                if (queue_) {
+                    if (claimed_) {
+                        queue_->consumer_claim_.store(false, std::memory_order_release);
+                        claimed_ = false;
+                    }
+                    queue_->consumer_lease_count_.fetch_sub(1, std::memory_order_release);
+                    queue_ = nullptr;
+                }
+            }
+
+        private:
+            friend class MPSC_queue;
+
+            explicit consumer_lease(MPSC_queue* queue) noexcept : queue_(queue) {}
+
+            DAKING_ALWAYS_INLINE void _claim() noexcept {
+                if (claimed_) DAKING_LIKELY {
+                    return;
+                }
+                bool expected = false;
+                while (!queue_->consumer_claim_.compare_exchange_weak(expected, true,
+                    std::memory_order_acquire, std::memory_order_relaxed)) {
+                    while (queue_->consumer_claim_.load(std::memory_order_relaxed)) {
+                        std::this_thread::yield();
+                    }
+                    expected = false;
+                }
+                claimed_ = true;
+            }
+
+            DAKING_ALWAYS_INLINE void _unclaim(bool got_any) noexcept {
+                if (!got_any || queue_->consumer_lease_count_.load(std::memory_order_relaxed) != 1) DAKING_UNLIKELY {
+                    queue_->consumer_claim_.store(false, std::memory_order_release);
+                    claimed_ = false;
+                }
+            }
+
+            MPSC_queue* queue_   = nullptr;
+            bool        claimed_ = false;
+        };
+
+        /*
+             The calling thread's thread-local pool, looked up once instead of at every node:
+                 MPSC_queue<Order>::producer_token token(queue);    // On the producer thread.
+                 queue.enqueue(token, order);                        // No thread_local access.
+             A token belongs to the thread that built it and must not outlive that thread.
+             It works with every queue of the same type (they share the pool), and mixes freely with the plain overloads.
+        */
+        class producer_token {
+        public:
+            explicit producer_token(MPSC_queue&) noexcept
+                : local_(&pool_t::_get_thread_hook().local()) {}
+
+        private:
+            friend class MPSC_queue;
+
+            thread_local_t* local_;
+        };
+
+        // Same for the consumer: try_dequeue(token, value) gives nodes back without the thread_local access.
+        class consumer_token {
+        public:
+            explicit consumer_token(MPSC_queue&) noexcept
+                : local_(&pool_t::_get_thread_hook().local()) {}
+
+        private:
+            friend class MPSC_queue;
+
+            thread_local_t* local_;
+        };
+
+        MPSC_queue() : MPSC_queue(allocator_type()) {}
+
+        MPSC_queue(const allocator_type& alloc) {
+            /* Alloc<Ty> -> Alloc<...>, which means Alloc should have a template constructor */
+            pool_t::_attach(pool_alloc_t(alloc));
+
+            node_t* dummy = pool_t::_allocate();
+            try {
+                // Taken now, so that close() never allocates: it cannot wait on the node budget or throw.
+                close_marker_ = pool_t::_allocate();
+            }
+            catch (...) {
+                pool_t::_deallocate(dummy);
+                pool_t::_detach();
+                throw;
+            }
+            tail_ = dummy;
+            head_.store(dummy, std::memory_order_release);
+        }
+
+        explicit MPSC_queue(size_type initial_global_chunk_count, const allocator_type& alloc = allocator_type()) 
+            : MPSC_queue(alloc) {
+            reserve_global_chunk(initial_global_chunk_count);
+        }
+
+        ~MPSC_queue() {
+            // Elements linked behind the marker raced with close(), their enqueue returned false.
+            if (!is_closed()) {
+                pool_t::_deallocate(close_marker_); // Never linked.
+            }
+            node_t* next = tail_->next_.load(std::memory_order_acquire);
+            while (next) {
+                if (next != close_marker_) {
+                    _destroy_value(next);
+                }
+                pool_t::_deallocate(std::exchange(tail_, next));
+                next = tail_->next_.load(std::memory_order_acquire);
+            }
+            pool_t::_deallocate(tail_);
+            pool_t::_detach();
+        }
+
+        MPSC_queue(const MPSC_queue&)            = delete;
+        MPSC_queue(MPSC_queue&&)                 = delete;
+        MPSC_queue& operator=(const MPSC_queue&) = delete;
+        MPSC_queue& operator=(MPSC_queue&&)      = delete;
+
+        // The enqueue family returns false, and constructs nothing, once the queue is closed.
+        template <typename...Args>
+        DAKING_ALWAYS_INLINE bool emplace(Args&&... args) {
+            if (is_closed()) DAKING_UNLIKELY {
+                return false;
+            }
+            node_t* new_node = pool_t::_allocate();
+            _construct_value(new_node, std::forward<Args>(args)...);
+            return _link_segment(new_node, new_node, 1);
+        }
+
+        template <typename...Args>
+        DAKING_ALWAYS_INLINE bool try_emplace(Args&&... args) {
+            // Never blocks and never grows the pool beyond the node budget.
+            if (is_closed()) DAKING_UNLIKELY {
+                return false;
+            }
+            node_t* new_node = pool_t::_try_allocate();
+            if (!new_node) DAKING_UNLIKELY {
+                return false;
+            }
+            _construct_value(new_node, std::forward<Args>(args)...);
+            return _link_segment(new_node, new_node, 1);
+        }
+
+        DAKING_ALWAYS_INLINE bool enqueue(const_reference value) {
+            return emplace(value);
+        }
+
+        DAKING_ALWAYS_INLINE bool enqueue(value_type&& value) {
+            return emplace(std::move(value));
+        }
+
+        template <typename...Args>
+        DAKING_ALWAYS_INLINE bool emplace(producer_token& token, Args&&... args) {
+            if (is_closed()) DAKING_UNLIKELY {
+                return false;
+            }
+            node_t* new_node = pool_t::_allocate(*token.local_);
+            _construct_value(new_node, std::forward<Args>(args)...);
+            return _link_segment(new_node, new_node, 1);
+        }
+
+        DAKING_ALWAYS_INLINE bool enqueue(producer_token& token, const_reference value) {
+            return emplace(token, value);
+        }
+
+        DAKING_ALWAYS_INLINE bool enqueue(producer_token& token, value_type&& value) {
+            return emplace(token, std::move(value));
+        }
+
+        DAKING_ALWAYS_INLINE bool try_enqueue(const_reference value) {
+            return try_emplace(value);
+        }
+
+        DAKING_ALWAYS_INLINE bool try_enqueue(value_type&& value) {
+            return try_emplace(std::move(value));
+        }
+
+        DAKING_ALWAYS_INLINE bool enqueue_bulk(const_reference value, size_type n) {
+            // N times thread_local operation, One time CAS operation.
+            // So it is more efficient than N times enqueue.
+            if (n == 0 || is_closed()) DAKING_UNLIKELY {
+                return n == 0;
+            }
+
+            node_t* first_new_node = pool_t::_allocate();
+            node_t* prev_node = first_new_node;
+            _construct_value(first_new_node, value);
+            for (size_type i = 1; i < n; i++) {
+                node_t* new_node = pool_t::_allocate();
+                _construct_value(new_node, value);
+                prev_node->next_.store(new_node, std::memory_order_relaxed);
+                prev_node = new_node;
+            }
+            return _link_segment(first_new_node, prev_node, n);
+        }
+
+		template <typename InputIt>
+        DAKING_ALWAYS_INLINE bool enqueue_bulk(InputIt it, size_type n) {
+			// Enqueue n elements from input iterator.
+            if (n == 0 || is_closed()) DAKING_UNLIKELY {
+                return n == 0; // it is untouched
+            }
+            return _enqueue_bulk(pool_t::_get_thread_hook().local(), it, n);
+		}
+
+        template <typename InputIt>
+        DAKING_ALWAYS_INLINE bool enqueue_bulk(producer_token& token, InputIt it, size_type n) {
+            if (n == 0 || is_closed()) DAKING_UNLIKELY {
+                return n == 0;
+            }
+            return _enqueue_bulk(*token.local_, it, n);
+        }
+
+        template <typename ForwardIt, std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag,
+            typename std::iterator_traits<ForwardIt>::iterator_category>, int> = 0>
+        DAKING_ALWAYS_INLINE bool enqueue_bulk(ForwardIt begin, ForwardIt end) {
+            return enqueue_bulk(begin, (size_type)std::distance(begin, end));
+        }
+
+        DAKING_ALWAYS_INLINE bool try_enqueue_bulk(const_reference value, size_type n) {
+            // All or nothing: nodes are taken first, values are constructed only if all n nodes are available.
+            if (n == 0 || is_closed()) DAKING_UNLIKELY {
+                return n == 0;
+            }
+
+            node_t* first_new_node;
+            node_t* last_new_node;
+            if (!pool_t::_try_allocate_segment(n, first_new_node, last_new_node)) DAKING_UNLIKELY {
+                return false;
+            }
+            for (node_t* node = first_new_node; node; node = node->next_.load(std::memory_order_relaxed)) {
+                _construct_value(node, value);
+            }
+            return _link_segment(first_new_node, last_new_node, n);
+        }
+
+        template <typename InputIt>
+        DAKING_ALWAYS_INLINE bool try_enqueue_bulk(InputIt it, size_type n) {
+            static_assert(std::is_base_of_v<std::input_iterator_tag,
+                typename std::iterator_traits<InputIt>::iterator_category>,
+                "Iterator must be at least input iterator.");
+            static_assert(std::is_same_v<typename std::iterator_traits<InputIt>::value_type, value_type>,
+                "The value type of iterator must be same as MPSC_queue::value_type.");
+            if (n == 0 || is_closed()) DAKING_UNLIKELY {
+                return n == 0;
+            }
+
+            node_t* first_new_node;
+            node_t* last_new_node;
+            if (!pool_t::_try_allocate_segment(n, first_new_node, last_new_node)) DAKING_UNLIKELY {
+                return false; // it is untouched
+            }
+            for (node_t* node = first_new_node; node; node = node->next_.load(std::memory_order_relaxed)) {
+                _construct_value(node, *it);
+                ++it;
+            }
+            return _link_segment(first_new_node, last_new_node, n);
+        }
+
+        template <typename ForwardIt, std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag,
+            typename std::iterator_traits<ForwardIt>::iterator_category>, int> = 0>
+        DAKING_ALWAYS_INLINE bool try_enqueue_bulk(ForwardIt begin, ForwardIt end) {
+            return try_enqueue_bulk(begin, (size_type)std::distance(begin, end));
+        }
+
+        DAKING_ALWAYS_INLINE prepared_slot prepare() {
+            // Take a node now, publish it later with commit (see prepared_slot). Empty slot if the queue is closed.
+            if (is_closed()) DAKING_UNLIKELY {
+                return prepared_slot();
+            }
+            return prepared_slot(this, pool_t::_allocate());
+        }
+
+        DAKING_ALWAYS_INLINE prepared_slot try_prepare() {
+            // Empty slot if the node budget does not allow one more node.
+            if (is_closed()) DAKING_UNLIKELY {
+                return prepared_slot();
+            }
+            node_t* node = pool_t::_try_allocate();
+            return node ? prepared_slot(this, node) : prepared_slot();
+        }
+
+        DAKING_ALWAYS_INLINE prepared_batch prepare_n(size_type n) {
+            if (n == 0 || is_closed()) DAKING_UNLIKELY {
+                return prepared_batch();
+            }
+
+            node_t* first_new_node = pool_t::_allocate();
+            node_t* prev_node = first_new_node;
+            for (size_type i = 1; i < n; i++) {
+                node_t* new_node = pool_t::_allocate();
+                prev_node->next_.store(new_node, std::memory_order_relaxed);
+                prev_node = new_node;
+            }
+            return prepared_batch(this, first_new_node, prev_node, n);
+        }
+
+        DAKING_ALWAYS_INLINE prepared_batch try_prepare_n(size_type n) {
+            // All or nothing, like try_enqueue_bulk.
+            node_t* first_new_node;
+            node_t* last_new_node;
+            if (n == 0 || is_closed() || !pool_t::_try_allocate_segment(n, first_new_node, last_new_node)) DAKING_UNLIKELY {
+                return prepared_batch();
+            }
+            return prepared_batch(this, first_new_node, last_new_node, n);
+        }
+
+        template <typename T>
+        DAKING_ALWAYS_INLINE bool try_dequeue(T& value) 
+            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> && 
+                std::is_nothrow_destructible_v<value_type>) {
+            static_assert(std::is_assignable_v<T&, value_type&&>);
+            return try_dequeue_status(value) == MPSC_dequeue_status::dequeued;
+        }
+
+        template <typename T>
+        DAKING_ALWAYS_INLINE MPSC_dequeue_status try_dequeue_status(T& value)
+            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> &&
+                std::is_nothrow_destructible_v<value_type>) {
+            // Like try_dequeue, but tells an empty queue from a closed and drained one.
+            return _try_dequeue_status(value);
+        }
+
+        template <typename T>
+        DAKING_ALWAYS_INLINE bool try_dequeue(consumer_token& token, T& value)
+            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> &&
+                std::is_nothrow_destructible_v<value_type>) {
+            return _try_dequeue_status(value, *token.local_) == MPSC_dequeue_status::dequeued;
+        }
+
+        template <typename T>
+        DAKING_ALWAYS_INLINE MPSC_dequeue_status try_dequeue_status(consumer_token& token, T& value)
+            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> &&
+                std::is_nothrow_destructible_v<value_type>) {
+            return _try_dequeue_status(value, *token.local_);
+        }
+
+        template <typename OutputIt>
+        DAKING_ALWAYS_INLINE size_type try_dequeue_bulk(consumer_token& token, OutputIt it, size_type n)
+            noexcept(std::is_nothrow_assignable_v<decltype(*it), value_type&&> &&
+                std::is_nothrow_destructible_v<value_type> && noexcept(++it)) {
+            size_type count = 0;
+            while (count < n && try_dequeue(token, *it)) {
+                ++count;
+                ++it;
+            }
+            return count;
+        }
+
+        template <typename OutputIt>
+        DAKING_ALWAYS_INLINE size_type try_dequeue_bulk(OutputIt it, size_type n) 
             noexcept(std::is_nothrow_assignable_v<decltype(*it), value_type&&> && 
                 std::is_nothrow_destructible_v<value_type> && noexcept(++it)) {
             static_assert(
@@ -577,189 +2115,855 @@ namespace daking {
                 std::is_same_v<typename std::iterator_traits<OutputIt>::iterator_category, std::output_iterator_tag>,
                 "Iterator must be at least output iterator or forward iterator.");
 
-			size_type count = 0;
-            while (count < n && try_dequeue(*it)) {
-                ++count;
-                ++it;
+			size_type count = 0;
+            while (count < n && try_dequeue(*it)) {
+                ++count;
+                ++it;
+            }
+			return count;
+        }
+
+        template <typename ForwardIt, std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag,
+            typename std::iterator_traits<ForwardIt>::iterator_category>, int> = 0>
+        DAKING_ALWAYS_INLINE size_type try_dequeue_bulk(ForwardIt begin, ForwardIt end)
+            noexcept(std::is_nothrow_assignable_v<decltype(*begin), value_type&&> &&
+                std::is_nothrow_destructible_v<value_type> && noexcept(++begin)) {
+            return try_dequeue_bulk(begin, (size_type)std::distance(begin, end));
+        }
+
+        template <typename T>
+        bool dequeue(T& result) 
+            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> && 
+                std::is_nothrow_destructible_v<value_type>) {
+            // Returns false once the queue is closed and drained, close() wakes a waiting consumer.
+            // Parks on a futex (Linux) or a condition variable, see _park. Not for consumer leases.
+            static_assert(std::is_assignable_v<T&, value_type&&>);
+
+            while (true) {
+                switch (try_dequeue_status(result)) {
+                case MPSC_dequeue_status::dequeued:
+                    return true;
+                case MPSC_dequeue_status::closed:
+                    return false;
+                default:
+                    if constexpr (polls) {
+                        std::this_thread::yield(); // Producers do not wake.
+                    }
+                    else {
+                        _park();
+                    }
+                }
+            }
+        }
+
+		template <typename OutputIt>
+        size_type dequeue_bulk(OutputIt it, size_type n)
+            noexcept(std::is_nothrow_assignable_v<decltype(*it), value_type&&> &&
+                std::is_nothrow_destructible_v<value_type> && noexcept(++it)) {
+            static_assert(
+                (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<OutputIt>::iterator_category> &&
+                std::is_assignable_v<typename std::iterator_traits<OutputIt>::reference, value_type>) ||
+                std::is_same_v<typename std::iterator_traits<OutputIt>::iterator_category, std::output_iterator_tag>,
+                "Iterator must be at least output iterator or forward iterator.");
+
+            // Less than n only if the queue was closed and drained.
+            size_type count = 0;
+            while (count < n) {
+                if (dequeue(*it)) {
+                    ++count;
+                    ++it;
+                }
+                else {
+                    break;
+                }
+			}
+            return count;
+        }
+
+        template <typename ForwardIt, std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag,
+            typename std::iterator_traits<ForwardIt>::iterator_category>, int> = 0>
+        DAKING_ALWAYS_INLINE size_type dequeue_bulk(ForwardIt begin, ForwardIt end)
+            noexcept(std::is_nothrow_assignable_v<decltype(*begin), value_type&&> &&
+                std::is_nothrow_destructible_v<value_type> && noexcept(++begin)) {
+            return dequeue_bulk(begin, (size_type)std::distance(begin, end));
+        }
+
+        DAKING_ALWAYS_INLINE bool empty() const noexcept {
+            // The close marker does not count as an element, nor what raced with close() behind it.
+            node_t* next = tail_->next_.load(std::memory_order_acquire);
+            return next == nullptr || next == close_marker_;
+		}
+
+        template <bool Enabled = tracks_size, std::enable_if_t<Enabled, int> = 0>
+        size_type size_apprx() const noexcept {
+            // MPSC_track_size: exact when no thread enqueues or dequeues, otherwise a recent size.
+            size_type dequeued = this->dequeued_count_.load(std::memory_order_relaxed);
+            size_type enqueued = this->enqueued_count_.load(std::memory_order_relaxed);
+            return enqueued > dequeued ? enqueued - dequeued : 0;
+        }
+
+        template <bool Enabled = collects_stats, std::enable_if_t<Enabled, int> = 0>
+        MPSC_queue_stats stats() const noexcept {
+            // MPSC_collect_stats: relaxed counters, each one exact once the queue is quiet.
+            MPSC_queue_stats result;
+            result.enqueued_count_      = this->enqueued_count_.load(std::memory_order_relaxed);
+            result.dequeued_count_      = this->dequeued_count_.load(std::memory_order_relaxed);
+            result.empty_dequeue_count_ = this->empty_dequeue_count_.load(std::memory_order_relaxed);
+            return result;
+        }
+
+        // Never fails, the lease shares the consumer side with the leases already held (see consumer_lease).
+        consumer_lease acquire_consumer() noexcept {
+            consumer_lease_count_.fetch_add(1, std::memory_order_acq_rel);
+            return consumer_lease(this);
+        }
+
+        // Empty lease if any lease is held, for a thread that wants to be the only consumer.
+        consumer_lease try_acquire_consumer() noexcept {
+            std::uint32_t expected = 0;
+            if (!consumer_lease_count_.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+                return consumer_lease();
+            }
+            return consumer_lease(this);
+        }
+
+        /*
+             Any thread may close the queue, once. From then on the enqueue family returns false,
+             and the consumer gets everything enqueued before, then MPSC_dequeue_status::closed (dequeue returns false).
+             Producers only read a flag on the cache line of head_ they are about to write anyway.
+             close() links a marker node behind the last element, which also wakes a consumer blocked in dequeue.
+             The marker is taken when the queue is constructed, so close() never allocates, waits or throws,
+             even with the node budget used up.
+             An enqueue that passed the check just before close() re-checks after linking: true means its elements
+             are ahead of the marker and will be delivered. False means they may be behind it, where the consumer
+             stops, and they are destroyed with the queue (a false enqueue may still be delivered, never a true one dropped).
+        */
+        void close() noexcept {
+            if (closed_.exchange(true, std::memory_order_seq_cst)) {
+                return;
+            }
+            _link_segment(close_marker_, close_marker_, 0);
+        }
+
+        DAKING_ALWAYS_INLINE bool is_closed() const noexcept {
+            return closed_.load(std::memory_order_relaxed);
+        }
+
+        DAKING_ALWAYS_INLINE static size_type global_node_size_apprx() noexcept {
+            return pool_t::node_count();
+        }
+
+        DAKING_ALWAYS_INLINE static bool reserve_global_chunk(size_type chunk_count, bool touch_pages = false) {
+            // touch_pages: write every OS page of the new nodes, so that no producer takes a page fault later.
+			return pool_t::reserve_chunk(chunk_count, touch_pages);
+        }
+
+        static bool prepare_thread(size_type chunk_count = 1) {
+            // Warm up the calling thread: register it (the only mutex a thread ever takes for itself),
+            // and move chunk_count chunks into its thread-local pool, so that the next chunk_count * ThreadLocalCapacity
+            // allocations of this thread touch neither the global chunk stack nor the global mutex.
+            // Returns false if no instance is alive or the node budget does not allow chunk_count chunks.
+            return pool_t::prepare_thread(chunk_count);
+        }
+
+        static void set_global_growth_policy(MPSC_growth_policy policy) {
+            pool_t::set_growth_policy(policy);
+        }
+
+        static MPSC_growth_policy global_growth_policy() {
+            return pool_t::growth_policy();
+        }
+
+        // What the pool keeps once the last instance is destroyed, see MPSC_retention_policy.
+        static void set_global_retention_policy(MPSC_retention_policy policy) {
+            pool_t::set_retention_policy(policy);
+        }
+
+        static MPSC_retention_policy global_retention_policy() {
+            return pool_t::retention_policy();
+        }
+
+        // Free every page of the pool now. Only while no instance is alive, returns whether anything was freed.
+        static bool release_global_pool() {
+            return pool_t::release();
+        }
+
+        // Apply the retention policy now: shrink to keep_up_to(n), or release once idle for release_after_idle(t).
+        // Only while no instance is alive, returns whether anything was freed. Call it from a housekeeping timer.
+        static bool trim_global_pool() {
+            return pool_t::trim();
+        }
+
+        // Hard limit of nodes owned by the global pool, rounded down to whole chunks, 0 means unlimited.
+        // When it is used up, enqueue calls handler(node_count): true retries, false throws std::bad_alloc.
+        // Without a handler, enqueue sleeps until a chunk is freed or the budget changes. Nodes cached by a thread-local pool
+        // are not freed while their thread lives: the budget must exceed the consumer's cache plus one chunk per producer,
+        // and the queues' dummy and close marker nodes, or enqueue may sleep forever.
+        // With MPSC_shared_pool the budget and the growth policy belong to the shared pool.
+        static void set_global_node_budget(size_type max_node_count, MPSC_overflow_handler handler = nullptr) {
+            pool_t::set_node_budget(max_node_count, handler);
+        }
+
+        static void set_global_byte_budget(size_type max_byte_count, MPSC_overflow_handler handler = nullptr) {
+            set_global_node_budget(max_byte_count / sizeof(node_t), handler);
+        }
+
+        static size_type global_node_budget() {
+            return pool_t::node_budget();
+        }
+
+        // Approximate footprint of the global pool, see MPSC_pool_stats. Takes the global mutex.
+        static MPSC_pool_stats global_pool_stats() {
+            return pool_t::stats();
+        }
+
+    private:
+        template <typename...Args>
+        DAKING_ALWAYS_INLINE static void _construct_value(node_t* node, Args&&... args) {
+            // A shared node only holds raw storage of the right size class, Ty is placed into it.
+            altraits_node_t::construct(pool_t::_get_global_manager(),
+                reinterpret_cast<value_type*>(std::addressof(node->value_)), std::forward<Args>(args)...);
+        }
+
+        DAKING_ALWAYS_INLINE static value_type& _value(node_t* node) noexcept {
+            if constexpr (shares_pool) {
+                return *std::launder(reinterpret_cast<value_type*>(std::addressof(node->value_)));
+            }
+            else {
+                return node->value_;
             }
-			return count;
         }
 
-        template <typename ForwardIt, std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag,
-            typename std::iterator_traits<ForwardIt>::iterator_category>, int> = 0>
-        DAKING_ALWAYS_INLINE size_type try_dequeue_bulk(ForwardIt begin, ForwardIt end)
-            noexcept(std::is_nothrow_assignable_v<decltype(*begin), value_type&&> &&
-                std::is_nothrow_destructible_v<value_type> && noexcept(++begin)) {
-            return try_dequeue_bulk(begin, (size_type)std::distance(begin, end));
+        DAKING_ALWAYS_INLINE static void _destroy_value(node_t* node) noexcept {
+            altraits_node_t::destroy(pool_t::_get_global_manager(), std::addressof(_value(node)));
         }
 
-#if DAKING_HAS_CXX20_OR_ABOVE
-        template <typename T>
-        void dequeue(T& result) 
-            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> && 
+        template <typename T, typename... Local>
+        DAKING_ALWAYS_INLINE MPSC_dequeue_status _try_dequeue_status(T& value, Local&... local)
+            noexcept(std::is_nothrow_assignable_v<T&, value_type&&> &&
                 std::is_nothrow_destructible_v<value_type>) {
+            // local: the consumer_token's thread-local pool, or nothing for the thread_local lookup.
             static_assert(std::is_assignable_v<T&, value_type&&>);
 
-            while (true) {
-                if (try_dequeue(result)) {
-                    return;
+            node_t* next = tail_->next_.load(std::memory_order_acquire);
+            if (next == close_marker_) DAKING_UNLIKELY {
+                // The consumer stops at the marker: what follows it raced with close(), and its enqueue returned false.
+                return MPSC_dequeue_status::closed;
+            }
+            if (next) DAKING_LIKELY {
+                value = std::move(_value(next));
+                _destroy_value(next);
+                pool_t::_deallocate(local..., std::exchange(tail_, next));
+                if constexpr (counts_elements) {
+                    // Consumer only (leases hand the consumer side over with acquire/release), no RMW needed.
+                    this->dequeued_count_.store(this->dequeued_count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                }
+                return MPSC_dequeue_status::dequeued;
+            }
+            else {
+                if constexpr (collects_stats) {
+                    this->empty_dequeue_count_.store(this->empty_dequeue_count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
                 }
-                tail_->next_.wait(nullptr, std::memory_order_acquire);
+                return MPSC_dequeue_status::empty;
             }
         }
 
-		template <typename OutputIt>
-        void dequeue_bulk(OutputIt it, size_type n)
-            noexcept(std::is_nothrow_assignable_v<decltype(*it), value_type&&> &&
-                std::is_nothrow_destructible_v<value_type> && noexcept(++it)) {
-            static_assert(
-                std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<OutputIt>::iterator_category> &&
-                std::is_assignable_v<typename std::iterator_traits<OutputIt>::reference, value_type> ||
-                std::is_same_v<typename std::iterator_traits<OutputIt>::iterator_category, std::output_iterator_tag>,
-                "Iterator must be at least output iterator or forward iterator.");
+        template <typename InputIt>
+        DAKING_ALWAYS_INLINE bool _enqueue_bulk(thread_local_t& local, InputIt it, size_type n) {
+            static_assert(std::is_base_of_v<std::input_iterator_tag,
+                typename std::iterator_traits<InputIt>::iterator_category>,
+                "Iterator must be at least input iterator.");
+            static_assert(std::is_same_v<typename std::iterator_traits<InputIt>::value_type, value_type>,
+                "The value type of iterator must be same as MPSC_queue::value_type.");
+            node_t* first_new_node = pool_t::_allocate(local);
+            node_t* prev_node = first_new_node;
+            _construct_value(first_new_node, *it);
+            ++it;
+            for (size_type i = 1; i < n; i++) {
+                node_t* new_node = pool_t::_allocate(local);
+                _construct_value(new_node, *it);
+                prev_node->next_.store(new_node,  std::memory_order_relaxed);
+                prev_node = new_node;
+                ++it;
+            }
+            return _link_segment(first_new_node, prev_node, n);
+        }
 
-            size_type count = 0;
-            while (count < n) {
-                if (try_dequeue(*it)) {
-                    ++count;
-                    ++it;
+        DAKING_ALWAYS_INLINE bool _link_segment(node_t* first, node_t* last, size_type count) noexcept {
+            // count: elements in the segment, only read by MPSC_collect_stats and MPSC_track_size.
+            // Returns false if the segment may be behind the close marker, it is then never dequeued.
+            if constexpr (counts_elements) {
+                this->enqueued_count_.fetch_add(count, std::memory_order_relaxed); // Before the link, size_apprx never sees more out than in.
+            }
+            node_t* old_head = head_.exchange(last, std::memory_order_seq_cst); // An xchg like acq_rel on x86, the fence of the parking rule.
+            // close() sets closed_ before its exchange, all seq_cst: if closed_ is still false here, the marker comes after us.
+            // A plain load on x86, of the line the exchange just wrote.
+            bool ahead_of_marker = !closed_.load(std::memory_order_seq_cst);
+            old_head->next_.store(first, std::memory_order_release);
+            if constexpr (!polls) {
+                // Pairs with _park: either the consumer sees the new head_, or we see it parked. Only then a syscall.
+                if (consumer_parked_.load(std::memory_order_seq_cst)) DAKING_UNLIKELY {
+                    _wake_consumer();
                 }
-                else {
-                    tail_->next_.wait(nullptr, std::memory_order_acquire);
+            }
+            return ahead_of_marker;
+        }
+
+        void _park() noexcept {
+            // The consumer found the queue empty. Announce, re-check, sleep: the executor's rule, with head_ as the re-check.
+            std::uint32_t seen = wake_word_.load();
+            consumer_parked_.store(true, std::memory_order_seq_cst);
+            if (head_.load(std::memory_order_seq_cst) != tail_) {
+                // Something is linked, or its producer is between the exchange and the store of next_.
+                consumer_parked_.store(false, std::memory_order_relaxed);
+                std::this_thread::yield();
+                return;
+            }
+            wake_word_.wait(seen);
+            consumer_parked_.store(false, std::memory_order_relaxed);
+        }
+
+        void _wake_consumer() noexcept {
+            // Of the producers that saw the consumer parked, one makes the syscall.
+            if (consumer_parked_.exchange(false, std::memory_order_acq_rel)) {
+                wake_word_.wake_one();
+            }
+        }
+
+        DAKING_ALWAYS_INLINE bool _try_link_segment(node_t* first, node_t* last, size_type count) noexcept {
+            // For prepared slots and batches: their values are already constructed.
+            if (is_closed()) DAKING_UNLIKELY {
+                while (first) {
+                    _destroy_value(first);
+                    pool_t::_deallocate(std::exchange(first, first == last ? nullptr : first->next_.load(std::memory_order_relaxed)));
                 }
-			}
+                return false;
+            }
+            return _link_segment(first, last, count);
+        }
+
+        /* MPSC */
+        alignas(align) std::atomic<node_t*>  head_;
+        std::atomic<bool>                    closed_{ false };      /* Same cache line as head_ */
+        std::atomic<bool>                    consumer_parked_{ false }; /* Same cache line as head_, read by every enqueue */
+        alignas(align) node_t*               tail_;
+        node_t*                              close_marker_ = nullptr; /* Taken at construction, linked by close() */
+        std::atomic<std::uint32_t>           consumer_lease_count_{ 0 };
+        std::atomic<bool>                    consumer_claim_{ false };  /* Owner of tail_ among lease holders */
+        detail::MPSC_wait_word               wake_word_;
+    };
+
+    // Embed one hook per queue an object can be in at the same time.
+    struct MPSC_intrusive_hook {
+        std::atomic<MPSC_intrusive_hook*> next_{ nullptr };
+    };
+
+    /*
+         MPSC queue of objects the user already owns: T embeds an MPSC_intrusive_hook, no node pool, no copy.
+         Producers publish exactly like MPSC_queue::emplace (exchange on head_, then store to next_),
+         and a bulk enqueue splices a privately linked segment with one exchange.
+         The consumer follows Vyukov's intrusive algorithm: a stub hook stands in for the dummy node,
+         and is pushed again when the consumer reaches the last element.
+         The queue never owns its elements, an object may be enqueued again (or freed) once it is dequeued.
+    */
+    template <
+        typename T,
+        MPSC_intrusive_hook T::* Hook,
+        std::size_t Align = 64 /* std::hardware_destructive_interference_size */
+    >
+    class MPSC_intrusive_queue {
+    public:
+        using value_type = T;
+        using pointer    = T*;
+        using size_type  = std::size_t;
+        using hook_t     = MPSC_intrusive_hook;
+
+        static constexpr std::size_t align = Align;
+
+        MPSC_intrusive_queue() noexcept : head_(&stub_), tail_(&stub_) {}
+
+        ~MPSC_intrusive_queue() = default; // Elements left behind are simply unlinked, they are not ours.
+
+        MPSC_intrusive_queue(const MPSC_intrusive_queue&)            = delete;
+        MPSC_intrusive_queue(MPSC_intrusive_queue&&)                 = delete;
+        MPSC_intrusive_queue& operator=(const MPSC_intrusive_queue&) = delete;
+        MPSC_intrusive_queue& operator=(MPSC_intrusive_queue&&)      = delete;
+
+        DAKING_ALWAYS_INLINE void enqueue(pointer value) noexcept {
+            hook_t* hook = _hook_of(value);
+            hook->next_.store(nullptr, std::memory_order_relaxed);
+            _link_segment(hook, hook);
+        }
+
+        template <typename InputIt>
+        DAKING_ALWAYS_INLINE void enqueue_bulk(InputIt it, size_type n) noexcept {
+            // Link n objects privately, One time exchange.
+            static_assert(std::is_base_of_v<std::input_iterator_tag,
+                typename std::iterator_traits<InputIt>::iterator_category>,
+                "Iterator must be at least input iterator.");
+            static_assert(std::is_convertible_v<typename std::iterator_traits<InputIt>::value_type, pointer>,
+                "The value type of iterator must be convertible to T*.");
+            if (n == 0) DAKING_UNLIKELY {
+                return;
+            }
+
+            hook_t* first = _hook_of(*it);
+            hook_t* last = first;
+            ++it;
+            for (size_type i = 1; i < n; i++) {
+                hook_t* hook = _hook_of(*it);
+                last->next_.store(hook, std::memory_order_relaxed);
+                last = hook;
+                ++it;
+            }
+            last->next_.store(nullptr, std::memory_order_relaxed);
+            _link_segment(first, last);
         }
 
         template <typename ForwardIt, std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag,
             typename std::iterator_traits<ForwardIt>::iterator_category>, int> = 0>
-        DAKING_ALWAYS_INLINE void dequeue_bulk(ForwardIt begin, ForwardIt end)
-            noexcept(std::is_nothrow_assignable_v<decltype(*begin), value_type&&> &&
-                std::is_nothrow_destructible_v<value_type> && noexcept(++begin)) {
-            dequeue_bulk(begin, (size_type)std::distance(begin, end));
+        DAKING_ALWAYS_INLINE void enqueue_bulk(ForwardIt begin, ForwardIt end) noexcept {
+            enqueue_bulk(begin, (size_type)std::distance(begin, end));
         }
-#endif 
 
-        DAKING_ALWAYS_INLINE bool empty() const noexcept {
-            return tail_->next_.load(std::memory_order_acquire) == nullptr;
-		}
+        DAKING_ALWAYS_INLINE bool try_dequeue(pointer& value) noexcept {
+            hook_t* tail = tail_;
+            hook_t* next = tail->next_.load(std::memory_order_acquire);
+            if (tail == &stub_) {
+                if (!next) {
+                    return false;
+                }
+                // Skip the stub.
+                tail_ = tail = next;
+                next = tail->next_.load(std::memory_order_acquire);
+            }
+            if (next) DAKING_LIKELY {
+                tail_ = next;
+                value = _owner_of(tail);
+                return true;
+            }
+            if (tail != head_.load(std::memory_order_acquire)) {
+                // A producer has exchanged head_ but not linked yet.
+                return false;
+            }
+            // tail is the last element: push the stub behind it, so that tail can be handed out.
+            stub_.next_.store(nullptr, std::memory_order_relaxed);
+            _link_segment(&stub_, &stub_);
+            next = tail->next_.load(std::memory_order_acquire);
+            if (next) {
+                tail_ = next;
+                value = _owner_of(tail);
+                return true;
+            }
+            return false;
+        }
 
-        DAKING_ALWAYS_INLINE static size_type global_node_size_apprx() noexcept {
-            return _is_global_manager_alive() ? _get_global_manager().node_count() : 0;
+        template <typename Func>
+        DAKING_ALWAYS_INLINE size_type drain(Func&& func, size_type max_count = size_type(-1)) {
+            // Hand every visible element (at most max_count) to func(T*), returns the count.
+            size_type count = 0;
+            pointer value;
+            while (count < max_count && try_dequeue(value)) {
+                func(value);
+                ++count;
+            }
+            return count;
         }
 
-        DAKING_ALWAYS_INLINE static bool reserve_global_chunk(size_type chunk_count) {
-			return _is_global_manager_alive() ? _reserve_global_external(chunk_count) : false;
+        DAKING_ALWAYS_INLINE bool empty() const noexcept {
+            return tail_ == &stub_ && stub_.next_.load(std::memory_order_acquire) == nullptr;
         }
 
     private:
-        DAKING_ALWAYS_INLINE static manager_t& _get_global_manager() noexcept {
-            return *global_manager_instance_;
+        DAKING_ALWAYS_INLINE static hook_t* _hook_of(pointer value) noexcept {
+            return std::addressof(value->*Hook);
         }
 
-        DAKING_ALWAYS_INLINE static bool _is_global_manager_alive() noexcept {
-            std::atomic_thread_fence(std::memory_order_acquire);
-            return global_manager_instance_ != nullptr;
+        DAKING_ALWAYS_INLINE static pointer _owner_of(hook_t* hook) noexcept {
+            return reinterpret_cast<pointer>(reinterpret_cast<unsigned char*>(hook) - _hook_offset());
         }
 
-        DAKING_ALWAYS_INLINE thread_hook_t& _get_thread_hook() {
-            static thread_local thread_hook_t thread_hook;
-            return thread_hook;
+        DAKING_ALWAYS_INLINE static std::ptrdiff_t _hook_offset() noexcept {
+            // offsetof for a member pointer, computed on a fake (never dereferenced) address.
+            constexpr std::uintptr_t fake = alignof(T) > 4096 ? alignof(T) : 4096;
+            pointer owner = reinterpret_cast<pointer>(fake);
+            return reinterpret_cast<unsigned char*>(std::addressof(owner->*Hook)) - reinterpret_cast<unsigned char*>(owner);
         }
 
-        DAKING_ALWAYS_INLINE node_t*& _get_thread_local_node_list() noexcept {
-            return _get_thread_hook().node_list();
+        DAKING_ALWAYS_INLINE void _link_segment(hook_t* first, hook_t* last) noexcept {
+            hook_t* old_head = head_.exchange(last, std::memory_order_acq_rel);
+            old_head->next_.store(first, std::memory_order_release);
         }
 
-        DAKING_ALWAYS_INLINE size_type& _get_thread_local_node_size() noexcept {
-            return _get_thread_hook().node_size();
+        /* MPSC */
+        alignas(align) std::atomic<hook_t*> head_;
+        alignas(align) hook_t*              tail_;
+        hook_t                              stub_;
+    };
+
+    // A record handed to the consumer of MPSC_record_queue, valid until the next dequeue.
+    class MPSC_record_view {
+    public:
+        MPSC_record_view() noexcept = default;
+        MPSC_record_view(const std::byte* data, std::size_t size) noexcept : data_(data), size_(size) {}
+
+        const std::byte* data() const noexcept { return data_; }
+        std::size_t      size() const noexcept { return size_; }
+        bool             empty() const noexcept { return size_ == 0; }
+        const std::byte* begin() const noexcept { return data_; }
+        const std::byte* end() const noexcept { return data_ + size_; }
+
+#if DAKING_HAS_CXX20_OR_ABOVE
+        operator std::span<const std::byte>() const noexcept {
+            return std::span<const std::byte>(data_, size_);
         }
+#endif
 
-        DAKING_ALWAYS_INLINE void _initial(const Alloc& alloc) {
-            {
-                std::lock_guard<std::mutex> guard(global_mutex_);
-                global_manager_instance_ = manager_t::create_global_manager(alloc); // single instance
+    private:
+        const std::byte* data_ = nullptr;
+        std::size_t      size_ = 0;
+    };
+
+    /*
+         MPSC queue of variable-length byte records, on top of the same chunk/page pool as MPSC_queue.
+         The pool nodes are blocks of BlockSize bytes. Every producer thread owns one block at a time
+         and carves length-prefixed records out of it with a bump pointer, no allocation per record.
+         A record is published like a node of MPSC_queue: one exchange on head_, then a store to next_.
+
+         Block lifetime is counted without an atomic per record on the producer side:
+         refs_ starts at a large bias, the consumer subtracts 1 per record it is done with,
+         and the producer subtracts (bias - records carved) when it moves to a new block.
+         Whoever brings refs_ to 0 returns the block to the pool.
+         Records that do not fit into an empty block are allocated on their own and freed by the consumer.
+
+         [next_chunk_ | block_header | rec | rec | rec | ...  free  ...]    rec = [record_header | size bytes | pad to 8]
+    */
+    template <
+        std::size_t BlockSize           = 64 * 1024,
+        std::size_t ThreadLocalCapacity = 8,
+        std::size_t Align               = 64, /* std::hardware_destructive_interference_size */
+        typename Alloc                  = std::allocator<std::byte>
+    >
+    class MPSC_record_queue {
+    public:
+        static_assert((ThreadLocalCapacity & (ThreadLocalCapacity - 1)) == 0, "ThreadLocalCapacity must be a power of 2.");
+
+        using allocator_type = Alloc;
+        using size_type      = typename std::allocator_traits<allocator_type>::size_type;
+
+        static constexpr std::size_t block_size            = BlockSize;
+        static constexpr std::size_t thread_local_capacity = ThreadLocalCapacity;
+        static constexpr std::size_t align                 = Align;
+
+    private:
+        struct record_header {
+            std::atomic<record_header*> next_{ nullptr };
+            void*                       block_ = nullptr; /* nullptr: allocated on its own */
+            size_type                   size_  = 0;
+        };
+
+        using storage_t    = detail::MPSC_storage<BlockSize, alignof(std::max_align_t)>;
+        using pool_alloc_t = typename std::allocator_traits<allocator_type>::template rebind_alloc<storage_t>;
+        using pool_t       = detail::MPSC_pool<MPSC_record_queue, storage_t, ThreadLocalCapacity, pool_alloc_t>;
+        using node_t       = typename pool_t::node_t;
+        using big_alloc_t  = typename std::allocator_traits<allocator_type>::template rebind_alloc<std::max_align_t>;
+        using big_traits_t = std::allocator_traits<big_alloc_t>;
+
+        struct block_header {
+            std::atomic<size_type> refs_;
+            node_t*                node_;
+        };
+
+        // The first word of a block is left alone, it is next_chunk_ while the block sits in the chunk stack.
+        static constexpr std::size_t record_align        = alignof(record_header);
+        static constexpr std::size_t block_header_offset = alignof(std::max_align_t);
+        static constexpr std::size_t block_data_offset   = (block_header_offset + sizeof(block_header) + 63) / 64 * 64; // refs_ on its own line
+        static constexpr size_type   block_bias        = size_type(-1) / 2;
+
+        static_assert(BlockSize >= block_data_offset + 2 * sizeof(record_header), "BlockSize is too small.");
+
+        struct thread_state {
+            ~thread_state() {
+                // The pool hook of this thread is destroyed after us, see _get_thread_state.
+                if (block_ && generation_ == pool_t::global_generation_.load(std::memory_order_acquire)
+                    && pool_t::_is_global_manager_alive()) {
+                    _retire_block(*this);
+                }
             }
 
-            node_t* dummy = _allocate();
-            tail_ = dummy;
-            head_.store(dummy, std::memory_order_release);
-        }
+            block_header* block_      = nullptr;
+            size_type     offset_     = 0;
+            size_type     carved_     = 0;
+            size_type     generation_ = 0;
+        };
+
+    public:
+        // Largest record carved out of a block, larger ones are allocated on their own.
+        static constexpr size_type max_block_record_size = BlockSize - block_data_offset - sizeof(record_header);
+
+        // A record reserved by prepare: write size() bytes at data(), then commit.
+        // Dropping it without commit gives the space up (the bytes of a block record are not reused).
+        class prepared_record {
+        public:
+            prepared_record() noexcept = default;
+
+            prepared_record(prepared_record&& other) noexcept
+                : queue_(std::exchange(other.queue_, nullptr)), record_(std::exchange(other.record_, nullptr)) {}
+
+            prepared_record& operator=(prepared_record&& other) noexcept {
+                if (this != &other) {
+                    abandon();
+                    queue_  = std::exchange(other.queue_, nullptr);
+                    record_ = std::exchange(other.record_, nullptr);
+                }
+                return *this;
+            }
+
+            ~prepared_record() {
+                abandon();
+            }
 
-        DAKING_ALWAYS_INLINE node_t* _allocate() {
-            node_t*& thread_local_node_list = _get_thread_local_node_list();
-            size_type& thread_local_node_size = _get_thread_local_node_size();
-            if (thread_local_node_size == 0) DAKING_UNLIKELY {
-                while (!global_chunk_stack_.try_pop(thread_local_node_list)) {
-                    _reserve_global_internal();
-				}
-                thread_local_node_size = thread_local_capacity;
+            explicit operator bool() const noexcept {
+                return record_ != nullptr;
             }
-            thread_local_node_size--;
-            DAKING_TSAN_ANNOTATE_ACQUIRE(thread_local_node_list);
-            DAKING_TSAN_ANNOTATE_ACQUIRE(thread_local_node_list->next_);
-            node_t* res = std::exchange(thread_local_node_list, thread_local_node_list->next_.load(std::memory_order_relaxed));
-            res->next_.store(nullptr, std::memory_order_relaxed);
-            return res;
+
+            // Aligned to alignof(void*) at least.
+            DAKING_ALWAYS_INLINE std::byte* data() const noexcept {
+                return _payload(record_);
+            }
+
+            DAKING_ALWAYS_INLINE size_type size() const noexcept {
+                return record_->size_;
+            }
+
+            DAKING_ALWAYS_INLINE void commit() noexcept {
+                queue_->_link_record(record_);
+                queue_  = nullptr;
+                record_ = nullptr;
+            }
+
+            DAKING_ALWAYS_INLINE void abandon() noexcept {
+                if (record_) {
+                    _release_record(record_);
+                    queue_  = nullptr;
+                    record_ = nullptr;
+                }
+            }
+
+        private:
+            friend class MPSC_record_queue;
+
+            prepared_record(MPSC_record_queue* queue, record_header* record) noexcept : queue_(queue), record_(record) {}
+
+            MPSC_record_queue* queue_  = nullptr;
+            record_header*     record_ = nullptr;
+        };
+
+        MPSC_record_queue() : MPSC_record_queue(allocator_type()) {}
+
+        MPSC_record_queue(const allocator_type& alloc) : head_(&stub_), tail_(&stub_) {
+            pool_t::_attach(pool_alloc_t(alloc));
         }
 
-        DAKING_ALWAYS_INLINE void _deallocate(node_t* node) noexcept {
-            node_t*& thread_local_node_list = _get_thread_local_node_list();
-            node->next_.store(thread_local_node_list, std::memory_order_relaxed);
-            thread_local_node_list = node;
-            DAKING_TSAN_ANNOTATE_RELEASE(node);
-            if (++_get_thread_local_node_size() >= thread_local_capacity) DAKING_UNLIKELY {
-				global_chunk_stack_.push(thread_local_node_list);
-                thread_local_node_list = nullptr;
-                _get_thread_local_node_size() = 0;
+        ~MPSC_record_queue() {
+            record_header* next = tail_->next_.load(std::memory_order_acquire);
+            while (next) {
+                _release_dummy(std::exchange(tail_, next));
+                next = tail_->next_.load(std::memory_order_acquire);
             }
+            _release_dummy(tail_);
+            pool_t::_detach();
+        }
+
+        MPSC_record_queue(const MPSC_record_queue&)            = delete;
+        MPSC_record_queue(MPSC_record_queue&&)                 = delete;
+        MPSC_record_queue& operator=(const MPSC_record_queue&) = delete;
+        MPSC_record_queue& operator=(MPSC_record_queue&&)      = delete;
+
+        DAKING_ALWAYS_INLINE prepared_record prepare(size_type size) {
+            return prepared_record(this, _carve_record<false>(size));
+        }
+
+        DAKING_ALWAYS_INLINE prepared_record try_prepare(size_type size) {
+            // Empty if the node budget does not allow a new block.
+            record_header* record = _carve_record<true>(size);
+            return record ? prepared_record(this, record) : prepared_record();
+        }
+
+        DAKING_ALWAYS_INLINE void enqueue(const void* data, size_type size) {
+            record_header* record = _carve_record<false>(size);
+            std::memcpy(_payload(record), data, size);
+            _link_record(record);
         }
 
-        DAKING_ALWAYS_INLINE static bool _reserve_global_external(size_type chunk_count) {
-            manager_t& manager = _get_global_manager();
-            size_type global_node_count = manager.node_count();
-            if (global_node_count / thread_local_capacity >= chunk_count) {
+        DAKING_ALWAYS_INLINE bool try_enqueue(const void* data, size_type size) {
+            record_header* record = _carve_record<true>(size);
+            if (!record) DAKING_UNLIKELY {
                 return false;
             }
-            std::lock_guard<std::mutex> lock(global_mutex_);
-            global_node_count = manager.node_count();
-            if (global_node_count / thread_local_capacity >= chunk_count) {
+            std::memcpy(_payload(record), data, size);
+            _link_record(record);
+            return true;
+        }
+
+        template <typename Func>
+        DAKING_ALWAYS_INLINE bool try_dequeue(Func&& func) {
+            // func(MPSC_record_view), the view stays valid until the next dequeue.
+            record_header* next = tail_->next_.load(std::memory_order_acquire);
+            if (!next) {
                 return false;
             }
+            // next becomes the dummy, its bytes live until it is released by the next dequeue.
+            _release_dummy(std::exchange(tail_, next));
+            func(MPSC_record_view(_payload(next), next->size_));
+            return true;
+        }
 
-            size_type count = (chunk_count - global_node_count / thread_local_capacity) * thread_local_capacity;
-            manager.reserve(count);
-			return true;
+        template <typename Func>
+        DAKING_ALWAYS_INLINE size_type drain(Func&& func, size_type max_count = size_type(-1)) {
+            size_type count = 0;
+            while (count < max_count && try_dequeue(func)) {
+                ++count;
+            }
+            return count;
         }
 
-        DAKING_ALWAYS_INLINE static void _reserve_global_internal() {
-			std::lock_guard<std::mutex> lock(global_mutex_);
-            if (global_chunk_stack_.top_.load(std::memory_order_acquire).node_) {
-                // if anyone have already allocate chunks, I return.
-                return;
-			}
+        DAKING_ALWAYS_INLINE bool empty() const noexcept {
+            return tail_->next_.load(std::memory_order_acquire) == nullptr;
+        }
+
+        DAKING_ALWAYS_INLINE static bool reserve_global_chunk(size_type chunk_count, bool touch_pages = false) {
+            return pool_t::reserve_chunk(chunk_count, touch_pages);
+        }
+
+        static void set_global_node_budget(size_type max_block_count, MPSC_overflow_handler handler = nullptr) {
+            pool_t::set_node_budget(max_block_count, handler);
+        }
+
+        static void set_global_retention_policy(MPSC_retention_policy policy) {
+            pool_t::set_retention_policy(policy);
+        }
+
+        static bool release_global_pool() {
+            return pool_t::release();
+        }
+
+        static bool trim_global_pool() {
+            return pool_t::trim();
+        }
+
+        static MPSC_pool_stats global_pool_stats() {
+            return pool_t::stats();
+        }
+
+    private:
+        DAKING_ALWAYS_INLINE static std::byte* _payload(record_header* record) noexcept {
+            return reinterpret_cast<std::byte*>(record) + sizeof(record_header);
+        }
+
+        DAKING_ALWAYS_INLINE static size_type _record_bytes(size_type size) noexcept {
+            return (sizeof(record_header) + size + record_align - 1) / record_align * record_align;
+        }
+
+        DAKING_ALWAYS_INLINE static std::byte* _block_bytes(block_header* block) noexcept {
+            return reinterpret_cast<std::byte*>(block) - block_header_offset;
+        }
+
+        DAKING_ALWAYS_INLINE static thread_state& _get_thread_state() {
+            // Touch the pool hook first: thread_locals are destroyed in reverse order,
+            // so the state can still return its block to the pool at thread exit.
+            pool_t::_get_thread_hook();
+            static thread_local thread_state state;
+            return state;
+        }
+
+        template <bool Try>
+        DAKING_ALWAYS_INLINE static record_header* _carve_record(size_type size) {
+            size_type bytes = _record_bytes(size);
+            if (bytes > BlockSize - block_data_offset) DAKING_UNLIKELY {
+                return _allocate_big_record(size);
+            }
+
+            thread_state& state = _get_thread_state();
+            size_type generation = pool_t::global_generation_.load(std::memory_order_acquire);
+            if (state.generation_ != generation) DAKING_UNLIKELY {
+                // The pages of the old block are gone with the last instance.
+                state.block_      = nullptr;
+                state.generation_ = generation;
+            }
+            if (!state.block_ || state.offset_ + bytes > BlockSize) DAKING_UNLIKELY {
+                node_t* node;
+                if constexpr (Try) {
+                    node = pool_t::_try_allocate();
+                    if (!node) {
+                        return nullptr;
+                    }
+                }
+                else {
+                    node = pool_t::_allocate();
+                }
+                if (state.block_) {
+                    _retire_block(state);
+                }
+                std::byte* bytes = reinterpret_cast<std::byte*>(std::addressof(node->value_));
+                state.block_  = ::new (static_cast<void*>(bytes + block_header_offset)) block_header{ { block_bias }, node };
+                state.offset_ = block_data_offset;
+                state.carved_ = 0;
+            }
+
+            record_header* record = ::new (static_cast<void*>(_block_bytes(state.block_) + state.offset_)) record_header();
+            record->block_ = state.block_;
+            record->size_  = size;
+            state.offset_ += bytes;
+            state.carved_++;
+            return record;
+        }
+
+        static record_header* _allocate_big_record(size_type size) {
+            big_alloc_t alloc;
+            size_type count = (sizeof(record_header) + size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+            record_header* record = ::new (static_cast<void*>(big_traits_t::allocate(alloc, count))) record_header();
+            record->size_ = size;
+            return record;
+        }
+
+        DAKING_ALWAYS_INLINE static void _retire_block(thread_state& state) noexcept {
+            _drop_block_refs(state.block_, block_bias - state.carved_);
+            state.block_ = nullptr;
+        }
 
-            _get_global_manager().reserve(std::max(thread_local_capacity, _get_global_manager().node_count()));
+        DAKING_ALWAYS_INLINE static void _drop_block_refs(block_header* block, size_type count) noexcept {
+            if (block->refs_.fetch_sub(count, std::memory_order_acq_rel) == count) {
+                pool_t::_deallocate(block->node_);
+            }
         }
 
-        DAKING_ALWAYS_INLINE void _free_global() {
-            /* Already locked */
-            global_chunk_stack_.reset();
-            if (_is_global_manager_alive()) {
-                _get_global_manager().reset();
+        DAKING_ALWAYS_INLINE static void _release_record(record_header* record) noexcept {
+            if (record->block_) DAKING_LIKELY {
+                _drop_block_refs(static_cast<block_header*>(record->block_), 1);
+            }
+            else {
+                big_alloc_t alloc;
+                size_type count = (sizeof(record_header) + record->size_ + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+                big_traits_t::deallocate(alloc, reinterpret_cast<std::max_align_t*>(record), count);
             }
         }
 
-        /* Global LockFree*/
-        inline static chunk_stack_t          global_chunk_stack_{};
-        inline static std::atomic<size_type> global_instance_count_ = 0;
+        DAKING_ALWAYS_INLINE void _release_dummy(record_header* record) noexcept {
+            if (record != &stub_) DAKING_LIKELY {
+                _release_record(record);
+            }
+        }
 
-        /* Global Mutex*/ 
-        inline static std::mutex             global_mutex_{};
-        inline static manager_t*             global_manager_instance_ = nullptr;
+        DAKING_ALWAYS_INLINE void _link_record(record_header* record) noexcept {
+            record_header* old_head = head_.exchange(record, std::memory_order_acq_rel);
+            old_head->next_.store(record, std::memory_order_release);
+        }
 
         /* MPSC */
-        alignas(align) std::atomic<node_t*>  head_;
-        alignas(align) node_t*               tail_;
+        alignas(align) std::atomic<record_header*> head_;
+        alignas(align) record_header*              tail_;
+        record_header                              stub_;
     };
 }
 
@@ -0,0 +1,255 @@
+/*
+MIT License
+
+Copyright (c) 2025 dakingffo
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(_MSC_VER) && _MSC_VER > 1000 || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 3)
+#pragma once
+#endif
+
+#ifndef DAKING_ACTOR_HPP
+#define DAKING_ACTOR_HPP
+
+#include "daking/MPSC_queue.hpp"
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+namespace daking {
+
+    class actor_system;
+
+    namespace detail {
+        // What a worker sees of an actor: something that can take a turn.
+        class actor_base {
+        public:
+            virtual ~actor_base() = default;
+
+            // Messages sent and not yet handled, the one being received included.
+            std::size_t pending_apprx() const noexcept {
+                return pending_.load(std::memory_order_relaxed);
+            }
+
+        protected:
+            actor_base() = default;
+
+            actor_base(const actor_base&)            = delete;
+            actor_base& operator=(const actor_base&) = delete;
+
+            // Called by send before the message is linked, returns whether this send must schedule the actor.
+            DAKING_ALWAYS_INLINE bool _add_pending() noexcept {
+                return pending_.fetch_add(1, std::memory_order_acq_rel) == 0;
+            }
+
+            // Called by send after the message is linked, if _add_pending returned true.
+            inline void _schedule();
+
+        private:
+            friend class daking::actor_system;
+
+            // Handle at most batch messages, returns how many were handled.
+            virtual std::size_t _run(std::size_t batch) = 0;
+
+            actor_system*            system_  = nullptr;
+            std::size_t              worker_  = 0;
+            std::atomic<std::size_t> pending_{ 0 }; /* Messages sent and not yet handled */
+        };
+    }
+
+    /*
+         An actor owns an MPSC_queue mailbox: any thread may send, one worker at a time runs receive.
+             struct counter : daking::actor<int> {
+                 void receive(int& value) override { sum += value; }
+                 long sum = 0;
+             };
+             daking::actor_system system(8);
+             counter* c = system.spawn<counter>();
+             c->send(1);
+         pending_ counts messages sent and not yet handled. A send counts its message before linking it, so a turn
+         never handles more than pending_ holds, and the send that moves it from 0 to 1 schedules the actor once linked.
+         A turn handles at most the system's batch size, then the actor is scheduled again if pending_ is still
+         not 0, behind the other actors of its worker. pending_ only reaches 0 when no turn is queued or running,
+         so an actor is never queued twice and never runs on two workers.
+    */
+    template <typename Message, std::size_t ThreadLocalCapacity = 256>
+    class actor : public detail::actor_base {
+    public:
+        using message_type = Message;
+        using mailbox_type = MPSC_queue<Message, ThreadLocalCapacity>;
+
+        template <typename... Args>
+        DAKING_ALWAYS_INLINE void send(Args&&... args) {
+            // Built first, so a throwing constructor leaves pending_ untouched, then counted, then linked.
+            auto slot = mailbox_.prepare();
+            slot.emplace(std::forward<Args>(args)...);
+            const bool schedule = _add_pending();
+            slot.commit();
+            if (schedule) {
+                _schedule();
+            }
+        }
+
+    protected:
+        virtual void receive(Message& message) = 0;
+
+    private:
+        std::size_t _run(std::size_t batch) override {
+            // The message stays in current_ across turns, so its storage is reused.
+            std::size_t count = 0;
+            while (count < batch && mailbox_.try_dequeue(current_)) {
+                receive(current_);
+                ++count;
+            }
+            return count;
+        }
+
+        mailbox_type mailbox_;
+        Message      current_{};
+    };
+
+    /*
+         A fixed pool of worker threads. Each actor is pinned to one worker at spawn (round-robin),
+         every worker has an MPSC_queue run queue that any thread schedules into,
+         so scheduling takes no lock and needs no MPMC queue. An idle worker yields briefly, then parks.
+    */
+    class actor_system {
+    public:
+        explicit actor_system(std::size_t worker_count = std::thread::hardware_concurrency(), std::size_t batch = 64)
+            : batch_(batch == 0 ? 1 : batch), workers_(worker_count == 0 ? 1 : worker_count) {
+            for (std::size_t i = 0; i < workers_.size(); i++) {
+                workers_[i].thread_ = std::thread([this, i]() { _work(workers_[i]); });
+            }
+        }
+
+        // Stops the workers after their current turn, then destroys the actors with whatever is left in their mailboxes.
+        ~actor_system() {
+            for (auto& worker : workers_) {
+                std::lock_guard<std::mutex> lock(worker.mutex_);
+                worker.stop_.store(true, std::memory_order_release);
+                worker.wake_.notify_one();
+            }
+            for (auto& worker : workers_) {
+                worker.thread_.join();
+            }
+        }
+
+        actor_system(const actor_system&)            = delete;
+        actor_system& operator=(const actor_system&) = delete;
+
+        template <typename Actor, typename... Args>
+        Actor* spawn(Args&&... args) {
+            static_assert(std::is_base_of_v<detail::actor_base, Actor>, "Actor must derive from daking::actor.");
+            auto actor = std::make_unique<Actor>(std::forward<Args>(args)...);
+            Actor* result = actor.get();
+            std::lock_guard<std::mutex> lock(actors_mutex_);
+            result->system_ = this;
+            result->worker_ = next_worker_++ % workers_.size();
+            actors_.push_back(std::move(actor));
+            return result;
+        }
+
+        std::size_t worker_count() const noexcept {
+            return workers_.size();
+        }
+
+        std::size_t batch() const noexcept {
+            return batch_;
+        }
+
+    private:
+        friend class detail::actor_base;
+
+        struct alignas(64) worker_t {
+            MPSC_queue<detail::actor_base*> run_queue_;
+            std::atomic<bool>               sleeping_{ false };
+            std::atomic<bool>               stop_{ false };
+            std::mutex                      mutex_;
+            std::condition_variable         wake_;
+            std::thread                     thread_;
+        };
+
+        DAKING_ALWAYS_INLINE void _schedule(detail::actor_base* actor) {
+            worker_t& worker = workers_[actor->worker_];
+            worker.run_queue_.enqueue(actor);
+            // Pairs with the fence in _park: either the worker sees the actor, or we see it sleeping.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (worker.sleeping_.load(std::memory_order_relaxed)) DAKING_UNLIKELY {
+                std::lock_guard<std::mutex> lock(worker.mutex_);
+                worker.sleeping_.store(false, std::memory_order_relaxed);
+                worker.wake_.notify_one();
+            }
+        }
+
+        void _work(worker_t& worker) {
+            detail::actor_base* actor;
+            int idle = 0;
+            while (!worker.stop_.load(std::memory_order_acquire)) {
+                if (worker.run_queue_.try_dequeue(actor)) {
+                    idle = 0;
+                    std::size_t handled = actor->_run(batch_);
+                    if (actor->pending_.fetch_sub(handled, std::memory_order_acq_rel) != handled) {
+                        // Still has work (or a message counted but not linked yet): back of the line.
+                        worker.run_queue_.enqueue(actor);
+                    }
+                    continue;
+                }
+                if (++idle < 64) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                _park(worker);
+                idle = 0;
+            }
+        }
+
+        void _park(worker_t& worker) {
+            std::unique_lock<std::mutex> lock(worker.mutex_);
+            worker.sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!worker.run_queue_.empty() || worker.stop_.load(std::memory_order_acquire)) {
+                worker.sleeping_.store(false, std::memory_order_relaxed);
+                return;
+            }
+            // The timeout is only a safety net.
+            worker.wake_.wait_for(lock, std::chrono::milliseconds(100), [&]() {
+                return !worker.sleeping_.load(std::memory_order_relaxed) || worker.stop_.load(std::memory_order_acquire);
+            });
+            worker.sleeping_.store(false, std::memory_order_relaxed);
+        }
+
+        const std::size_t                               batch_;
+        std::vector<worker_t>                           workers_;
+        std::mutex                                      actors_mutex_;
+        std::vector<std::unique_ptr<detail::actor_base>> actors_;
+        std::size_t                                     next_worker_ = 0;
+    };
+
+    inline void detail::actor_base::_schedule() {
+        system_->_schedule(this);
+    }
+}
+
+#endif // !DAKING_ACTOR_HPP
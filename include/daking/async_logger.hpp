@@ -0,0 +1,454 @@
+/*
+MIT License
+
+Copyright (c) 2025 dakingffo
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(_MSC_VER) && _MSC_VER > 1000 || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 3)
+#pragma once
+#endif
+
+#ifndef DAKING_ASYNC_LOGGER_HPP
+#define DAKING_ASYNC_LOGGER_HPP
+
+#include "daking/MPSC_queue.hpp"
+
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <condition_variable>
+#include <stdexcept>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <cerrno>
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+namespace daking {
+
+    enum class log_level : std::uint8_t { trace, debug, info, warn, error, off };
+
+    namespace detail {
+        /*
+             Producer-side timestamps: rdtsc on x86, cntvct_el0 on AArch64, steady_clock elsewhere.
+             The consumer turns ticks into wall time with a base point and a rate measured when the logger starts.
+        */
+        struct log_clock {
+            static inline std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+                return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+                std::uint64_t ticks;
+                asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+                return ticks;
+#else
+                return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+            }
+
+            void calibrate() {
+                auto wall_begin = std::chrono::steady_clock::now();
+                std::uint64_t tick_begin = now();
+                while (std::chrono::steady_clock::now() - wall_begin < std::chrono::milliseconds(10));
+                auto wall_end = std::chrono::steady_clock::now();
+                std::uint64_t tick_end = now();
+                double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(wall_end - wall_begin).count();
+                ticks_per_ns_ = (double)(tick_end - tick_begin) / ns;
+                base_ticks_   = now();
+                base_ns_      = (std::int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+            }
+
+            // Nanoseconds since the Unix epoch.
+            std::int64_t to_wall_ns(std::uint64_t ticks) const noexcept {
+                return base_ns_ + (std::int64_t)((double)(std::int64_t)(ticks - base_ticks_) / ticks_per_ns_);
+            }
+
+            double        ticks_per_ns_ = 1.0;
+            std::uint64_t base_ticks_   = 0;
+            std::int64_t  base_ns_      = 0;
+        };
+
+        /*
+             How one argument travels through the record queue: arithmetic values, enums and pointers are copied
+             as they are, strings (const char*, std::string, std::string_view) are copied with their length
+             and come back as a NUL-terminated const char* that points into the record.
+        */
+        template <typename T>
+        struct log_arg {
+            static_assert(std::is_trivially_copyable_v<T>, "Log arguments must be trivially copyable or strings.");
+            using decoded_type = T;
+
+            static std::size_t size(const T&) noexcept {
+                return sizeof(T);
+            }
+
+            static std::byte* encode(std::byte* out, const T& value) noexcept {
+                std::memcpy(out, &value, sizeof(T));
+                return out + sizeof(T);
+            }
+
+            static const std::byte* decode(const std::byte* in, T& value) noexcept {
+                std::memcpy(&value, in, sizeof(T));
+                return in + sizeof(T);
+            }
+        };
+
+        struct log_string_arg {
+            using decoded_type = const char*;
+
+            static std::size_t size(std::string_view value) noexcept {
+                return sizeof(std::uint32_t) + value.size() + 1;
+            }
+
+            static std::byte* encode(std::byte* out, std::string_view value) noexcept {
+                std::uint32_t length = (std::uint32_t)value.size();
+                std::memcpy(out, &length, sizeof(length));
+                std::memcpy(out + sizeof(length), value.data(), length);
+                out[sizeof(length) + length] = std::byte{ 0 };
+                return out + sizeof(length) + length + 1;
+            }
+
+            static const std::byte* decode(const std::byte* in, const char*& value) noexcept {
+                std::uint32_t length;
+                std::memcpy(&length, in, sizeof(length));
+                value = reinterpret_cast<const char*>(in + sizeof(length));
+                return in + sizeof(length) + length + 1;
+            }
+        };
+
+        template <> struct log_arg<const char*>      : log_string_arg {};
+        template <> struct log_arg<char*>            : log_string_arg {};
+        template <> struct log_arg<std::string>      : log_string_arg {};
+        template <> struct log_arg<std::string_view> : log_string_arg {};
+
+        enum class log_record_kind : std::uint8_t { message, barrier };
+
+        struct log_record_header {
+            using format_fn = void (*)(const char* format, const std::byte* args, std::string& out);
+
+            std::uint64_t   ticks_;
+            const char*     format_;
+            format_fn       format_fn_;
+            void*           barrier_;
+            log_record_kind kind_;
+            log_level       level_;
+        };
+
+        template <typename... Args>
+        struct log_formatter {
+            static void format(const char* format, const std::byte* args, std::string& out) {
+                std::tuple<typename log_arg<Args>::decoded_type...> values;
+                std::apply([&](auto&... value) {
+                    ((args = log_arg<Args>::decode(args, value)), ...);
+                }, values);
+                std::apply([&](const auto&... value) {
+                    _append(out, format, value...);
+                }, values);
+            }
+
+            template <typename... Values>
+            static void _append(std::string& out, const char* format, const Values&... values) {
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+#endif
+                // Most lines fit the stack buffer, longer ones are formatted a second time in place.
+                char line[512];
+                int length = std::snprintf(line, sizeof(line), format, values...);
+                if (length < 0) {
+                    return;
+                }
+                if ((std::size_t)length < sizeof(line)) {
+                    out.append(line, (std::size_t)length);
+                }
+                else {
+                    std::size_t used = out.size();
+                    out.resize(used + (std::size_t)length);
+                    std::snprintf(out.data() + used, (std::size_t)length + 1, format, values...);
+                }
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+            }
+        };
+    }
+
+    /*
+         Asynchronous logger on top of MPSC_record_queue.
+         A log call captures the raw arguments and a tick count into one record, nothing is formatted on the producer:
+             logger.info("order %llu filled at %.2f by %s", id, price, trader);
+         The format string is printf-like and must outlive the logger (a string literal).
+         A single consumer thread formats the records, coalesces the lines into up to buffer_count buffers
+         of buffer_size bytes, and writes them with one writev when they are full, when the queue runs dry,
+         or at a flush barrier. Other platforms fall back to one fwrite per buffer.
+    */
+    class async_logger {
+    public:
+        using queue_type = MPSC_record_queue<>;
+
+        static constexpr std::size_t buffer_size  = 64 * 1024;
+        static constexpr std::size_t buffer_count = 8;
+
+        // Appends to path, throws std::runtime_error if it cannot be opened.
+        explicit async_logger(const char* path, log_level level = log_level::info) : level_(level) {
+#if defined(_WIN32) || defined(_WIN64)
+            file_ = std::fopen(path, "ab");
+            if (!file_) {
+                throw std::runtime_error(std::string("async_logger: cannot open ") + path);
+            }
+#else
+            fd_ = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (fd_ < 0) {
+                throw std::runtime_error(std::string("async_logger: cannot open ") + path);
+            }
+#endif
+            _start();
+        }
+
+        ~async_logger() {
+            stop_.store(true, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex_);
+            }
+            wake_.notify_one();
+            consumer_.join();
+#if defined(_WIN32) || defined(_WIN64)
+            std::fclose(file_);
+#else
+            ::close(fd_);
+#endif
+        }
+
+        async_logger(const async_logger&)            = delete;
+        async_logger& operator=(const async_logger&) = delete;
+
+        void set_level(log_level level) noexcept {
+            level_.store(level, std::memory_order_relaxed);
+        }
+
+        log_level level() const noexcept {
+            return level_.load(std::memory_order_relaxed);
+        }
+
+        DAKING_ALWAYS_INLINE bool should_log(log_level level) const noexcept {
+            return level >= level_.load(std::memory_order_relaxed);
+        }
+
+        template <typename... Args>
+        DAKING_ALWAYS_INLINE void log(log_level level, const char* format, const Args&... args) {
+            if (!should_log(level)) {
+                return;
+            }
+            std::uint64_t ticks = detail::log_clock::now();
+            std::size_t size = sizeof(detail::log_record_header) + (detail::log_arg<std::decay_t<Args>>::size(args) + ... + 0);
+            auto record = queue_.prepare(size);
+            detail::log_record_header header{ ticks, format, &detail::log_formatter<std::decay_t<Args>...>::format,
+                nullptr, detail::log_record_kind::message, level };
+            std::memcpy(record.data(), &header, sizeof(header));
+            [[maybe_unused]] std::byte* out = record.data() + sizeof(header);
+            ((out = detail::log_arg<std::decay_t<Args>>::encode(out, args)), ...);
+            record.commit();
+        }
+
+        template <typename... Args>
+        DAKING_ALWAYS_INLINE void trace(const char* format, const Args&... args) { log(log_level::trace, format, args...); }
+
+        template <typename... Args>
+        DAKING_ALWAYS_INLINE void debug(const char* format, const Args&... args) { log(log_level::debug, format, args...); }
+
+        template <typename... Args>
+        DAKING_ALWAYS_INLINE void info(const char* format, const Args&... args) { log(log_level::info, format, args...); }
+
+        template <typename... Args>
+        DAKING_ALWAYS_INLINE void warn(const char* format, const Args&... args) { log(log_level::warn, format, args...); }
+
+        template <typename... Args>
+        DAKING_ALWAYS_INLINE void error(const char* format, const Args&... args) { log(log_level::error, format, args...); }
+
+        // Barrier: returns once every record logged before it (by any thread that happened-before the call)
+        // has been formatted and handed to the OS.
+        void flush() {
+            std::promise<void> done;
+            std::future<void> written = done.get_future();
+            detail::log_record_header header{ detail::log_clock::now(), nullptr, nullptr, &done,
+                detail::log_record_kind::barrier, log_level::off };
+            queue_.enqueue(&header, sizeof(header));
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex_);
+            }
+            wake_.notify_one();
+            written.wait();
+        }
+
+    private:
+        void _start() {
+            clock_.calibrate();
+            for (auto& buffer : buffers_) {
+                buffer.reserve(buffer_size + 256);
+            }
+            consumer_ = std::thread([this]() { _consume(); });
+        }
+
+        void _consume() {
+            using namespace std::chrono_literals;
+            auto idle = 0us;
+            while (true) {
+                std::size_t count = queue_.drain([this](MPSC_record_view record) { _handle(record); }, 4096);
+                if (count != 0) {
+                    idle = 0us;
+                    continue;
+                }
+                _write_all();
+                if (stop_.load(std::memory_order_acquire)) {
+                    // The producers are gone, take what is left.
+                    if (queue_.drain([this](MPSC_record_view record) { _handle(record); }) == 0) {
+                        break;
+                    }
+                    continue;
+                }
+                // Back off up to 1ms, flush and the destructor cut the wait short.
+                idle = idle < 1000us ? idle + 50us : idle;
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                wake_.wait_for(lock, idle);
+            }
+            _write_all();
+        }
+
+        void _handle(MPSC_record_view record) {
+            detail::log_record_header header;
+            std::memcpy(&header, record.data(), sizeof(header));
+            if (header.kind_ == detail::log_record_kind::barrier) {
+                _write_all();
+                static_cast<std::promise<void>*>(header.barrier_)->set_value();
+                return;
+            }
+
+            std::string& out = buffers_[used_];
+            _append_prefix(out, header);
+            header.format_fn_(header.format_, record.data() + sizeof(header), out);
+            out.push_back('\n');
+            if (out.size() >= buffer_size && ++used_ == buffer_count) {
+                _write_all();
+            }
+        }
+
+        void _append_prefix(std::string& out, const detail::log_record_header& header) {
+            static constexpr const char* level_names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+            std::int64_t wall_ns = clock_.to_wall_ns(header.ticks_);
+            std::time_t seconds = (std::time_t)(wall_ns / 1000000000);
+            if (seconds != cached_second_) {
+                // strftime once per second.
+                std::tm local_tm{};
+#if defined(_WIN32) || defined(_WIN64)
+                localtime_s(&local_tm, &seconds);
+#else
+                localtime_r(&seconds, &local_tm);
+#endif
+                std::strftime(cached_date_, sizeof(cached_date_), "%Y-%m-%d %H:%M:%S", &local_tm);
+                cached_second_ = seconds;
+            }
+            char prefix[64];
+            int length = std::snprintf(prefix, sizeof(prefix), "[%s.%06d] [%s] ", cached_date_,
+                (int)(wall_ns % 1000000000 / 1000), level_names[(int)header.level_]);
+            out.append(prefix, (std::size_t)length);
+        }
+
+        void _write_all() {
+            std::size_t count = used_;
+            if (count < buffer_count && !buffers_[count].empty()) {
+                count++; // The one being filled
+            }
+#if defined(_WIN32) || defined(_WIN64)
+            for (std::size_t i = 0; i < count; i++) {
+                std::fwrite(buffers_[i].data(), 1, buffers_[i].size(), file_);
+            }
+            std::fflush(file_);
+#else
+            iovec vectors[buffer_count];
+            for (std::size_t i = 0; i < count; i++) {
+                vectors[i].iov_base = buffers_[i].data();
+                vectors[i].iov_len  = buffers_[i].size();
+            }
+            iovec* pending = vectors;
+            while (count != 0) {
+                ssize_t written = ::writev(fd_, pending, (int)count);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    break; // Nowhere to report to, drop the batch.
+                }
+                // Skip what has been written, a short write resumes in the middle of a buffer.
+                while (count != 0 && (std::size_t)written >= pending->iov_len) {
+                    written -= (ssize_t)pending->iov_len;
+                    ++pending;
+                    --count;
+                }
+                if (count != 0) {
+                    pending->iov_base = static_cast<char*>(pending->iov_base) + written;
+                    pending->iov_len -= (std::size_t)written;
+                }
+            }
+#endif
+            for (auto& buffer : buffers_) {
+                buffer.clear();
+            }
+            used_ = 0;
+        }
+
+        queue_type               queue_;
+        std::atomic<log_level>   level_;
+        std::atomic<bool>        stop_{ false };
+        std::mutex               wake_mutex_;
+        std::condition_variable  wake_;
+        std::thread              consumer_;
+
+        /* Consumer only */
+        detail::log_clock        clock_;
+        std::string              buffers_[buffer_count];
+        std::size_t              used_          = 0; /* Buffers that are full */
+        std::time_t              cached_second_ = -1;
+        char                     cached_date_[32] = {};
+#if defined(_WIN32) || defined(_WIN64)
+        std::FILE*               file_ = nullptr;
+#else
+        int                      fd_   = -1;
+#endif
+    };
+}
+
+#endif // !DAKING_ASYNC_LOGGER_HPP
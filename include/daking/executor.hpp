@@ -0,0 +1,301 @@
+/*
+MIT License
+
+Copyright (c) 2025 dakingffo
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(_MSC_VER) && _MSC_VER > 1000 || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 3)
+#pragma once
+#endif
+
+#ifndef DAKING_EXECUTOR_HPP
+#define DAKING_EXECUTOR_HPP
+
+#include "daking/MPSC_queue.hpp"
+
+#include <chrono>
+#include <condition_variable>
+
+namespace daking {
+
+    namespace detail {
+        /*
+             A move-only void() callable stored inline, so a task lives entirely in its queue node:
+             posting takes a node from the thread-local pool and never calls malloc.
+             Callables larger than InlineSize (or over-aligned, or throwing on move) are rejected at compile time.
+        */
+        template <std::size_t InlineSize>
+        class inline_task {
+        public:
+            static constexpr std::size_t inline_size = InlineSize;
+
+            inline_task() noexcept = default;
+
+            template <typename F, typename D = std::decay_t<F>, std::enable_if_t<!std::is_same_v<D, inline_task>, int> = 0>
+            inline_task(F&& f) noexcept(std::is_nothrow_constructible_v<D, F&&>) {
+                static_assert(sizeof(D) <= InlineSize, "The task is too large, capture a pointer to its state instead.");
+                static_assert(alignof(D) <= alignof(std::max_align_t), "Over-aligned tasks are not supported.");
+                static_assert(std::is_nothrow_move_constructible_v<D>, "The task must be nothrow move constructible.");
+                ::new (static_cast<void*>(storage_)) D(std::forward<F>(f));
+                ops_ = &ops_for<D>;
+            }
+
+            inline_task(inline_task&& other) noexcept : ops_(std::exchange(other.ops_, nullptr)) {
+                if (ops_) {
+                    ops_->move_(storage_, other.storage_);
+                }
+            }
+
+            inline_task& operator=(inline_task&& other) noexcept {
+                if (this != &other) {
+                    _reset();
+                    ops_ = std::exchange(other.ops_, nullptr);
+                    if (ops_) {
+                        ops_->move_(storage_, other.storage_);
+                    }
+                }
+                return *this;
+            }
+
+            ~inline_task() {
+                _reset();
+            }
+
+            explicit operator bool() const noexcept {
+                return ops_ != nullptr;
+            }
+
+            // Runs the callable once and destroys it.
+            void operator()() {
+                const ops_t* ops = std::exchange(ops_, nullptr);
+                struct destroy_guard {
+                    const ops_t* ops_;
+                    void*        storage_;
+                    ~destroy_guard() { ops_->destroy_(storage_); }
+                } guard{ ops, storage_ };
+                ops->invoke_(storage_);
+            }
+
+        private:
+            struct ops_t {
+                void (*invoke_)(void*);
+                void (*move_)(void* dst, void* src) noexcept; /* Move constructs into dst and destroys src */
+                void (*destroy_)(void*) noexcept;
+            };
+
+            template <typename D>
+            inline static constexpr ops_t ops_for{
+                [](void* self) { (*static_cast<D*>(self))(); },
+                [](void* dst, void* src) noexcept {
+                    ::new (dst) D(std::move(*static_cast<D*>(src)));
+                    static_cast<D*>(src)->~D();
+                },
+                [](void* self) noexcept { static_cast<D*>(self)->~D(); }
+            };
+
+            void _reset() noexcept {
+                if (ops_) {
+                    std::exchange(ops_, nullptr)->destroy_(storage_);
+                }
+            }
+
+            alignas(std::max_align_t) unsigned char storage_[InlineSize];
+            const ops_t* ops_ = nullptr;
+        };
+    }
+
+    /*
+         A work-stealing thread pool whose inboxes are MPSC_queue instances:
+             daking::executor pool(8);
+             pool.post([&] { ... });        // Any thread. From a worker, lands in that worker's own inbox.
+         Every worker consumes its inbox through a consumer_lease. An idle worker picks a worker that reported a backlog,
+         takes a lease on its inbox as well and claims up to steal_batch tasks with one try_dequeue_bulk, so it steals
+         a whole segment per visit instead of one task. The owner gives the claim back before running each task,
+         so a long task never hides the rest of its inbox. Tasks live in the nodes of the shared chunk pool,
+         with up to 56 bytes of captures.
+    */
+    class executor {
+    public:
+        using task_type = detail::inline_task<56>;
+
+        static constexpr std::size_t steal_batch = 32;
+
+        explicit executor(std::size_t worker_count = std::thread::hardware_concurrency())
+            : workers_(worker_count == 0 ? 1 : worker_count) {
+            for (std::size_t i = 0; i < workers_.size(); i++) {
+                workers_[i].thread_ = std::thread([this, i]() { _work(i); });
+            }
+        }
+
+        // Tasks still queued are destroyed without running.
+        ~executor() {
+            for (auto& worker : workers_) {
+                std::lock_guard<std::mutex> lock(worker.mutex_);
+                worker.stop_.store(true, std::memory_order_release);
+                worker.wake_.notify_one();
+            }
+            for (auto& worker : workers_) {
+                worker.thread_.join();
+            }
+        }
+
+        executor(const executor&)            = delete;
+        executor& operator=(const executor&) = delete;
+
+        template <typename F>
+        void post(F&& f) {
+            std::size_t index;
+            if (current_executor_ == this) {
+                index = current_index_;
+            }
+            else {
+                index = post_cursor_++; // Round-robin per posting thread, no shared counter.
+            }
+            post_to(index, std::forward<F>(f));
+        }
+
+        template <typename F>
+        void post_to(std::size_t index, F&& f) {
+            worker_t& worker = workers_[index % workers_.size()];
+            worker.inbox_.emplace(std::forward<F>(f));
+            // Pairs with the fence in _park: either the worker sees the task, or we see it sleeping.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (worker.sleeping_.load(std::memory_order_relaxed)) DAKING_UNLIKELY {
+                _wake(worker);
+            }
+            else if (idle_count_.load(std::memory_order_relaxed) != 0) DAKING_UNLIKELY {
+                // The owner is awake and may be busy: let an idle worker come and steal.
+                _wake_idle();
+            }
+        }
+
+        std::size_t worker_count() const noexcept {
+            return workers_.size();
+        }
+
+    private:
+        struct alignas(64) worker_t {
+            MPSC_queue<task_type>   inbox_;
+            std::atomic<bool>       backlog_{ false };  /* Owner found work at its last look, a hint for thieves */
+            std::atomic<bool>       sleeping_{ false };
+            std::atomic<bool>       stop_{ false };
+            std::mutex              mutex_;
+            std::condition_variable wake_;
+            std::thread             thread_;
+        };
+
+        void _work(std::size_t index) {
+            current_executor_ = this;
+            current_index_    = index;
+            worker_t& self = workers_[index];
+            auto lease = self.inbox_.acquire_consumer();
+            task_type task;
+            task_type stolen[steal_batch];
+            int idle = 0;
+
+            while (!self.stop_.load(std::memory_order_acquire)) {
+                if (lease.try_dequeue(task)) {
+                    // Not holding the claim while the task runs lets a thief take the rest of the inbox meanwhile.
+                    lease.unclaim();
+                    if (!self.backlog_.load(std::memory_order_relaxed)) DAKING_UNLIKELY {
+                        self.backlog_.store(true, std::memory_order_relaxed);
+                    }
+                    idle = 0;
+                    task();
+                    continue;
+                }
+                if (self.backlog_.load(std::memory_order_relaxed)) {
+                    self.backlog_.store(false, std::memory_order_relaxed);
+                }
+                if (std::size_t count = _steal(index, stolen)) {
+                    idle = 0;
+                    for (std::size_t i = 0; i < count; i++) {
+                        stolen[i]();
+                    }
+                    continue;
+                }
+                if (++idle < 64) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                _park(self, lease);
+                idle = 0;
+            }
+            current_executor_ = nullptr;
+        }
+
+        std::size_t _steal(std::size_t thief, task_type* out) {
+            for (std::size_t step = 1; step < workers_.size(); step++) {
+                worker_t& victim = workers_[(thief + step) % workers_.size()];
+                if (!victim.backlog_.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                auto lease = victim.inbox_.acquire_consumer();
+                if (std::size_t count = lease.try_dequeue_bulk(out, steal_batch)) {
+                    return count;
+                }
+            }
+            return 0;
+        }
+
+        void _park(worker_t& self, MPSC_queue<task_type>::consumer_lease& lease) {
+            std::unique_lock<std::mutex> lock(self.mutex_);
+            self.sleeping_.store(true, std::memory_order_relaxed);
+            idle_count_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!lease.empty() || self.stop_.load(std::memory_order_acquire)) {
+                self.sleeping_.store(false, std::memory_order_relaxed);
+                idle_count_.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            // Woken by a post to this inbox, or to steal from a busy one. The timeout is only a safety net.
+            self.wake_.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+                return !self.sleeping_.load(std::memory_order_relaxed) || self.stop_.load(std::memory_order_acquire);
+            });
+            self.sleeping_.store(false, std::memory_order_relaxed);
+            idle_count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        void _wake(worker_t& worker) {
+            std::lock_guard<std::mutex> lock(worker.mutex_);
+            worker.sleeping_.store(false, std::memory_order_relaxed);
+            worker.wake_.notify_one();
+        }
+
+        void _wake_idle() {
+            for (auto& worker : workers_) {
+                if (worker.sleeping_.load(std::memory_order_relaxed)) {
+                    _wake(worker);
+                    return;
+                }
+            }
+        }
+
+        std::vector<worker_t>                workers_;
+        alignas(64) std::atomic<std::size_t> idle_count_{ 0 };
+
+        inline static thread_local executor*   current_executor_ = nullptr;
+        inline static thread_local std::size_t current_index_    = 0;
+        inline static thread_local std::size_t post_cursor_      = 0;
+    };
+}
+
+#endif // !DAKING_EXECUTOR_HPP
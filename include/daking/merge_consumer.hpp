@@ -0,0 +1,252 @@
+/*
+MIT License
+
+Copyright (c) 2025 dakingffo
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(_MSC_VER) && _MSC_VER > 1000 || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 3)
+#pragma once
+#endif
+
+#ifndef DAKING_MERGE_CONSUMER_HPP
+#define DAKING_MERGE_CONSUMER_HPP
+
+#include "daking/MPSC_queue.hpp"
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <type_traits>
+#include <initializer_list>
+
+namespace daking {
+
+    /*
+         The consumer of N queues at once, handing out their elements in order of a user-supplied key (a timestamp).
+         Elements are only ordered within each queue, so the merger stages up to stage_capacity (rounded up to a power of two) elements of every queue
+         in a small ring, keeps the ring fronts in a min-heap and releases the smallest one when it is safe:
+             daking::MPSC_merge_consumer<FeedQueue, decltype(ts)> merger({ &feed_a, &feed_b }, ts);
+             Event e;
+             while (merger.try_dequeue(e)) { ... }
+         - Strict (no window): the smallest front is released only when every queue that is not closed has one,
+           so the output is in global order, and one silent feed holds the others back.
+         - reorder_window w: a front is also released once the newest key staged is at least w past it.
+           An element that then shows up with a key older than the last one released is handed out at once,
+           and counted by late_count().
+         A release is a heap pop and push, O(log N). The merger is the consumer of these queues.
+    */
+    template <typename Queue, typename KeyFn>
+    class MPSC_merge_consumer {
+    public:
+        using queue_type = Queue;
+        using value_type = typename Queue::value_type;
+        using size_type  = std::size_t;
+        using key_type   = std::decay_t<std::invoke_result_t<KeyFn&, const value_type&>>;
+
+        static_assert(std::is_default_constructible_v<value_type>, "The merger stages value_type in place.");
+
+        MPSC_merge_consumer(std::initializer_list<Queue*> queues, KeyFn key = KeyFn(),
+            std::optional<key_type> reorder_window = std::nullopt, size_type stage_capacity = 64)
+            : MPSC_merge_consumer(std::vector<Queue*>(queues), std::move(key), reorder_window, stage_capacity) {}
+
+        MPSC_merge_consumer(std::vector<Queue*> queues, KeyFn key = KeyFn(),
+            std::optional<key_type> reorder_window = std::nullopt, size_type stage_capacity = 64)
+            : queues_(std::move(queues)), key_(std::move(key)), window_(reorder_window),
+              capacity_(_round_up(stage_capacity)), mask_(capacity_ - 1), slots_(queues_.size()) {
+            for (auto& slot : slots_) {
+                slot.ring_.resize(capacity_);
+            }
+            heap_.reserve(queues_.size());
+        }
+
+        MPSC_merge_consumer(const MPSC_merge_consumer&)            = delete;
+        MPSC_merge_consumer& operator=(const MPSC_merge_consumer&) = delete;
+
+        template <typename T>
+        bool try_dequeue(T& value) {
+            if (!_releasable()) {
+                _poll();
+                if (!_releasable()) {
+                    return false;
+                }
+            }
+            _release(value);
+            return true;
+        }
+
+        template <typename OutputIt>
+        size_type try_dequeue_bulk(OutputIt it, size_type n) {
+            // The queues are polled at most once per call.
+            size_type count = 0;
+            bool polled = false;
+            while (count < n) {
+                if (!_releasable()) {
+                    if (polled) {
+                        break;
+                    }
+                    _poll();
+                    polled = true;
+                    continue;
+                }
+                _release(*it);
+                ++it;
+                ++count;
+            }
+            return count;
+        }
+
+        // Every queue is closed and drained, and nothing is staged.
+        bool drained() const noexcept {
+            return heap_.empty() && closed_count_ == queues_.size();
+        }
+
+        size_type late_count() const noexcept {
+            return late_count_;
+        }
+
+        size_type queue_count() const noexcept {
+            return queues_.size();
+        }
+
+    private:
+        struct slot_t {
+            std::vector<value_type> ring_;
+            size_type               head_      = 0;
+            size_type               size_      = 0;
+            key_type                front_key_{};
+            bool                    closed_    = false;
+        };
+
+        static size_type _round_up(size_type n) noexcept {
+            size_type pow2 = 1;
+            while (pow2 < n) pow2 <<= 1;
+            return pow2;
+        }
+
+        // Min-heap on (front key, queue index), the index keeps equal keys in a stable order.
+        bool _later(size_type a, size_type b) const {
+            if (slots_[b].front_key_ < slots_[a].front_key_) return true;
+            if (slots_[a].front_key_ < slots_[b].front_key_) return false;
+            return a > b;
+        }
+
+        void _push(size_type index) {
+            heap_.push_back(index);
+            std::push_heap(heap_.begin(), heap_.end(), [this](size_type a, size_type b) { return _later(a, b); });
+        }
+
+        size_type _pop() {
+            std::pop_heap(heap_.begin(), heap_.end(), [this](size_type a, size_type b) { return _later(a, b); });
+            size_type index = heap_.back();
+            heap_.pop_back();
+            return index;
+        }
+
+        bool _stage(size_type index) {
+            slot_t& slot = slots_[index];
+            if (slot.closed_ || slot.size_ == capacity_) {
+                return false;
+            }
+            value_type& target = slot.ring_[(slot.head_ + slot.size_) & mask_];
+            switch (queues_[index]->try_dequeue_status(target)) {
+            case MPSC_dequeue_status::dequeued: {
+                key_type key = key_(static_cast<const value_type&>(target));
+                if (!newest_ || *newest_ < key) {
+                    newest_ = key;
+                }
+                if (slot.size_++ == 0) {
+                    slot.front_key_ = key;
+                    ++staged_count_;
+                    _push(index);
+                }
+                return true;
+            }
+            case MPSC_dequeue_status::closed:
+                slot.closed_ = true;
+                if (slot.size_ == 0) {
+                    ++closed_count_; // Otherwise counted when _release empties the ring.
+                }
+                return false;
+            default:
+                return false;
+            }
+        }
+
+        void _poll() {
+            // Filling the rings (not just their fronts) amortizes a poll over many releases, and lets newest_ move.
+            for (size_type i = 0; i < queues_.size(); i++) {
+                while (_stage(i)) {}
+            }
+        }
+
+        bool _releasable() const {
+            if (heap_.empty()) DAKING_UNLIKELY {
+                return false;
+            }
+            if (staged_count_ + closed_count_ == queues_.size()) DAKING_LIKELY {
+                return true; // Every queue not closed and drained has a front, the smallest is the global minimum.
+            }
+            return window_ && !(*newest_ < slots_[heap_.front()].front_key_ + *window_);
+        }
+
+        template <typename T>
+        void _release(T&& out) {
+            size_type index = _pop();
+            slot_t& slot = slots_[index];
+            if (last_released_ && slot.front_key_ < *last_released_) DAKING_UNLIKELY {
+                ++late_count_;
+            }
+            else {
+                last_released_ = slot.front_key_;
+            }
+            out = std::move(slot.ring_[slot.head_]);
+            slot.head_ = (slot.head_ + 1) & mask_;
+            if (--slot.size_ == 0) {
+                --staged_count_;
+                if (slot.closed_) {
+                    ++closed_count_;
+                }
+                else {
+                    _stage(index); // The queue just popped is the most likely one to have more.
+                }
+            }
+            else {
+                slot.front_key_ = key_(static_cast<const value_type&>(slot.ring_[slot.head_]));
+                _push(index);
+            }
+        }
+
+        std::vector<Queue*>     queues_;
+        KeyFn                   key_;
+        std::optional<key_type> window_;
+        size_type               capacity_;
+        size_type               mask_;
+        std::vector<slot_t>     slots_;
+        std::vector<size_type>  heap_;
+        size_type               staged_count_ = 0;
+        size_type               closed_count_ = 0; /* Closed, with nothing staged */
+        size_type               late_count_   = 0;
+        std::optional<key_type> newest_;
+        std::optional<key_type> last_released_;
+    };
+}
+
+#endif // !DAKING_MERGE_CONSUMER_HPP
@@ -0,0 +1,526 @@
+/*
+MIT License
+
+Copyright (c) 2025 dakingffo
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(_MSC_VER) && _MSC_VER > 1000 || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 3)
+#pragma once
+#endif
+
+#ifndef DAKING_SHM_QUEUE_HPP
+#define DAKING_SHM_QUEUE_HPP
+
+#include "daking/MPSC_queue.hpp"
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace daking {
+
+    /*
+         An MPSC queue between processes (POSIX): the nodes, the chunk stack and head/tail live in one shared memory segment
+         and refer to each other by node index instead of by pointer, so every process may map it at another address.
+             // Aggregator
+             auto queue = daking::MPSC_shm_queue<Event>::create("/plugin_events", 1 << 16);
+             Event buf[64];
+             std::size_t n = queue.try_dequeue_bulk(buf, 64);
+             // Plugin process, one producer handle per thread
+             auto queue = daking::MPSC_shm_queue<Event>::attach("/plugin_events");
+             auto producer = queue.make_producer();
+             producer.enqueue(Event{ ... });
+         The layout is the one of MPSC_queue: a Vyukov list of nodes, and a tagged stack of chunks of free nodes.
+         A producer handle is the thread-local pool of its thread: it takes a whole chunk at a time from the segment,
+         and gives back what it still holds when it is released. The consumer gives nodes back a chunk at a time as well.
+         - The segment has a fixed capacity (rounded up to whole chunks), a full segment makes enqueue wait for the consumer.
+         - Ty must be trivially copyable, and must not hold pointers that only make sense in one process.
+         - There is no recovery from a process that dies: a producer killed in the middle of an enqueue breaks the list,
+           and the nodes a dead producer cached are lost until the segment is created again.
+         - A single consumer (one thread of one process) at a time, close() may be called from any process.
+    */
+    template <typename Ty, std::size_t ThreadLocalCapacity = 256>
+    class MPSC_shm_queue {
+    public:
+        static_assert(std::is_trivially_copyable_v<Ty>, "Elements are copied between processes, Ty must be trivially copyable.");
+        static_assert((ThreadLocalCapacity & (ThreadLocalCapacity - 1)) == 0, "ThreadLocalCapacity must be a power of 2.");
+
+        using value_type = Ty;
+        using size_type  = std::size_t;
+        using index_type = std::uint32_t;
+
+        static constexpr std::size_t thread_local_capacity = ThreadLocalCapacity;
+
+    private:
+        static constexpr std::uint64_t segment_magic = 0x314d4853474e4b44ull; /* "DKNGSHM1" */
+
+        struct node_t {
+            std::atomic<index_type> next_{ 0 };       /* Index of the next node, 0 is null, node i is nodes_[i - 1] */
+            std::atomic<index_type> next_chunk_{ 0 }; /* Chunk stack link, on the first node of a chunk */
+            index_type              chunk_size_ = 0;  /* Node count of the chunk, on its first node */
+            alignas(Ty) unsigned char value_[sizeof(Ty)];
+        };
+
+        struct header_t {
+            std::atomic<std::uint64_t> magic_{ 0 };   /* Stored last by create, checked by attach */
+            std::uint64_t              value_size_;
+            std::uint64_t              value_align_;
+            std::uint64_t              thread_local_capacity_;
+            std::uint64_t              node_count_;
+            std::uint64_t              segment_size_;
+
+            alignas(64) std::atomic<index_type> head_{ 0 };
+            std::atomic<std::uint32_t>          closed_{ 0 };
+
+            alignas(64) std::atomic<std::uint64_t> free_top_{ 0 }; /* (tag << 32) | index of the first free chunk */
+
+            alignas(64) index_type tail_ = 0;                  /* Consumer only */
+            std::uint32_t          passed_close_ = 0;          /* Consumer only */
+        };
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<index_type>::is_always_lock_free,
+            "Atomics in shared memory must be lock free.");
+
+        static constexpr index_type dummy_index  = 1;
+        static constexpr index_type marker_index = 2; /* Linked by close(), never recycled */
+        static constexpr index_type first_chunk  = 3;
+
+        // The mapping of one process: what both the queue and its producer handles need.
+        struct segment_t {
+            header_t* header_ = nullptr;
+            node_t*   nodes_  = nullptr;
+
+            DAKING_ALWAYS_INLINE node_t& node(index_type index) const noexcept {
+                return nodes_[index - 1];
+            }
+
+            DAKING_ALWAYS_INLINE void push_chunk(index_type first, index_type size) const noexcept {
+                node(first).chunk_size_ = size;
+                std::uint64_t old_top = header_->free_top_.load(std::memory_order_relaxed);
+                std::uint64_t new_top;
+                do {
+                    node(first).next_chunk_.store((index_type)old_top, std::memory_order_relaxed);
+                    new_top = ((old_top >> 32) + 1) << 32 | first;
+                } while (!header_->free_top_.compare_exchange_weak(
+                    old_top, new_top, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            DAKING_ALWAYS_INLINE index_type pop_chunk(index_type& size) const noexcept {
+                std::uint64_t old_top = header_->free_top_.load(std::memory_order_acquire);
+                std::uint64_t new_top;
+                do {
+                    if ((index_type)old_top == 0) {
+                        return 0;
+                    }
+                    // Same healthy race as MPSC_chunk_stack::try_pop: a stale next_chunk_ never passes the tagged CAS.
+                    new_top = ((old_top >> 32) + 1) << 32 | node((index_type)old_top).next_chunk_.load(std::memory_order_relaxed);
+                } while (!header_->free_top_.compare_exchange_weak(
+                    old_top, new_top, std::memory_order_acquire, std::memory_order_acquire));
+                size = node((index_type)old_top).chunk_size_;
+                return (index_type)old_top;
+            }
+
+            DAKING_ALWAYS_INLINE void link(index_type first, index_type last) const noexcept {
+                index_type old_head = header_->head_.exchange(last, std::memory_order_acq_rel);
+                node(old_head).next_.store(first, std::memory_order_release);
+            }
+
+            DAKING_ALWAYS_INLINE bool is_closed() const noexcept {
+                return header_->closed_.load(std::memory_order_relaxed) != 0;
+            }
+        };
+
+    public:
+        /*
+             The thread-local pool of one producer thread, in any process that mapped the segment.
+             Not thread safe: use one handle per thread. Destroying it gives the cached nodes back to the segment.
+        */
+        class producer {
+        public:
+            producer() noexcept = default;
+
+            producer(producer&& other) noexcept
+                : segment_(std::exchange(other.segment_, segment_t{})),
+                  list_(std::exchange(other.list_, 0)), size_(std::exchange(other.size_, 0)) {}
+
+            producer& operator=(producer&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    segment_ = std::exchange(other.segment_, segment_t{});
+                    list_    = std::exchange(other.list_, 0);
+                    size_    = std::exchange(other.size_, 0);
+                }
+                return *this;
+            }
+
+            ~producer() {
+                release();
+            }
+
+            explicit operator bool() const noexcept {
+                return segment_.header_ != nullptr;
+            }
+
+            // False if the queue is closed, or if the segment has no free node right now.
+            DAKING_ALWAYS_INLINE bool try_enqueue(const value_type& value) noexcept {
+                if (segment_.is_closed()) DAKING_UNLIKELY {
+                    return false;
+                }
+                index_type index = _try_allocate();
+                if (index == 0) DAKING_UNLIKELY {
+                    return false;
+                }
+                ::new (static_cast<void*>(segment_.node(index).value_)) value_type(value);
+                segment_.link(index, index);
+                return true;
+            }
+
+            // Waits for the consumer while the segment is full. False if the queue is closed.
+            DAKING_ALWAYS_INLINE bool enqueue(const value_type& value) noexcept {
+                while (!try_enqueue(value)) {
+                    if (segment_.is_closed()) {
+                        return false;
+                    }
+                    std::this_thread::yield();
+                }
+                return true;
+            }
+
+            // Up to n elements linked with one exchange, fewer if the segment runs out of free nodes.
+            template <typename InputIt>
+            size_type try_enqueue_bulk(InputIt it, size_type n) {
+                if (n == 0 || segment_.is_closed()) DAKING_UNLIKELY {
+                    return 0;
+                }
+                index_type first = 0, last = 0;
+                size_type count = 0;
+                for (; count < n; ++count, ++it) {
+                    index_type index = _try_allocate();
+                    if (index == 0) DAKING_UNLIKELY {
+                        break;
+                    }
+                    ::new (static_cast<void*>(segment_.node(index).value_)) value_type(*it);
+                    if (last) {
+                        segment_.node(last).next_.store(index, std::memory_order_relaxed);
+                    }
+                    else {
+                        first = index;
+                    }
+                    last = index;
+                }
+                if (count) {
+                    segment_.link(first, last);
+                }
+                return count;
+            }
+
+            // Gives the cached nodes back to the segment, the handle becomes empty.
+            void release() noexcept {
+                if (segment_.header_ && list_) {
+                    segment_.push_chunk(list_, size_);
+                }
+                segment_ = segment_t{};
+                list_ = size_ = 0;
+            }
+
+        private:
+            friend class MPSC_shm_queue;
+
+            explicit producer(segment_t segment) noexcept : segment_(segment) {}
+
+            DAKING_ALWAYS_INLINE index_type _try_allocate() noexcept {
+                if (size_ == 0) DAKING_UNLIKELY {
+                    list_ = segment_.pop_chunk(size_);
+                    if (list_ == 0) {
+                        return 0;
+                    }
+                }
+                index_type index = list_;
+                node_t& node = segment_.node(index);
+                list_ = node.next_.load(std::memory_order_relaxed);
+                size_--;
+                node.next_.store(0, std::memory_order_relaxed);
+                return index;
+            }
+
+            segment_t  segment_;
+            index_type list_ = 0;
+            index_type size_ = 0;
+        };
+
+        // Creates the segment /name (shm_open), fails if it exists. The segment is unlinked when this object is destroyed.
+        static MPSC_shm_queue create(const std::string& name, size_type capacity) {
+            int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+            }
+            MPSC_shm_queue queue(fd, name);
+            queue._create(capacity);
+            return queue;
+        }
+
+        // Maps the existing segment /name.
+        static MPSC_shm_queue attach(const std::string& name) {
+            int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+            }
+            MPSC_shm_queue queue(fd, std::string());
+            queue._attach();
+            return queue;
+        }
+
+#if defined(__linux__)
+        // A segment without a name (memfd), handed to other processes through fd(): fork, exec or SCM_RIGHTS.
+        static MPSC_shm_queue create_anonymous(size_type capacity) {
+            int fd = ::memfd_create("daking_mpsc_shm_queue", MFD_CLOEXEC);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "memfd_create");
+            }
+            MPSC_shm_queue queue(fd, std::string());
+            queue._create(capacity);
+            return queue;
+        }
+#endif
+
+        // Maps the segment behind fd, which stays owned by the caller.
+        static MPSC_shm_queue attach_fd(int fd) {
+            int own_fd = ::dup(fd);
+            if (own_fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "dup");
+            }
+            MPSC_shm_queue queue(own_fd, std::string());
+            queue._attach();
+            return queue;
+        }
+
+        MPSC_shm_queue(MPSC_shm_queue&& other) noexcept
+            : segment_(std::exchange(other.segment_, segment_t{})), map_size_(std::exchange(other.map_size_, 0)),
+              fd_(std::exchange(other.fd_, -1)), name_(std::move(other.name_)), free_list_(std::exchange(other.free_list_, 0)),
+              free_size_(std::exchange(other.free_size_, 0)) {}
+
+        MPSC_shm_queue& operator=(MPSC_shm_queue&& other) noexcept {
+            if (this != &other) {
+                _unmap();
+                segment_   = std::exchange(other.segment_, segment_t{});
+                map_size_  = std::exchange(other.map_size_, 0);
+                fd_        = std::exchange(other.fd_, -1);
+                name_      = std::move(other.name_);
+                free_list_ = std::exchange(other.free_list_, 0);
+                free_size_ = std::exchange(other.free_size_, 0);
+            }
+            return *this;
+        }
+
+        MPSC_shm_queue(const MPSC_shm_queue&)            = delete;
+        MPSC_shm_queue& operator=(const MPSC_shm_queue&) = delete;
+
+        ~MPSC_shm_queue() {
+            _unmap();
+        }
+
+        // The producer handle of the calling thread, valid as long as this mapping is.
+        producer make_producer() noexcept {
+            return producer(segment_);
+        }
+
+        template <typename T>
+        DAKING_ALWAYS_INLINE bool try_dequeue(T& value) noexcept {
+            return try_dequeue_status(value) == MPSC_dequeue_status::dequeued;
+        }
+
+        template <typename T>
+        DAKING_ALWAYS_INLINE MPSC_dequeue_status try_dequeue_status(T& value) noexcept {
+            static_assert(std::is_assignable_v<T&, const value_type&>);
+            header_t& header = *segment_.header_;
+            index_type next = segment_.node(header.tail_).next_.load(std::memory_order_acquire);
+            if (next == marker_index) DAKING_UNLIKELY {
+                // Step over the marker, it becomes the dummy node. What follows it raced with close().
+                _deallocate(std::exchange(header.tail_, next));
+                header.passed_close_ = 1;
+                next = segment_.node(header.tail_).next_.load(std::memory_order_acquire);
+            }
+            if (next) DAKING_LIKELY {
+                value = *std::launder(reinterpret_cast<const value_type*>(segment_.node(next).value_));
+                _deallocate(std::exchange(header.tail_, next));
+                return MPSC_dequeue_status::dequeued;
+            }
+            return header.passed_close_ ? MPSC_dequeue_status::closed : MPSC_dequeue_status::empty;
+        }
+
+        template <typename OutputIt>
+        DAKING_ALWAYS_INLINE size_type try_dequeue_bulk(OutputIt it, size_type n) noexcept {
+            size_type count = 0;
+            while (count < n && try_dequeue(*it)) {
+                ++count;
+                ++it;
+            }
+            return count;
+        }
+
+        DAKING_ALWAYS_INLINE bool empty() const noexcept {
+            index_type next = segment_.node(segment_.header_->tail_).next_.load(std::memory_order_acquire);
+            return next == 0 || (next == marker_index && segment_.node(next).next_.load(std::memory_order_acquire) == 0);
+        }
+
+        // Same contract as MPSC_queue::close, from any process that mapped the segment.
+        void close() noexcept {
+            if (segment_.header_->closed_.exchange(1, std::memory_order_acq_rel)) {
+                return;
+            }
+            segment_.link(marker_index, marker_index);
+        }
+
+        DAKING_ALWAYS_INLINE bool is_closed() const noexcept {
+            return segment_.is_closed();
+        }
+
+        // Elements the segment holds at most.
+        size_type capacity() const noexcept {
+            return segment_.header_->node_count_ - first_chunk + 1;
+        }
+
+        int fd() const noexcept {
+            return fd_;
+        }
+
+    private:
+        MPSC_shm_queue(int fd, std::string name) noexcept : fd_(fd), name_(std::move(name)) {}
+
+        static constexpr size_type _nodes_offset() noexcept {
+            return (sizeof(header_t) + alignof(node_t) - 1) / alignof(node_t) * alignof(node_t);
+        }
+
+        void _map(size_type segment_size) {
+            void* base = ::mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (base == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap");
+            }
+            map_size_        = segment_size;
+            segment_.header_ = static_cast<header_t*>(base);
+            segment_.nodes_  = reinterpret_cast<node_t*>(static_cast<unsigned char*>(base) + _nodes_offset());
+        }
+
+        void _create(size_type capacity) {
+            size_type chunk_count = (capacity + thread_local_capacity - 1) / thread_local_capacity;
+            size_type node_count  = chunk_count * thread_local_capacity + first_chunk - 1;
+            if (chunk_count == 0 || node_count >= (size_type)UINT32_MAX) {
+                _unmap();
+                throw std::invalid_argument("MPSC_shm_queue: capacity out of range");
+            }
+            size_type segment_size = _nodes_offset() + node_count * sizeof(node_t);
+            if (::ftruncate(fd_, (off_t)segment_size) != 0) {
+                int error = errno;
+                _unmap();
+                throw std::system_error(error, std::generic_category(), "ftruncate");
+            }
+            _map(segment_size);
+
+            header_t* header = ::new (static_cast<void*>(segment_.header_)) header_t();
+            header->value_size_            = sizeof(value_type);
+            header->value_align_           = alignof(value_type);
+            header->thread_local_capacity_ = thread_local_capacity;
+            header->node_count_            = node_count;
+            header->segment_size_          = segment_size;
+            for (size_type i = 0; i < node_count; i++) {
+                ::new (static_cast<void*>(segment_.nodes_ + i)) node_t();
+            }
+
+            header->head_.store(dummy_index, std::memory_order_relaxed);
+            header->tail_ = dummy_index;
+            for (size_type c = 0; c < chunk_count; c++) {
+                index_type first = (index_type)(first_chunk + c * thread_local_capacity);
+                for (index_type i = 0; i + 1 < thread_local_capacity; i++) {
+                    segment_.node(first + i).next_.store(first + i + 1, std::memory_order_relaxed);
+                }
+                segment_.push_chunk(first, (index_type)thread_local_capacity);
+            }
+            header->magic_.store(segment_magic, std::memory_order_release);
+        }
+
+        void _attach() {
+            struct stat info;
+            if (::fstat(fd_, &info) != 0) {
+                int error = errno;
+                _unmap();
+                throw std::system_error(error, std::generic_category(), "fstat");
+            }
+            if ((size_type)info.st_size < sizeof(header_t)) {
+                _unmap();
+                throw std::runtime_error("MPSC_shm_queue: not an initialized segment");
+            }
+            _map((size_type)info.st_size);
+            const header_t& header = *segment_.header_;
+            if (header.magic_.load(std::memory_order_acquire) != segment_magic ||
+                header.value_size_ != sizeof(value_type) || header.value_align_ != alignof(value_type) ||
+                header.thread_local_capacity_ != thread_local_capacity || header.segment_size_ != (size_type)info.st_size) {
+                _unmap();
+                throw std::runtime_error("MPSC_shm_queue: the segment was created for another element type or capacity");
+            }
+        }
+
+        DAKING_ALWAYS_INLINE void _deallocate(index_type index) noexcept {
+            // The marker is never recycled, so a late producer can never take it for an element.
+            if (index == marker_index) DAKING_UNLIKELY {
+                return;
+            }
+            segment_.node(index).next_.store(free_list_, std::memory_order_relaxed);
+            free_list_ = index;
+            if (++free_size_ == thread_local_capacity) DAKING_UNLIKELY {
+                segment_.push_chunk(std::exchange(free_list_, 0), std::exchange(free_size_, 0));
+            }
+        }
+
+        void _unmap() noexcept {
+            if (segment_.header_) {
+                if (free_list_) {
+                    segment_.push_chunk(std::exchange(free_list_, 0), std::exchange(free_size_, 0));
+                }
+                ::munmap(segment_.header_, map_size_);
+                segment_  = segment_t{};
+                map_size_ = 0;
+            }
+            if (fd_ >= 0) {
+                ::close(std::exchange(fd_, -1));
+            }
+            if (!name_.empty()) {
+                ::shm_unlink(name_.c_str());
+                name_.clear();
+            }
+        }
+
+        segment_t   segment_;
+        size_type   map_size_ = 0;
+        int         fd_ = -1;
+        std::string name_;      /* Set for the creator of a named segment, which unlinks it */
+        index_type  free_list_ = 0; /* Consumer side thread-local pool */
+        index_type  free_size_ = 0;
+    };
+}
+
+#endif // !DAKING_SHM_QUEUE_HPP
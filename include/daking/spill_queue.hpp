@@ -0,0 +1,491 @@
+/*
+MIT License
+
+Copyright (c) 2025 dakingffo
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(_MSC_VER) && _MSC_VER > 1000 || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 3)
+#pragma once
+#endif
+
+#ifndef DAKING_SPILL_QUEUE_HPP
+#define DAKING_SPILL_QUEUE_HPP
+
+#include "daking/MPSC_queue.hpp"
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <optional>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace daking {
+
+    /*
+         How MPSC_spill_queue writes an element to its segment file and reads it back.
+         The primary template copies the bytes of a trivially copyable Ty, specialize it for anything else:
+             template <> struct daking::MPSC_spill_traits<std::string> {
+                 static std::size_t size(const std::string& s) noexcept { return s.size(); }
+                 static void write(const std::string& s, unsigned char* dst) noexcept { std::memcpy(dst, s.data(), s.size()); }
+                 static std::string read(const unsigned char* src, std::size_t size) { return std::string((const char*)src, size); }
+             };
+         dst and src are 8-byte aligned, read gets back the size that size() returned.
+    */
+    template <typename Ty>
+    struct MPSC_spill_traits {
+        static_assert(std::is_trivially_copyable_v<Ty>, "Specialize MPSC_spill_traits<Ty> to spill a Ty that is not trivially copyable.");
+
+        static std::size_t size(const Ty&) noexcept {
+            return sizeof(Ty);
+        }
+
+        static void write(const Ty& value, unsigned char* dst) noexcept {
+            std::memcpy(dst, std::addressof(value), sizeof(Ty));
+        }
+
+        static Ty read(const unsigned char* src, std::size_t) noexcept {
+            alignas(Ty) unsigned char bytes[sizeof(Ty)];
+            std::memcpy(bytes, src, sizeof(Ty));
+            return *std::launder(reinterpret_cast<Ty*>(bytes));
+        }
+    };
+
+    struct MPSC_spill_options {
+        std::string directory;                 /* Empty means $TMPDIR, or /tmp */
+        std::size_t segment_size = 64u << 20;  /* Bytes per segment file, a larger element gets a segment of its own */
+    };
+
+    /*
+         An unbounded MPSC_queue that keeps its memory bounded: under a node budget, what does not fit is appended
+         to mmap-backed segment files, and the consumer reads it back in FIFO order before it returns to the nodes.
+             using AuditQueue = daking::MPSC_spill_queue<AuditRecord>;
+             AuditQueue::set_global_node_budget(1 << 20);
+             AuditQueue queue({ "/var/spool/audit" });
+             queue.enqueue(record);                    // Any thread, never waits for the consumer.
+             while (queue.try_dequeue(record)) { ... }
+         - Elements live in the nodes of an MPSC_queue<std::optional<Ty>> while the budget allows, at the cost of
+           one seq_cst fence per enqueue. A failed try_enqueue starts a spill episode: the producer links an empty
+           optional (a marker) and appends the element to the current segment, as does every enqueue until
+           the consumer has read the segment to its end. enqueue_bulk spills a whole batch under one lock.
+         - The consumer that dequeues a marker reads the file until it is drained, then goes on with the nodes.
+           A producer that linked a node just as an episode began links a marker after it and writes a
+           "back to the nodes" record, so every producer still sees its elements dequeued in order.
+         - Spilling takes a mutex and copies through traits, it is a slow path: size the budget for the usual backlog.
+           Without a budget nothing is ever spilled. A segment file is unlinked once the consumer has read it.
+    */
+    template <typename Ty, typename Traits = MPSC_spill_traits<Ty>, std::size_t ThreadLocalCapacity = 256, std::size_t Align = 64>
+    class MPSC_spill_queue {
+    public:
+        using value_type  = Ty;
+        using traits_type = Traits;
+        using queue_type  = MPSC_queue<std::optional<Ty>, ThreadLocalCapacity, Align>;
+        using size_type   = typename queue_type::size_type;
+
+        explicit MPSC_spill_queue(MPSC_spill_options options = MPSC_spill_options())
+            : options_(std::move(options)), instance_(next_instance_++), marker_(queue_.prepare()) {
+            if (options_.directory.empty()) {
+                const char* tmp = std::getenv("TMPDIR");
+                options_.directory = tmp && *tmp ? tmp : "/tmp";
+            }
+        }
+
+        ~MPSC_spill_queue() {
+            while (read_segment_) {
+                _destroy_segment(std::exchange(read_segment_, read_segment_->next_));
+            }
+        }
+
+        MPSC_spill_queue(const MPSC_spill_queue&)            = delete;
+        MPSC_spill_queue& operator=(const MPSC_spill_queue&) = delete;
+
+        bool enqueue(const value_type& value) {
+            return _enqueue(
+                [&]() { return queue_.try_emplace(value); },
+                [&]() { _append(value); });
+        }
+
+        bool enqueue(value_type&& value) {
+            // try_emplace only moves from value once it has a node, a spilled value is copied from where it is.
+            return _enqueue(
+                [&]() { return queue_.try_emplace(std::move(value)); },
+                [&]() { _append(value); });
+        }
+
+        template <typename InputIt>
+        bool enqueue_bulk(InputIt it, size_type n) {
+            // All n elements go either to the nodes (one exchange) or to the file (one lock).
+            static_assert(std::is_same_v<typename std::iterator_traits<InputIt>::value_type, value_type>,
+                "The value type of iterator must be same as MPSC_spill_queue::value_type.");
+            if (n == 0) DAKING_UNLIKELY {
+                return true;
+            }
+            return _enqueue(
+                [&]() {
+                    auto batch = queue_.try_prepare_n(n);
+                    if (!batch) {
+                        return false;
+                    }
+                    for (void* storage : batch) {
+                        ::new (storage) std::optional<Ty>(*it);
+                        ++it;
+                    }
+                    return batch.commit_all();
+                },
+                [&]() {
+                    for (size_type i = 0; i < n; i++, ++it) {
+                        _append(*it);
+                    }
+                });
+        }
+
+        template <typename T>
+        bool try_dequeue(T& value) {
+            return try_dequeue_status(value) == MPSC_dequeue_status::dequeued;
+        }
+
+        template <typename T>
+        MPSC_dequeue_status try_dequeue_status(T& value) {
+            while (true) {
+                if (reading_file_) DAKING_UNLIKELY {
+                    switch (_read(value)) {
+                    case read_result::record:
+                        return MPSC_dequeue_status::dequeued;
+                    case read_result::empty:
+                        return MPSC_dequeue_status::empty;
+                    default:
+                        reading_file_ = false;
+                    }
+                }
+                MPSC_dequeue_status status = queue_.try_dequeue_status(entry_);
+                if (status != MPSC_dequeue_status::dequeued) {
+                    return status;
+                }
+                if (entry_) DAKING_LIKELY {
+                    value = std::move(*entry_);
+                    return MPSC_dequeue_status::dequeued;
+                }
+                // A marker: what comes next is in the file.
+                reading_file_ = true;
+                _refill_marker();
+            }
+        }
+
+        template <typename OutputIt>
+        size_type try_dequeue_bulk(OutputIt it, size_type n) {
+            size_type count = 0;
+            while (count < n && try_dequeue(*it)) {
+                ++it;
+                ++count;
+            }
+            return count;
+        }
+
+        void close() {
+            // Spilled elements are read before the close marker: their episode began with an earlier marker,
+            // and the consumer only leaves the file once it is drained.
+            queue_.close();
+        }
+
+        bool is_closed() const noexcept {
+            return queue_.is_closed();
+        }
+
+        // Producers are writing to the file now.
+        bool spilling() const noexcept {
+            return episode_.load(std::memory_order_relaxed) & 1;
+        }
+
+        // Elements appended to segment files so far.
+        size_type spilled_count() const noexcept {
+            return spilled_count_.load(std::memory_order_relaxed);
+        }
+
+        const MPSC_spill_options& options() const noexcept {
+            return options_;
+        }
+
+        static void set_global_node_budget(size_type max_node_count, MPSC_overflow_handler handler = nullptr) {
+            queue_type::set_global_node_budget(max_node_count, handler);
+        }
+
+        static size_type global_node_budget() {
+            return queue_type::global_node_budget();
+        }
+
+        static size_type global_node_size_apprx() noexcept {
+            return queue_type::global_node_size_apprx();
+        }
+
+    private:
+        using header_t = std::uint64_t; /* Payload size, or one of the tags below */
+
+        static constexpr header_t    end_of_segment = ~header_t(0);     /* Continue with segment_t::next_ */
+        static constexpr header_t    back_to_nodes  = ~header_t(0) - 1; /* Continue with the nodes up to the next marker */
+        static constexpr std::size_t record_align   = alignof(header_t);
+
+        struct segment_t {
+            unsigned char*      data_     = nullptr;
+            size_type           capacity_ = 0;
+            size_type           written_  = 0;       /* Under mutex_ */
+            std::atomic<size_type> committed_{ 0 };  /* Bytes the consumer may read */
+            segment_t*          next_     = nullptr; /* Set before the end_of_segment record is committed */
+            int                 fd_       = -1;
+            std::string         path_;
+        };
+
+        enum class enqueue_result { spilled, closed, retry };
+        enum class read_result { record, empty, nodes };
+
+        static size_type _pad(size_type size) noexcept {
+            return (size + record_align - 1) / record_align * record_align;
+        }
+
+        template <typename ToNodes, typename ToFile>
+        bool _enqueue(ToNodes&& to_nodes, ToFile&& to_file) {
+            while (true) {
+                std::uint64_t episode = episode_.load(std::memory_order_acquire);
+                bool nodes_full = false;
+                if (!(episode & 1)) DAKING_LIKELY {
+                    if (to_nodes()) DAKING_LIKELY {
+                        // Pairs with the fence in _try_spill: either the marker of an episode is linked after our node,
+                        // or we see the episode here and make sure that our next spilled elements come after the node.
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        std::uint64_t now = episode_.load(std::memory_order_relaxed);
+                        if (now & 1) DAKING_UNLIKELY {
+                            _split(now);
+                        }
+                        return true;
+                    }
+                    if (queue_.is_closed()) DAKING_UNLIKELY {
+                        return false;
+                    }
+                    nodes_full = true;
+                }
+                switch (_try_spill(to_file, nodes_full)) {
+                case enqueue_result::spilled:
+                    return true;
+                case enqueue_result::closed:
+                    return false;
+                default:
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        template <typename ToFile>
+        enqueue_result _try_spill(ToFile& to_file, bool nodes_full) {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (queue_.is_closed()) DAKING_UNLIKELY {
+                return enqueue_result::closed;
+            }
+            std::uint64_t episode = episode_.load(std::memory_order_relaxed);
+            if (!(episode & 1)) {
+                if (!nodes_full) {
+                    return enqueue_result::retry; // The consumer ended the episode, try the nodes again.
+                }
+                if (!marker_) {
+                    marker_ = queue_.try_prepare();
+                    if (!marker_) {
+                        return enqueue_result::retry;
+                    }
+                }
+                if (!write_segment_) {
+                    read_segment_ = write_segment_ = _create_segment(options_.segment_size);
+                }
+                episode_.store(episode + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                marker_.emplace();
+                if (!marker_.commit()) {
+                    episode_.store(episode, std::memory_order_relaxed);
+                    return enqueue_result::closed;
+                }
+            }
+            to_file();
+            _publish();
+            return enqueue_result::spilled;
+        }
+
+        void _split(std::uint64_t episode) {
+            // Our node may be behind the marker of this episode, while the consumer is to read the whole file first:
+            // link another marker behind it and tell the consumer to go back to the nodes at this point of the file.
+            std::unique_lock<std::mutex> guard(mutex_);
+            while (!marker_) {
+                marker_ = queue_.try_prepare();
+                if (!marker_) {
+                    // The budget is full and the consumer is in the file: wait for it to get back to the nodes.
+                    guard.unlock();
+                    auto marker = queue_.prepare();
+                    guard.lock();
+                    marker_ = std::move(marker);
+                    if (queue_.is_closed()) {
+                        return;
+                    }
+                }
+            }
+            if (episode_.load(std::memory_order_relaxed) != episode || queue_.is_closed()) {
+                return; // The episode ended, the consumer already read the file up to where we would split it.
+            }
+            marker_.emplace();
+            if (marker_.commit()) {
+                *reinterpret_cast<header_t*>(_reserve(0)) = back_to_nodes;
+                _publish();
+            }
+        }
+
+        void _refill_marker() {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (!marker_) {
+                // The node of the marker just dequeued is in this thread's pool.
+                marker_ = queue_.try_prepare();
+            }
+        }
+
+        // Room for a record of payload size bytes, returns its header. Under mutex_.
+        unsigned char* _reserve(size_type size) {
+            size_type need = sizeof(header_t) + _pad(size);
+            segment_t* segment = write_segment_;
+            if (segment->written_ + need + sizeof(header_t) > segment->capacity_) DAKING_UNLIKELY {
+                segment_t* next = _create_segment(std::max(options_.segment_size, need + sizeof(header_t)));
+                segment->next_ = next;
+                *reinterpret_cast<header_t*>(segment->data_ + segment->written_) = end_of_segment;
+                segment->written_ += sizeof(header_t);
+                segment->committed_.store(segment->written_, std::memory_order_release);
+                write_segment_ = segment = next;
+            }
+            unsigned char* record = segment->data_ + segment->written_;
+            segment->written_ += need;
+            return record;
+        }
+
+        void _append(const value_type& value) {
+            size_type size = traits_type::size(value);
+            unsigned char* record = _reserve(size);
+            traits_type::write(value, record + sizeof(header_t));
+            *reinterpret_cast<header_t*>(record) = size;
+            spilled_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void _publish() noexcept {
+            write_segment_->committed_.store(write_segment_->written_, std::memory_order_release);
+        }
+
+        template <typename T>
+        read_result _read(T& value) {
+            while (true) {
+                segment_t* segment = read_segment_;
+                if (read_pos_ == segment->committed_.load(std::memory_order_acquire)) {
+                    return _try_end_episode() ? read_result::nodes : read_result::empty;
+                }
+                const unsigned char* record = segment->data_ + read_pos_;
+                header_t header = *reinterpret_cast<const header_t*>(record);
+                if (header == end_of_segment) DAKING_UNLIKELY {
+                    read_segment_ = segment->next_;
+                    read_pos_     = 0;
+                    _destroy_segment(segment);
+                    continue;
+                }
+                read_pos_ += sizeof(header_t);
+                if (header == back_to_nodes) DAKING_UNLIKELY {
+                    return read_result::nodes;
+                }
+                value = traits_type::read(record + sizeof(header_t), (size_type)header);
+                read_pos_ += _pad((size_type)header);
+                return read_result::record;
+            }
+        }
+
+        bool _try_end_episode() {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (read_segment_ != write_segment_ || read_pos_ != write_segment_->written_) {
+                return false; // A producer appended meanwhile.
+            }
+            // Drained: the next episode writes the same file from the start again.
+            write_segment_->written_ = 0;
+            write_segment_->committed_.store(0, std::memory_order_relaxed);
+            read_pos_ = 0;
+            episode_.store(episode_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            return true;
+        }
+
+        segment_t* _create_segment(size_type capacity) {
+            long page = ::sysconf(_SC_PAGESIZE);
+            capacity = (capacity + page - 1) / page * page;
+            auto segment = std::make_unique<segment_t>();
+            segment->path_ = options_.directory + "/daking_spill_" + std::to_string(::getpid()) + "_" +
+                std::to_string(instance_) + "_" + std::to_string(segment_count_++) + ".seg";
+            segment->fd_ = ::open(segment->path_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            if (segment->fd_ < 0) {
+                throw std::system_error(errno, std::generic_category(), "open " + segment->path_);
+            }
+            if (::ftruncate(segment->fd_, (off_t)capacity) != 0) {
+                int error = errno;
+                _destroy_segment(segment.release());
+                throw std::system_error(error, std::generic_category(), "ftruncate");
+            }
+            void* data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd_, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+                _destroy_segment(segment.release());
+                throw std::system_error(error, std::generic_category(), "mmap");
+            }
+            segment->data_     = static_cast<unsigned char*>(data);
+            segment->capacity_ = capacity;
+            return segment.release();
+        }
+
+        static void _destroy_segment(segment_t* segment) noexcept {
+            if (segment->data_) {
+                ::munmap(segment->data_, segment->capacity_);
+            }
+            ::close(segment->fd_);
+            ::unlink(segment->path_.c_str());
+            delete segment;
+        }
+
+        queue_type                      queue_;
+        MPSC_spill_options              options_;
+        std::uint64_t                   instance_;
+
+        alignas(Align) std::atomic<std::uint64_t> episode_{ 0 }; /* Odd while spilling */
+
+        // Producer side, under mutex_.
+        alignas(Align) std::mutex       mutex_;
+        typename queue_type::prepared_slot marker_;
+        segment_t*                      write_segment_ = nullptr;
+        std::uint64_t                   segment_count_ = 0;
+        std::atomic<size_type>          spilled_count_{ 0 };
+
+        // Consumer side.
+        alignas(Align) segment_t*       read_segment_ = nullptr;
+        size_type                       read_pos_     = 0;
+        bool                            reading_file_ = false;
+        std::optional<Ty>               entry_;
+
+        inline static std::atomic<std::uint64_t> next_instance_{ 0 };
+    };
+}
+
+#endif // !DAKING_SPILL_QUEUE_HPP
@@ -5,6 +5,8 @@
 #include <numeric>
 #include <algorithm>
 #include <future>
+#include <cstdio>
+#include <cstring>
 
 #include "daking/MPSC_queue.hpp"
 
@@ -57,6 +59,128 @@ TEST(MPSCQueueBasicTest, EmplaceMove) {
 	EXPECT_TRUE(queue.empty());
 }
 
+TEST(MPSCQueueBasicTest, PrepareCommitAndAbandon) {
+	using Q = MPSC_queue<std::string, 64>;
+	Q::set_global_node_budget(64);
+	Q queue;
+	std::string result;
+
+	auto slot = queue.prepare();
+	ASSERT_TRUE(slot);
+	new (slot.data()) std::string("built in place");
+	EXPECT_TRUE(queue.empty()); // Nothing is visible before commit.
+	slot.commit();
+	EXPECT_FALSE(slot);
+	EXPECT_TRUE(queue.try_dequeue(result));
+	EXPECT_EQ(result, "built in place");
+
+	// The dummy node and the close marker take two nodes of the budget, the rest can be prepared.
+	std::vector<Q::prepared_slot> slots;
+	while (auto extra = queue.try_prepare()) {
+		slots.push_back(std::move(extra));
+	}
+	EXPECT_EQ(slots.size(), (size_t)62);
+	// Abandoned slots give their nodes back.
+	slots.clear();
+	auto again = queue.try_prepare();
+	ASSERT_TRUE(again);
+	again.emplace("emplaced");
+	again.commit();
+	EXPECT_TRUE(queue.try_dequeue(result));
+	EXPECT_EQ(result, "emplaced");
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPSCQueueBasicTest, PrepareAfterCloseIsEmpty) {
+	StringQueue queue;
+	queue.close();
+
+	auto slot = queue.prepare();
+	EXPECT_FALSE(slot);
+	EXPECT_FALSE(slot.commit()); // No node and no queue, nothing to link.
+	auto limited = queue.try_prepare();
+	EXPECT_FALSE(limited);
+	EXPECT_FALSE(limited.commit());
+	limited.abandon();
+
+	auto batch = queue.prepare_n(4);
+	EXPECT_FALSE(batch);
+	EXPECT_TRUE(batch.begin() == batch.end());
+
+	std::string result;
+	EXPECT_FALSE(queue.try_dequeue(result));
+}
+
+TEST(MPSCQueueBasicTest, CloseRejectsProducersAndDrains) {
+	using daking::MPSC_dequeue_status;
+	StringQueue queue;
+	std::string result;
+
+	EXPECT_TRUE(queue.enqueue("before"));
+	std::vector<std::string> pair{ "a", "b" };
+	EXPECT_TRUE(queue.enqueue_bulk(pair.begin(), pair.end()));
+	auto slot = queue.prepare();
+	slot.emplace("prepared before close");
+
+	queue.close();
+	queue.close(); // Idempotent.
+	EXPECT_TRUE(queue.is_closed());
+	EXPECT_FALSE(queue.empty());
+
+	std::string kept = "not moved";
+	EXPECT_FALSE(queue.enqueue(std::move(kept)));
+	EXPECT_EQ(kept, "not moved"); // Rejected before anything is constructed.
+	EXPECT_FALSE(queue.try_emplace("late"));
+	EXPECT_FALSE(queue.enqueue_bulk(std::string("late"), 3));
+	EXPECT_FALSE(queue.prepare());
+	EXPECT_FALSE(slot.commit()); // Its value is destroyed, its node goes back to the pool.
+
+	EXPECT_EQ(queue.try_dequeue_status(result), MPSC_dequeue_status::dequeued);
+	EXPECT_EQ(result, "before");
+	EXPECT_TRUE(queue.try_dequeue(result));
+	EXPECT_TRUE(queue.try_dequeue(result));
+	EXPECT_EQ(result, "b");
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(queue.try_dequeue_status(result), MPSC_dequeue_status::closed);
+	EXPECT_EQ(queue.try_dequeue_status(result), MPSC_dequeue_status::closed);
+	EXPECT_FALSE(queue.try_dequeue(result));
+
+	TestQueue open_queue;
+	int value;
+	EXPECT_EQ(open_queue.try_dequeue_status(value), MPSC_dequeue_status::empty);
+}
+
+TEST(MPSCQueueBasicTest, TokensMixWithPlainCalls) {
+	struct Tick { int id; double price; };
+	using TickQueue = MPSC_queue<Tick, 64>;
+	TickQueue queue;
+	TickQueue::producer_token producer(queue);
+	TickQueue::consumer_token consumer(queue);
+
+	for (int i = 0; i < 100; ++i) {
+		if (i % 3 == 0) queue.enqueue(Tick{ i, 1.0 });
+		else EXPECT_TRUE(queue.enqueue(producer, Tick{ i, 1.0 }));
+	}
+	Tick batch[200];
+	for (int i = 0; i < 200; ++i) batch[i] = Tick{ 100 + i, 2.0 };
+	EXPECT_TRUE(queue.enqueue_bulk(producer, batch, 200)); // Crosses several chunks.
+	EXPECT_TRUE(queue.emplace(producer, Tick{ 300, 3.0 }));
+
+	Tick tick;
+	for (int i = 0; i < 150; ++i) {
+		ASSERT_TRUE(i % 2 ? queue.try_dequeue(consumer, tick) : queue.try_dequeue(tick));
+		EXPECT_EQ(tick.id, i);
+	}
+	Tick rest[200];
+	EXPECT_EQ(queue.try_dequeue_bulk(consumer, rest, 200), (size_t)151);
+	EXPECT_EQ(rest[150].id, 300);
+	EXPECT_EQ(queue.try_dequeue_status(consumer, tick), daking::MPSC_dequeue_status::empty);
+
+	queue.close();
+	EXPECT_FALSE(queue.enqueue(producer, tick));
+	EXPECT_EQ(queue.try_dequeue_status(consumer, tick), daking::MPSC_dequeue_status::closed);
+}
+
 // -------------------------------------------------------------------------
 // II. Memory and Resource Management Tests
 // -------------------------------------------------------------------------
@@ -84,6 +208,67 @@ TEST(MPSCQueueMemoryTest, GlobalResourceSharingAndDestruction) {
 	EXPECT_EQ(after_delete_size, (size_t)0);
 }
 
+TEST(MPSCQueueMemoryTest, RetentionKeepAllStaysWarm) {
+	using Q = MPSC_queue<long long, 64>;
+	Q::set_global_retention_policy(daking::MPSC_retention_policy::keep_all());
+	{
+		Q q;
+		for (long long i = 0; i < 1000; ++i) q.enqueue(i);
+		long long value;
+		while (q.try_dequeue(value)) {}
+	}
+	auto warm = Q::global_pool_stats();
+	EXPECT_GE(warm.node_count_, (size_t)1000);
+	{
+		// A short-lived queue reuses the pages, nothing is allocated again.
+		Q q;
+		for (long long i = 0; i < 1000; ++i) q.enqueue(i);
+		EXPECT_FALSE(Q::release_global_pool()); // An instance is alive.
+	}
+	EXPECT_EQ(Q::global_pool_stats().page_count_, warm.page_count_);
+	EXPECT_EQ(Q::global_pool_stats().node_count_, warm.node_count_);
+	EXPECT_FALSE(Q::trim_global_pool());
+
+	EXPECT_TRUE(Q::release_global_pool());
+	EXPECT_EQ(Q::global_node_size_apprx(), (size_t)0);
+	EXPECT_FALSE(Q::release_global_pool());
+}
+
+TEST(MPSCQueueMemoryTest, RetentionKeepUpTo) {
+	using Q = MPSC_queue<unsigned long long, 64>;
+	Q::set_global_retention_policy(daking::MPSC_retention_policy::keep_up_to(4 * 64));
+	{
+		Q q;
+		for (unsigned long long i = 0; i < 5000; ++i) q.enqueue(i);
+	}
+	size_t kept = Q::global_node_size_apprx();
+	EXPECT_GT(kept, (size_t)0);
+	EXPECT_LE(kept, (size_t)4 * 64);
+	EXPECT_EQ(Q::global_pool_stats().free_node_count_, kept); // The kept pages are chunked again.
+
+	Q q;
+	for (unsigned long long i = 0; i < 5000; ++i) q.enqueue(i);
+	unsigned long long value;
+	for (unsigned long long i = 0; i < 5000; ++i) {
+		ASSERT_TRUE(q.try_dequeue(value));
+		ASSERT_EQ(value, i);
+	}
+}
+
+TEST(MPSCQueueMemoryTest, RetentionReleaseAfterIdle) {
+	using Q = MPSC_queue<float, 64>;
+	Q::set_global_retention_policy(daking::MPSC_retention_policy::release_after_idle(std::chrono::milliseconds(20)));
+	{
+		Q q;
+		q.enqueue(1.0f);
+	}
+	EXPECT_GT(Q::global_node_size_apprx(), (size_t)0);
+	EXPECT_FALSE(Q::trim_global_pool()); // Not idle for long enough.
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	EXPECT_TRUE(Q::trim_global_pool());
+	EXPECT_EQ(Q::global_node_size_apprx(), (size_t)0);
+}
+
 TEST(MPSCQueueMemoryTest, ReserveGlobalChunk) {
 	using Q = MPSC_queue<long, 64>;
 	size_t initial_size = Q::global_node_size_apprx(); // Initial value is 0
@@ -97,6 +282,361 @@ TEST(MPSCQueueMemoryTest, ReserveGlobalChunk) {
 	EXPECT_EQ(Q::global_node_size_apprx(), reserved_size);
 }
 
+TEST(MPSCQueueMemoryTest, LinearGrowthPolicy) {
+	using Q = MPSC_queue<short, 64>;
+	Q::set_global_growth_policy(daking::MPSC_growth_policy::linear(2));
+	Q q;
+	EXPECT_EQ(Q::global_node_size_apprx(), (size_t)2 * 64);
+
+	// Drain the thread-local chunk and the second chunk, then force one more page.
+	for (int i = 0; i < 2 * 64; ++i) {
+		q.enqueue((short)i);
+	}
+	EXPECT_EQ(Q::global_node_size_apprx(), (size_t)4 * 64);
+}
+
+TEST(MPSCQueueMemoryTest, GrowthPolicyRoundsToChunks) {
+	EXPECT_EQ(daking::MPSC_growth_policy::doubling().next(0, 64), (size_t)64);
+	EXPECT_EQ(daking::MPSC_growth_policy::doubling().next(512, 64), (size_t)512);
+	EXPECT_EQ(daking::MPSC_growth_policy::linear(3).next(512, 64), (size_t)192);
+	EXPECT_EQ(daking::MPSC_growth_policy::capped(4).next(64, 64), (size_t)64);
+	EXPECT_EQ(daking::MPSC_growth_policy::capped(4).next(1024, 64), (size_t)256);
+	auto odd = daking::MPSC_growth_policy::custom([](std::size_t, std::size_t) -> std::size_t { return 100; });
+	EXPECT_EQ(odd.next(0, 64), (size_t)128);
+}
+
+TEST(MPSCQueueMemoryTest, NodeBudgetTryEnqueue) {
+	using Q = MPSC_queue<unsigned short, 64>;
+	Q::set_global_node_budget(2 * 64);
+	Q q;
+
+	size_t accepted = 0;
+	while (q.try_enqueue((unsigned short)accepted)) {
+		++accepted;
+	}
+	// The dummy node and the close marker of q take two nodes of the budget.
+	EXPECT_EQ(accepted, (size_t)2 * 64 - 2);
+	EXPECT_EQ(Q::global_node_size_apprx(), (size_t)2 * 64);
+	EXPECT_FALSE(q.try_enqueue_bulk((unsigned short)0, 1));
+
+	unsigned short result;
+	EXPECT_TRUE(q.try_dequeue(result));
+	EXPECT_EQ(result, 0);
+	// The consumed node is back in this thread's pool.
+	EXPECT_TRUE(q.try_enqueue((unsigned short)1));
+
+	// Bulk is all or nothing.
+	EXPECT_TRUE(q.try_dequeue(result));
+	EXPECT_TRUE(q.try_dequeue(result));
+	EXPECT_FALSE(q.try_enqueue_bulk((unsigned short)7, 3));
+	EXPECT_TRUE(q.try_enqueue_bulk((unsigned short)7, 2));
+}
+
+TEST(MPSCQueueMemoryTest, NodeBudgetOverflowHandler) {
+	using Q = MPSC_queue<char, 64>;
+	static std::atomic<int> handler_calls{ 0 };
+	Q::set_global_node_budget(64, [](std::size_t global_node_count) {
+		EXPECT_EQ(global_node_count, (size_t)64);
+		handler_calls++;
+		return false;
+	});
+	Q q;
+	for (int i = 0; i < 62; ++i) {
+		q.enqueue('x');
+	}
+	EXPECT_THROW(q.enqueue('y'), std::bad_alloc);
+	EXPECT_EQ(handler_calls.load(), 1);
+	EXPECT_FALSE(Q::reserve_global_chunk(4));
+}
+
+TEST(MPSCQueueMemoryTest, CloseWithBudgetUsedUp) {
+	// The marker was taken at construction: close() needs no node even when the handler refuses to grow.
+	using Q = MPSC_queue<char32_t, 64>;
+	Q::set_global_node_budget(64, [](std::size_t) { return false; });
+	Q q;
+	char32_t accepted = 0;
+	while (q.try_enqueue(accepted)) {
+		++accepted;
+	}
+	EXPECT_EQ(accepted, (char32_t)62);
+	static_assert(noexcept(q.close()));
+	q.close();
+
+	char32_t result;
+	for (char32_t i = 0; i < accepted; ++i) {
+		ASSERT_TRUE(q.dequeue(result));
+		EXPECT_EQ(result, i);
+	}
+	EXPECT_FALSE(q.dequeue(result));
+	EXPECT_EQ(q.try_dequeue_status(result), daking::MPSC_dequeue_status::closed);
+}
+
+TEST(MPSCQueueMemoryTest, NodeBudgetBlocksUntilConsumed) {
+	using Q = MPSC_queue<signed char, 64>;
+	Q::set_global_node_budget(2 * 64);
+	Q q;
+	const int n = 10000;
+	std::thread producer([&] {
+		for (int i = 0; i < n; ++i) {
+			q.enqueue((signed char)(i & 0x7f));
+		}
+		});
+	signed char result;
+	int popped = 0;
+	while (popped < n) {
+		if (q.try_dequeue(result)) {
+			EXPECT_EQ(result, (signed char)(popped & 0x7f));
+			++popped;
+		}
+	}
+	producer.join();
+	EXPECT_EQ(Q::global_node_size_apprx(), (size_t)2 * 64);
+}
+
+TEST(MPSCQueueMemoryTest, NodeBudgetRaiseWakesProducer) {
+	// Nothing is consumed: only the raised budget can wake the blocked producer.
+	using Q = MPSC_queue<char16_t, 64>;
+	Q::set_global_node_budget(64);
+	Q q;
+	for (char16_t i = 0; i < 62; ++i) {
+		ASSERT_TRUE(q.try_enqueue(i));
+	}
+	std::atomic<bool> enqueued{ false };
+	std::thread producer([&] {
+		q.enqueue((char16_t)62);
+		enqueued.store(true);
+		});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_FALSE(enqueued.load());
+	Q::set_global_node_budget(2 * 64);
+	producer.join();
+	EXPECT_TRUE(enqueued.load());
+
+	char16_t result;
+	for (char16_t i = 0; i < 63; ++i) {
+		ASSERT_TRUE(q.try_dequeue(result));
+		EXPECT_EQ(result, i);
+	}
+}
+
+TEST(MPSCQueueMemoryTest, PrepareThreadFillsThreadLocalPool) {
+	using Q = MPSC_queue<unsigned char, 64>;
+	EXPECT_FALSE(Q::prepare_thread(1)); // No instance alive
+
+	Q::set_global_node_budget(4 * 64);
+	Q q;
+	EXPECT_TRUE(Q::reserve_global_chunk(4, true));
+
+	std::thread producer([&] {
+		EXPECT_TRUE(Q::prepare_thread(3));
+		EXPECT_TRUE(Q::prepare_thread(3)); // Already prepared, no-op
+		// The main thread holds the last chunk, so everything below comes from the prepared chunks.
+		for (int i = 0; i < 3 * 64; ++i) {
+			EXPECT_TRUE(q.try_enqueue((unsigned char)i));
+		}
+		EXPECT_FALSE(q.try_enqueue((unsigned char)0));
+		EXPECT_FALSE(Q::prepare_thread(1));
+		});
+	producer.join();
+
+	unsigned char result;
+	for (int i = 0; i < 3 * 64; ++i) {
+		EXPECT_TRUE(q.try_dequeue(result));
+		EXPECT_EQ(result, (unsigned char)i);
+	}
+	EXPECT_TRUE(q.empty());
+}
+
+TEST(MPSCQueueMemoryTest, SharedPoolAcrossPayloadTypes) {
+	struct OrderEvent { int64_t id; double price; char symbol[40]; };
+	struct FillEvent  { int64_t id; int64_t qty; double price; std::string venue; };
+	using OrderQueue = MPSC_queue<OrderEvent, 32, 64, std::allocator<OrderEvent>, daking::MPSC_shared_pool>;
+	using FillQueue  = MPSC_queue<FillEvent,  32, 64, std::allocator<FillEvent>,  daking::MPSC_shared_pool>;
+	static_assert(sizeof(OrderEvent) == sizeof(FillEvent), "Same size class expected");
+	static_assert(OrderQueue::shares_pool && !TestQueue::shares_pool);
+
+	OrderQueue orders;
+	EXPECT_EQ(OrderQueue::global_node_size_apprx(), (size_t)32);
+	{
+		FillQueue fills;
+		// One pool: the FillQueue sees the OrderQueue's nodes and takes its dummy and marker from the same chunk.
+		EXPECT_EQ(FillQueue::global_node_size_apprx(), (size_t)32);
+		for (int i = 0; i < 14; ++i) {
+			orders.enqueue(OrderEvent{ i, 1.5, "AAPL" });
+			fills.enqueue(FillEvent{ i, 100, 1.5, std::string(40, 'v') });
+		}
+		EXPECT_EQ(OrderQueue::global_node_size_apprx(), (size_t)32);
+
+		FillEvent fill;
+		for (int i = 0; i < 14; ++i) {
+			EXPECT_TRUE(fills.try_dequeue(fill));
+			EXPECT_EQ(fill.id, i);
+			EXPECT_EQ(fill.venue, std::string(40, 'v'));
+		}
+		fills.enqueue(FillEvent{ 99, 1, 1.0, "x" }); // Destroyed with the queue
+	}
+	// The pool outlives the FillQueue as long as the OrderQueue is alive.
+	EXPECT_EQ(OrderQueue::global_node_size_apprx(), (size_t)32);
+	OrderEvent order;
+	for (int i = 0; i < 14; ++i) {
+		EXPECT_TRUE(orders.try_dequeue(order));
+		EXPECT_EQ(order.id, i);
+		EXPECT_STREQ(order.symbol, "AAPL");
+	}
+	EXPECT_TRUE(orders.empty());
+}
+
+TEST(MPSCQueueMemoryTest, ReturnToSenderRefillsProducer) {
+	using Q = MPSC_queue<short, 32, 64, std::allocator<short>, daking::MPSC_return_to_sender>;
+	static_assert(Q::returns_to_sender && !TestQueue::returns_to_sender);
+
+	Q q;
+	std::atomic<int> phase{ 0 };
+	auto wait_for = [&](int expected) {
+		while (phase.load(std::memory_order_acquire) != expected) std::this_thread::yield();
+	};
+	std::thread producer([&] {
+		for (short i = 0; i < 65; ++i) q.enqueue(i);
+		phase.store(1, std::memory_order_release);
+		wait_for(2);
+		for (short i = 65; i < 65 + 64; ++i) q.enqueue(i);
+		phase.store(3, std::memory_order_release);
+		wait_for(4);
+		});
+
+	wait_for(1);
+	auto before = Q::global_pool_stats();
+	short result;
+	for (short i = 0; i < 65; ++i) {
+		ASSERT_TRUE(q.try_dequeue(result));
+		EXPECT_EQ(result, i);
+	}
+	// The old dummy node goes back to our own chunk, which still lacks the close marker's node.
+	// The 64 freed producer nodes are two chunks handed back to the producer, not pushed to the global stack.
+	auto consumed = Q::global_pool_stats();
+	EXPECT_EQ(consumed.free_node_count_, before.free_node_count_);
+	phase.store(2, std::memory_order_release);
+
+	wait_for(3);
+	// The producer refilled from the returned chunks: the global pool neither shrank nor grew.
+	auto refilled = Q::global_pool_stats();
+	EXPECT_EQ(refilled.free_node_count_, consumed.free_node_count_);
+	EXPECT_EQ(refilled.node_count_, consumed.node_count_);
+	for (short i = 65; i < 65 + 64; ++i) {
+		ASSERT_TRUE(q.try_dequeue(result));
+		EXPECT_EQ(result, i);
+	}
+	phase.store(4, std::memory_order_release);
+	producer.join();
+	EXPECT_TRUE(q.empty());
+}
+
+TEST(MPSCQueueMemoryTest, GlobalPoolStats) {
+	using Q = MPSC_queue<unsigned long, 64>;
+	EXPECT_EQ(Q::global_pool_stats().node_count_, (size_t)0);
+
+	Q q;
+	Q::reserve_global_chunk(4);
+	auto stats = Q::global_pool_stats();
+	EXPECT_EQ(stats.node_count_, (size_t)4 * 64);
+	EXPECT_EQ(stats.page_count_, (size_t)2);
+	EXPECT_EQ(stats.free_node_count_, (size_t)3 * 64); // The main thread holds one chunk
+	EXPECT_EQ(stats.parked_node_count_, (size_t)0);
+	EXPECT_EQ(stats.in_use_node_count(), (size_t)64);
+
+	std::thread producer([&] {
+		for (unsigned long i = 0; i < 10; ++i) {
+			q.enqueue(i);
+		}
+		});
+	producer.join();
+	// The exited producer parked the rest of its chunk.
+	stats = Q::global_pool_stats();
+	EXPECT_EQ(stats.free_node_count_, (size_t)2 * 64);
+	EXPECT_EQ(stats.parked_node_count_, (size_t)64 - 10);
+	EXPECT_GE(stats.byte_count_, stats.node_count_ * (sizeof(unsigned long) + sizeof(void*)));
+}
+
+TEST(MPSCQueueMemoryTest, ThreadChurnReusesSlots) {
+	using Q = MPSC_queue<unsigned int, 64>;
+	Q q;
+	unsigned int result;
+
+	// Sequential churn: every thread takes over the slot (and the parked nodes) of the previous one.
+	for (unsigned int i = 0; i < 200; ++i) {
+		std::thread([&] { q.enqueue(i); }).join();
+		EXPECT_TRUE(q.try_dequeue(result));
+		EXPECT_EQ(result, i);
+	}
+	EXPECT_LE(Q::global_node_size_apprx(), (size_t)4 * 64);
+
+	// Concurrent churn: more threads than one slot block holds.
+	std::vector<std::thread> producers;
+	for (int t = 0; t < 100; ++t) {
+		producers.emplace_back([&] {
+			for (unsigned int i = 0; i < 10; ++i) {
+				q.enqueue(i);
+			}
+			});
+	}
+	for (auto& p : producers) p.join();
+	size_t popped = 0;
+	while (q.try_dequeue(result)) {
+		++popped;
+	}
+	EXPECT_EQ(popped, (size_t)1000);
+	EXPECT_EQ(Q::global_pool_stats().thread_count_, (size_t)1); // only the main thread is still registered
+}
+
+TEST(MPSCQueueMemoryTest, PolicyStatsAndSize) {
+	using Counted = daking::MPSC_policies<daking::MPSC_collect_stats, daking::MPSC_policies<daking::MPSC_track_size>>;
+	using Q = MPSC_queue<short, 64, 64, std::allocator<short>, Counted>;
+	using Defaults = daking::MPSC_policies<daking::MPSC_own_pool, daking::MPSC_recycle_local, daking::MPSC_wait_notify,
+		daking::MPSC_no_stats, daking::MPSC_no_size, daking::MPSC_compact_nodes>;
+	static_assert(Q::collects_stats && Q::tracks_size && !Q::polls && !Q::pads_nodes);
+	static_assert(sizeof(MPSC_queue<short, 64, 64, std::allocator<short>, Defaults>) == sizeof(MPSC_queue<short, 64>),
+		"Disabled policies add no member");
+
+	Q queue;
+	EXPECT_EQ(queue.size_apprx(), (size_t)0);
+	for (short i = 0; i < 10; ++i) queue.enqueue(i);
+	short batch[5] = { 1, 2, 3, 4, 5 };
+	queue.enqueue_bulk(batch, 5);
+	auto slot = queue.prepare();
+	slot.emplace(short(7));
+	EXPECT_EQ(queue.size_apprx(), (size_t)15); // A slot counts once committed.
+	slot.commit();
+	EXPECT_EQ(queue.size_apprx(), (size_t)16);
+
+	short value;
+	for (int i = 0; i < 12; ++i) EXPECT_TRUE(queue.try_dequeue(value));
+	EXPECT_EQ(queue.size_apprx(), (size_t)4);
+	while (queue.try_dequeue(value)) {}
+	queue.close(); // The marker is not an element.
+
+	auto stats = queue.stats();
+	EXPECT_EQ(stats.enqueued_count_, (size_t)16);
+	EXPECT_EQ(stats.dequeued_count_, (size_t)16);
+	EXPECT_EQ(stats.empty_dequeue_count_, (size_t)1);
+	EXPECT_EQ(queue.size_apprx(), (size_t)0);
+}
+
+TEST(MPSCQueueMemoryTest, PolicyPaddedNodes) {
+	using Q = MPSC_queue<char, 64, 64, std::allocator<char>, daking::MPSC_padded_nodes>;
+	Q queue;
+	for (int i = 0; i < 4; ++i) {
+		auto slot = queue.prepare();
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(slot.data()) % 64, (std::uintptr_t)0); // One node per cache line.
+		slot.emplace(char('a' + i));
+		slot.commit();
+	}
+	char value;
+	for (int i = 0; i < 4; ++i) {
+		EXPECT_TRUE(queue.try_dequeue(value));
+		EXPECT_EQ(value, 'a' + i);
+	}
+}
+
 // -------------------------------------------------------------------------
 // III. Bulk Operation Tests
 // -------------------------------------------------------------------------
@@ -165,6 +705,31 @@ TEST(MPSCQueueBulkTest, TryDequeueBulk_Partial) {
 	EXPECT_TRUE(queue.empty());
 }
 
+TEST(MPSCQueueBulkTest, PrepareN_CommitAll) {
+	TestQueue queue;
+	auto batch = queue.prepare_n(10);
+	ASSERT_EQ(batch.size(), (size_t)10);
+	int value = 0;
+	for (void* storage : batch) {
+		new (storage) int(value++);
+	}
+	EXPECT_TRUE(queue.empty());
+	batch.commit_all();
+	EXPECT_FALSE(batch);
+
+	{
+		auto abandoned = queue.prepare_n(5); // Back to the pool, nothing is published.
+	}
+	EXPECT_FALSE(queue.prepare_n(0));
+
+	int result;
+	for (int i = 0; i < 10; ++i) {
+		EXPECT_TRUE(queue.try_dequeue(result));
+		EXPECT_EQ(result, i);
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
 // -------------------------------------------------------------------------
 // IV. Concurrency Safety Tests (MPSC Scenario)
 // -------------------------------------------------------------------------
@@ -215,6 +780,142 @@ TEST(MPSCQueueConcurrentTest, MultipleProducersSingleConsumer_Bulk) {
 	EXPECT_TRUE(queue.empty());
 }
 
+TEST(MPSCQueueConcurrentTest, MultipleProducersWithTokens) {
+	struct Sample { int producer; int seq; };
+	using SampleQueue = MPSC_queue<Sample, 64>;
+	SampleQueue queue;
+	const int num_producers = 4;
+	const int per_producer = 50000;
+
+	std::vector<std::thread> producers;
+	for (int p = 0; p < num_producers; ++p) {
+		producers.emplace_back([&, p] {
+			SampleQueue::producer_token token(queue); // Built on the thread that uses it.
+			for (int i = 0; i < per_producer; ++i) {
+				queue.enqueue(token, Sample{ p, i });
+			}
+			});
+	}
+
+	SampleQueue::consumer_token token(queue);
+	std::vector<int> next(num_producers, 0);
+	int total = 0;
+	Sample sample;
+	while (total < num_producers * per_producer) {
+		if (queue.try_dequeue(token, sample)) {
+			ASSERT_EQ(sample.seq, next[sample.producer]);
+			++next[sample.producer];
+			++total;
+		}
+	}
+	for (auto& t : producers) t.join();
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPSCQueueConcurrentTest, ConsumerLeaseHandoff) {
+	TestQueue queue;
+	const int total = 20000;
+	for (int i = 0; i < total; ++i) {
+		queue.enqueue(i);
+	}
+
+	std::vector<int> seen;
+	seen.reserve(total);
+	auto consume_half = [&] {
+		auto lease = queue.try_acquire_consumer();
+		ASSERT_TRUE(lease);
+		EXPECT_FALSE(queue.try_acquire_consumer()); // Held, so no exclusive lease.
+		int value;
+		for (int i = 0; i < total / 2; ++i) {
+			ASSERT_TRUE(lease.try_dequeue(value));
+			seen.push_back(value);
+		}
+	};
+	// The role moves to another thread, the lease release/acquire orders tail_ between them.
+	std::thread(consume_half).join();
+	std::thread(consume_half).join();
+
+	ASSERT_EQ(seen.size(), (size_t)total);
+	for (int i = 0; i < total; ++i) {
+		EXPECT_EQ(seen[i], i);
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPSCQueueConcurrentTest, MultipleConsumerLeasesSplitBacklog) {
+	TestQueue queue;
+	const int num_producers = 4;
+	const int num_consumers = 3;
+	const int per_producer = 50000;
+	const int total = num_producers * per_producer;
+
+	std::vector<std::atomic<int>> hits(total);
+	std::atomic<int> consumed{ 0 };
+	std::atomic<bool> done{ false };
+
+	std::vector<std::thread> consumers;
+	for (int c = 0; c < num_consumers; ++c) {
+		consumers.emplace_back([&] {
+			auto lease = queue.acquire_consumer();
+			std::vector<int> batch(32);
+			while (!done.load(std::memory_order_acquire)) {
+				size_t n = lease.try_dequeue_bulk(batch.begin(), batch.size());
+				for (size_t i = 0; i < n; ++i) {
+					hits[batch[i]].fetch_add(1, std::memory_order_relaxed);
+				}
+				if (consumed.fetch_add((int)n, std::memory_order_acq_rel) + (int)n == total) {
+					done.store(true, std::memory_order_release);
+				}
+				if (n == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	std::vector<std::thread> producers;
+	for (int p = 0; p < num_producers; ++p) {
+		producers.emplace_back([&, p] {
+			for (int i = 0; i < per_producer; ++i) {
+				queue.enqueue(p * per_producer + i);
+			}
+		});
+	}
+	for (auto& t : producers) t.join();
+	for (auto& t : consumers) t.join();
+
+	EXPECT_EQ(consumed.load(), total);
+	for (int i = 0; i < total; ++i) {
+		ASSERT_EQ(hits[i].load(), 1) << "value " << i;
+	}
+	EXPECT_TRUE(queue.empty());
+	EXPECT_TRUE(queue.try_acquire_consumer()); // Every lease was released.
+}
+
+TEST(MPSCQueueConcurrentTest, ReturnToSenderWithInterleavedProducers) {
+	// Batches keep breaking off when producers interleave, the nodes then take the default path.
+	using Q = MPSC_queue<std::pair<int, int>, 32, 64, std::allocator<std::pair<int, int>>, daking::MPSC_return_to_sender>;
+	const int num_producers = 3;
+	const int per_producer = 20000;
+	Q q;
+	std::vector<std::thread> producers;
+	for (int p = 0; p < num_producers; ++p) {
+		producers.emplace_back([&q, p] {
+			for (int i = 0; i < per_producer; ++i) q.emplace(p, i);
+			});
+	}
+	std::vector<int> next(num_producers, 0);
+	std::pair<int, int> item;
+	for (int got = 0; got < num_producers * per_producer;) {
+		if (q.try_dequeue(item)) {
+			EXPECT_EQ(item.second, next[item.first]++);
+			++got;
+		}
+	}
+	for (auto& t : producers) t.join();
+	EXPECT_TRUE(q.empty());
+}
+
 // -------------------------------------------------------------------------
 // IV. Custom Allocator Tests
 // -------------------------------------------------------------------------
@@ -266,13 +967,11 @@ TEST(MPSCQueueAllocatorTest, CustomAllocatorUsage) {
 }
 
 // -------------------------------------------------------------------------
-// VI. C++20 Blocking Operation Tests
+// VI. Blocking Operation Tests
 // -------------------------------------------------------------------------
 
-#if DAKING_HAS_CXX20_OR_ABOVE
 TEST(MPSCQueueBlockTest, Dequeue_BlockAndWait) {
 	TestQueue queue;
-	int result = 0;
 	std::atomic_bool pushed{ false };
 
 	// Consumer thread: block and wait
@@ -321,4 +1020,262 @@ TEST(MPSCQueueBlockTest, DequeueBulk_BlockAndWait) {
 	EXPECT_EQ(results[2], 3);
 	EXPECT_TRUE(queue.empty());
 }
-#endif
+
+TEST(MPSCQueueBlockTest, AcceptedEnqueuesRacingCloseAreDelivered) {
+	// An enqueue that returns true is delivered, one that returns false may or may not be.
+	const int num_producers = 4;
+	for (int round = 0; round < 20; ++round) {
+		TestQueue queue;
+		std::atomic<bool> start{ false };
+		std::vector<std::vector<int>> accepted(num_producers);
+		std::vector<std::thread> producers;
+		for (int p = 0; p < num_producers; ++p) {
+			producers.emplace_back([&, p] {
+				while (!start.load(std::memory_order_acquire));
+				for (int i = 0; ; ++i) {
+					if (!queue.enqueue(p << 24 | i)) break;
+					accepted[p].push_back(i);
+				}
+				});
+		}
+		start.store(true, std::memory_order_release);
+		std::this_thread::sleep_for(std::chrono::microseconds(200 * (round % 5)));
+		queue.close();
+
+		std::vector<std::vector<int>> delivered(num_producers);
+		int value;
+		while (queue.dequeue(value)) {
+			delivered[value >> 24].push_back(value & 0xffffff);
+		}
+		for (auto& t : producers) t.join();
+		for (int p = 0; p < num_producers; ++p) {
+			ASSERT_GE(delivered[p].size(), accepted[p].size());
+			ASSERT_TRUE(std::equal(accepted[p].begin(), accepted[p].end(), delivered[p].begin()));
+		}
+	}
+}
+
+TEST(MPSCQueueBlockTest, CloseWakesBlockedConsumer) {
+	TestQueue queue;
+	const int num_producers = 4;
+	const int per_producer = 10000;
+
+	auto consumer_future = std::async(std::launch::async, [&] {
+		long long count = 0;
+		int val;
+		while (queue.dequeue(val)) {
+			++count;
+		}
+		return count;
+		});
+
+	std::vector<std::thread> producers;
+	for (int p = 0; p < num_producers; ++p) {
+		producers.emplace_back([&] {
+			for (int i = 0; i < per_producer; ++i) {
+				queue.enqueue(i);
+			}
+			});
+	}
+	for (auto& t : producers) t.join();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Let the consumer block on an empty queue.
+	queue.close();
+
+	EXPECT_EQ(consumer_future.get(), (long long)num_producers * per_producer);
+	std::vector<int> rest(2);
+	EXPECT_EQ(queue.dequeue_bulk(rest.begin(), rest.end()), (size_t)0);
+}
+
+TEST(MPSCQueueBlockTest, PingPongParksAndWakes) {
+	// Every round trip parks both consumers, a lost wake-up hangs here.
+	TestQueue ping, pong;
+	const int rounds = 20000;
+	std::thread echo([&] {
+		int value;
+		while (ping.dequeue(value)) {
+			pong.enqueue(value + 1);
+		}
+		pong.close();
+		});
+	int value = 0;
+	for (int i = 0; i < rounds; ++i) {
+		ping.enqueue(value);
+		ASSERT_TRUE(pong.dequeue(value));
+	}
+	ping.close();
+	echo.join();
+	EXPECT_EQ(value, rounds);
+	EXPECT_FALSE(pong.dequeue(value));
+}
+
+TEST(MPSCQueueBlockTest, PollWaitPolicyDequeue) {
+	// MPSC_wait_poll: producers never notify, the blocking consumer yields until something shows up.
+	using Q = MPSC_queue<unsigned short, 256, 64, std::allocator<unsigned short>, daking::MPSC_wait_poll>;
+	static_assert(Q::polls);
+	Q queue;
+	auto consumer_future = std::async(std::launch::async, [&] {
+		long long sum = 0;
+		unsigned short val;
+		while (queue.dequeue(val)) {
+			sum += val;
+		}
+		return sum;
+		});
+	for (unsigned short i = 0; i < 1000; ++i) {
+		queue.enqueue(i);
+		if (i % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	queue.close();
+	EXPECT_EQ(consumer_future.get(), 999LL * 1000 / 2);
+}
+
+// -------------------------------------------------------------------------
+// VII. Intrusive Queue Tests
+// -------------------------------------------------------------------------
+
+struct Command {
+	int id = 0;
+	daking::MPSC_intrusive_hook hook;
+};
+using CommandQueue = daking::MPSC_intrusive_queue<Command, &Command::hook>;
+
+TEST(MPSCIntrusiveQueueTest, EnqueueDequeueAndReuse) {
+	CommandQueue queue;
+	Command commands[3];
+	Command* result = nullptr;
+	EXPECT_TRUE(queue.empty());
+	EXPECT_FALSE(queue.try_dequeue(result));
+
+	for (int round = 0; round < 3; ++round) {
+		for (int i = 0; i < 3; ++i) {
+			commands[i].id = round * 10 + i;
+			queue.enqueue(&commands[i]);
+		}
+		EXPECT_FALSE(queue.empty());
+		for (int i = 0; i < 3; ++i) {
+			EXPECT_TRUE(queue.try_dequeue(result));
+			EXPECT_EQ(result, &commands[i]); // The same object, no copy
+			EXPECT_EQ(result->id, round * 10 + i);
+		}
+		EXPECT_FALSE(queue.try_dequeue(result));
+		EXPECT_TRUE(queue.empty());
+	}
+}
+
+TEST(MPSCIntrusiveQueueTest, BulkAndDrain) {
+	CommandQueue queue;
+	std::vector<Command> commands(100);
+	std::vector<Command*> pointers;
+	for (int i = 0; i < 100; ++i) {
+		commands[i].id = i;
+		pointers.push_back(&commands[i]);
+	}
+	queue.enqueue_bulk(pointers.begin(), pointers.end());
+	queue.enqueue_bulk(pointers.begin(), 0);
+
+	int expected = 0;
+	EXPECT_EQ(queue.drain([&](Command* command) { EXPECT_EQ(command->id, expected++); }, 40), (size_t)40);
+	EXPECT_EQ(queue.drain([&](Command* command) { EXPECT_EQ(command->id, expected++); }), (size_t)60);
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPSCIntrusiveQueueTest, MultipleProducers) {
+	CommandQueue queue;
+	const int num_producers = 4;
+	const int per_producer = 20000;
+	std::vector<Command> commands(num_producers * per_producer);
+	std::vector<std::thread> producers;
+	for (int p = 0; p < num_producers; ++p) {
+		producers.emplace_back([&, p] {
+			for (int i = 0; i < per_producer; ++i) {
+				Command& command = commands[p * per_producer + i];
+				command.id = i;
+				queue.enqueue(&command);
+			}
+			});
+	}
+
+	std::vector<int> next_id(num_producers, 0);
+	int popped = 0;
+	Command* result;
+	while (popped < num_producers * per_producer) {
+		if (queue.try_dequeue(result)) {
+			int producer = (int)((result - commands.data()) / per_producer);
+			EXPECT_EQ(result->id, next_id[producer]++); // FIFO per producer
+			++popped;
+		}
+	}
+	for (auto& t : producers) t.join();
+	EXPECT_TRUE(queue.empty());
+}
+
+// -------------------------------------------------------------------------
+// VIII. Record Queue Tests
+// -------------------------------------------------------------------------
+
+TEST(MPSCRecordQueueTest, VariableLengthRecords) {
+	using Q = daking::MPSC_record_queue<1024, 4>;
+	Q queue;
+	std::string result;
+	auto read = [&](daking::MPSC_record_view record) {
+		result.assign(reinterpret_cast<const char*>(record.data()), record.size());
+	};
+	EXPECT_TRUE(queue.empty());
+	EXPECT_FALSE(queue.try_dequeue(read));
+
+	// Short, empty, block-filling and oversized (allocated on their own) records.
+	std::vector<std::string> lines{ "a", "", std::string(300, 'x'), std::string(Q::max_block_record_size, 'y'),
+		std::string(5000, 'z'), "tail" };
+	for (int round = 0; round < 10; ++round) {
+		for (auto& line : lines) {
+			queue.enqueue(line.data(), line.size());
+		}
+		for (auto& line : lines) {
+			EXPECT_TRUE(queue.try_dequeue(read));
+			EXPECT_EQ(result, line);
+		}
+		EXPECT_TRUE(queue.empty());
+	}
+
+	auto record = queue.prepare(5);
+	std::memcpy(record.data(), "hello", 5);
+	{
+		auto abandoned = queue.prepare(100); // Never published.
+	}
+	record.commit();
+	EXPECT_EQ(queue.drain(read), (size_t)1);
+	EXPECT_EQ(result, "hello");
+}
+
+TEST(MPSCRecordQueueTest, MultipleProducersRecycleBlocks) {
+	using Q = daking::MPSC_record_queue<4096, 4>;
+	Q queue;
+	const int num_producers = 4;
+	const int per_producer = 20000;
+	std::vector<std::thread> producers;
+	for (int p = 0; p < num_producers; ++p) {
+		producers.emplace_back([&, p] {
+			char line[200];
+			for (int i = 0; i < per_producer; ++i) {
+				int size = std::snprintf(line, sizeof(line), "%d:%d:%0*d", p, i, i % 150, 0);
+				queue.enqueue(line, (size_t)size);
+			}
+			});
+	}
+
+	std::vector<int> next_id(num_producers, 0);
+	int popped = 0;
+	while (popped < num_producers * per_producer) {
+		popped += (int)queue.drain([&](daking::MPSC_record_view record) {
+			int producer, id;
+			std::string line(reinterpret_cast<const char*>(record.data()), record.size());
+			ASSERT_EQ(std::sscanf(line.c_str(), "%d:%d:", &producer, &id), 2);
+			EXPECT_EQ(id, next_id[producer]++); // FIFO per producer
+			});
+	}
+	for (auto& t : producers) t.join();
+	EXPECT_TRUE(queue.empty());
+
+	// 80000 records of up to 160 bytes went through a few blocks that were reused over and over.
+	EXPECT_LT(Q::global_pool_stats().node_count_, (size_t)4096);
+}
@@ -0,0 +1,218 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include "daking/actor.hpp"
+
+using daking::actor;
+using daking::actor_system;
+
+static void wait_for(const std::atomic<long>& counter, long expected) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+	while (counter.load(std::memory_order_acquire) < expected && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+struct Tagged {
+	int sender;
+	int seq;
+};
+
+struct OrderChecker : actor<Tagged> {
+	explicit OrderChecker(std::atomic<long>& handled) : handled(handled), last(8, -1) {}
+
+	void receive(Tagged& message) override {
+		if (running.exchange(true, std::memory_order_acq_rel)) {
+			overlapped = true;
+		}
+		if (message.seq != last[message.sender] + 1) {
+			out_of_order = true;
+		}
+		last[message.sender] = message.seq;
+		running.store(false, std::memory_order_release);
+		handled.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	std::atomic<long>& handled;
+	std::vector<int> last;
+	std::atomic<bool> running{ false };
+	bool overlapped = false;
+	bool out_of_order = false;
+};
+
+TEST(ActorTest, EachActorRunsOnOneWorkerAtATimeInSendOrder) {
+	const int num_actors = 1000;
+	const int num_senders = 4;
+	const int per_actor = 200;
+	std::atomic<long> handled{ 0 };
+	actor_system system(4, 16);
+	std::vector<OrderChecker*> actors;
+	for (int i = 0; i < num_actors; ++i) {
+		actors.push_back(system.spawn<OrderChecker>(handled));
+	}
+
+	std::vector<std::thread> senders;
+	for (int s = 0; s < num_senders; ++s) {
+		senders.emplace_back([&, s] {
+			for (int seq = 0; seq < per_actor; ++seq) {
+				for (auto* a : actors) {
+					a->send(Tagged{ s, seq });
+				}
+			}
+		});
+	}
+	for (auto& t : senders) t.join();
+
+	const long total = (long)num_actors * num_senders * per_actor;
+	wait_for(handled, total);
+	ASSERT_EQ(handled.load(), total);
+	for (auto* a : actors) {
+		EXPECT_FALSE(a->overlapped);
+		EXPECT_FALSE(a->out_of_order);
+		for (int s = 0; s < num_senders; ++s) {
+			EXPECT_EQ(a->last[s], per_actor - 1);
+		}
+	}
+}
+
+struct Hop : actor<long> {
+	Hop(std::atomic<long>& hops) : hops(hops) {}
+
+	void receive(long& remaining) override {
+		hops.fetch_add(1, std::memory_order_acq_rel);
+		if (remaining > 0) {
+			next->send(remaining - 1);
+		}
+	}
+
+	std::atomic<long>& hops;
+	Hop* next = nullptr;
+};
+
+TEST(ActorTest, ManySendersToOneActorKeepPendingConsistent) {
+	// A turn drains the mailbox up to the batch, so it races with sends whose message is linked but not yet counted.
+	const int num_senders = 8;
+	const int per_sender = 20000;
+	const long total = (long)num_senders * per_sender;
+
+	struct Checker : OrderChecker {
+		Checker(std::atomic<long>& handled, long total) : OrderChecker(handled), total(total) {}
+		void receive(Tagged& message) override {
+			std::size_t pending = pending_apprx();
+			if (pending == 0 || pending > (std::size_t)total) {
+				miscounted = true; // The message being received is counted, and the count never wraps.
+			}
+			OrderChecker::receive(message);
+		}
+		long total;
+		bool miscounted = false;
+	};
+
+	std::atomic<long> handled{ 0 };
+	actor_system system(2, 64);
+	Checker* checker = system.spawn<Checker>(handled, total);
+
+	std::atomic<bool> done{ false };
+	bool wrapped = false;
+	std::thread watcher([&] {
+		while (!done.load(std::memory_order_acquire)) {
+			if (checker->pending_apprx() > (std::size_t)total) {
+				wrapped = true; // A turn subtracted a message before its send counted it.
+			}
+		}
+	});
+	std::vector<std::thread> senders;
+	for (int s = 0; s < num_senders; ++s) {
+		senders.emplace_back([&, s] {
+			for (int seq = 0; seq < per_sender; ++seq) {
+				checker->send(Tagged{ s, seq });
+			}
+		});
+	}
+	for (auto& t : senders) t.join();
+
+	wait_for(handled, total);
+	done.store(true, std::memory_order_release);
+	watcher.join();
+	ASSERT_EQ(handled.load(), total);
+	EXPECT_FALSE(wrapped);
+	EXPECT_FALSE(checker->miscounted);
+	EXPECT_FALSE(checker->overlapped);
+	EXPECT_FALSE(checker->out_of_order);
+	for (int s = 0; s < num_senders; ++s) {
+		EXPECT_EQ(checker->last[s], per_sender - 1);
+	}
+	for (int i = 0; i < 1000 && checker->pending_apprx() != 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1)); // The last turn subtracts after its receive.
+	}
+	EXPECT_EQ(checker->pending_apprx(), (std::size_t)0);
+}
+
+TEST(ActorTest, ActorsSendToEachOther) {
+	const int num_actors = 500;
+	const long hops_per_token = 1000;
+	std::atomic<long> hops{ 0 };
+	actor_system system(4);
+	std::vector<Hop*> ring;
+	for (int i = 0; i < num_actors; ++i) {
+		ring.push_back(system.spawn<Hop>(hops));
+	}
+	for (int i = 0; i < num_actors; ++i) {
+		ring[i]->next = ring[(i + 1) % num_actors];
+	}
+	for (auto* a : ring) {
+		a->send(hops_per_token - 1);
+	}
+
+	wait_for(hops, num_actors * hops_per_token);
+	EXPECT_EQ(hops.load(), num_actors * hops_per_token);
+}
+
+TEST(ActorTest, TurnIsBoundedByBatch) {
+	// One worker, batch 16: a flooded actor must yield to another actor after 16 messages.
+	std::atomic<bool> gate{ false };
+	std::atomic<long> flooded_count{ 0 };
+	std::atomic<long> seen_by_other{ -1 };
+
+	struct Flooded : actor<int> {
+		Flooded(std::atomic<bool>& gate, std::atomic<long>& count) : gate(gate), count(count) {}
+		void receive(int&) override {
+			while (!gate.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			count.fetch_add(1, std::memory_order_acq_rel);
+		}
+		std::atomic<bool>& gate;
+		std::atomic<long>& count;
+	};
+	struct Other : actor<int> {
+		Other(std::atomic<long>& count, std::atomic<long>& seen) : count(count), seen(seen) {}
+		void receive(int&) override {
+			seen.store(count.load(std::memory_order_acquire), std::memory_order_release);
+		}
+		std::atomic<long>& count;
+		std::atomic<long>& seen;
+	};
+
+	actor_system system(1, 16);
+	auto* flooded = system.spawn<Flooded>(gate, flooded_count);
+	auto* other = system.spawn<Other>(flooded_count, seen_by_other);
+	for (int i = 0; i < 1000; ++i) {
+		flooded->send(i);
+	}
+	other->send(0);
+	gate.store(true, std::memory_order_release);
+
+	wait_for(flooded_count, 1000);
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+	while (seen_by_other.load() < 0 && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+	EXPECT_EQ(flooded_count.load(), 1000);
+	EXPECT_EQ(seen_by_other.load(), 16);
+}
@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+#include "daking/async_logger.hpp"
+
+using daking::async_logger;
+using daking::log_level;
+
+static std::vector<std::string> read_lines(const std::string& path) {
+	std::vector<std::string> lines;
+	std::ifstream file(path);
+	for (std::string line; std::getline(file, line);) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+TEST(AsyncLoggerTest, FormatsOnTheConsumerAndFlushes) {
+	const std::string path = ::testing::TempDir() + "daking_async_logger_format.log";
+	std::remove(path.c_str());
+	async_logger logger(path.c_str());
+
+	std::string owner = "alice";
+	logger.info("order %d filled at %.2f by %s", 42, 101.5, owner);
+	owner = "changed after the call"; // The argument was copied when logging.
+	logger.debug("filtered out");
+	logger.warn("%s|%s|%c", "literal", std::string_view("view"), 'x');
+	logger.error("no arguments, 100%% literal");
+	logger.flush();
+
+	auto lines = read_lines(path);
+	ASSERT_EQ(lines.size(), (size_t)3);
+	EXPECT_NE(lines[0].find("[INFO] order 42 filled at 101.50 by alice"), std::string::npos);
+	EXPECT_NE(lines[1].find("[WARN] literal|view|x"), std::string::npos);
+	EXPECT_NE(lines[2].find("[ERROR] no arguments, 100% literal"), std::string::npos);
+	EXPECT_EQ(lines[0][0], '[');
+
+	logger.set_level(log_level::trace);
+	logger.trace("%s", std::string(2000, 'y')); // Longer than the consumer's stack buffer.
+	logger.flush();
+	lines = read_lines(path);
+	ASSERT_EQ(lines.size(), (size_t)4);
+	EXPECT_NE(lines[3].find("[TRACE] " + std::string(2000, 'y')), std::string::npos);
+}
+
+TEST(AsyncLoggerTest, MultipleProducers) {
+	const std::string path = ::testing::TempDir() + "daking_async_logger_producers.log";
+	std::remove(path.c_str());
+	const int num_producers = 4;
+	const int per_producer = 20000;
+	{
+		async_logger logger(path.c_str());
+		std::vector<std::thread> producers;
+		for (int p = 0; p < num_producers; ++p) {
+			producers.emplace_back([&, p] {
+				for (int i = 0; i < per_producer; ++i) {
+					logger.info("producer %d message %d", p, i);
+				}
+				});
+		}
+		for (auto& t : producers) t.join();
+	} // The destructor writes everything that is left.
+
+	auto lines = read_lines(path);
+	ASSERT_EQ(lines.size(), (size_t)num_producers * per_producer);
+	std::vector<int> next_id(num_producers, 0);
+	for (auto& line : lines) {
+		int producer, id;
+		ASSERT_EQ(std::sscanf(line.c_str() + line.find("producer"), "producer %d message %d", &producer, &id), 2);
+		EXPECT_EQ(id, next_id[producer]++); // FIFO per producer
+	}
+}
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <chrono>
+
+#include "daking/executor.hpp"
+
+using daking::executor;
+
+static void wait_for(const std::atomic<int>& counter, int expected) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+	while (counter.load(std::memory_order_acquire) < expected && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+TEST(ExecutorTest, RunsEveryPostedTaskOnce) {
+	const int num_posters = 4;
+	const int per_poster = 20000;
+	std::vector<std::atomic<int>> hits(num_posters * per_poster);
+	std::atomic<int> done{ 0 };
+	{
+		executor pool(4);
+		std::vector<std::thread> posters;
+		for (int p = 0; p < num_posters; ++p) {
+			posters.emplace_back([&, p] {
+				for (int i = 0; i < per_poster; ++i) {
+					int id = p * per_poster + i;
+					pool.post([&hits, &done, id] {
+						hits[id].fetch_add(1, std::memory_order_relaxed);
+						done.fetch_add(1, std::memory_order_release);
+					});
+				}
+			});
+		}
+		for (auto& t : posters) t.join();
+		wait_for(done, num_posters * per_poster);
+	}
+	for (auto& h : hits) {
+		ASSERT_EQ(h.load(), 1);
+	}
+}
+
+struct ForkJoin {
+	executor& pool;
+	std::atomic<int>& leaves;
+
+	void operator()(int depth) const {
+		if (depth == 0) {
+			leaves.fetch_add(1, std::memory_order_release);
+			return;
+		}
+		// Posted from a worker: both halves go to its own inbox, idle workers steal them from there.
+		ForkJoin self = *this;
+		pool.post([self, depth] { self(depth - 1); });
+		pool.post([self, depth] { self(depth - 1); });
+	}
+};
+
+TEST(ExecutorTest, TasksPostTasks) {
+	std::atomic<int> leaves{ 0 };
+	executor pool(4);
+	ForkJoin root{ pool, leaves };
+	pool.post([root] { root(14); });
+	wait_for(leaves, 1 << 14);
+	EXPECT_EQ(leaves.load(), 1 << 14);
+}
+
+TEST(ExecutorTest, IdleWorkersStealFromABusyOne) {
+	const int num_tasks = 200;
+	std::atomic<int> done{ 0 };
+	std::mutex mutex;
+	std::set<std::thread::id> runners;
+	executor pool(4);
+	for (int i = 0; i < num_tasks; ++i) {
+		pool.post_to(0, [&] {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				runners.insert(std::this_thread::get_id());
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			done.fetch_add(1, std::memory_order_release);
+		});
+	}
+	wait_for(done, num_tasks);
+	EXPECT_EQ(done.load(), num_tasks);
+	std::lock_guard<std::mutex> lock(mutex);
+	EXPECT_GT(runners.size(), (size_t)1);
+}
+
+TEST(ExecutorTest, InlineTaskIsMoveOnly) {
+	std::atomic<int> done{ 0 };
+	executor pool(2);
+	auto owned = std::make_unique<int>(7);
+	pool.post([value = std::move(owned), &done] {
+		done.fetch_add(*value, std::memory_order_release);
+	});
+	wait_for(done, 7);
+	EXPECT_EQ(done.load(), 7);
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "daking/merge_consumer.hpp"
+
+struct Tick {
+	std::uint64_t ts = 0;
+	int feed = -1;
+};
+
+using FeedQueue = daking::MPSC_queue<Tick>;
+
+struct TickTime {
+	std::uint64_t operator()(const Tick& tick) const noexcept { return tick.ts; }
+};
+
+using Merger = daking::MPSC_merge_consumer<FeedQueue, TickTime>;
+
+TEST(MergeConsumerTest, StrictMergeIsInGlobalOrder) {
+	const int num_feeds = 4;
+	const int per_feed = 50000;
+	std::vector<FeedQueue> feeds(num_feeds);
+	std::vector<FeedQueue*> pointers;
+	for (auto& feed : feeds) pointers.push_back(&feed);
+	Merger merger(pointers);
+
+	std::vector<std::thread> producers;
+	for (int f = 0; f < num_feeds; ++f) {
+		producers.emplace_back([&, f] {
+			// Ordered within a feed only, the feeds interleave in time.
+			for (int i = 0; i < per_feed; ++i) {
+				feeds[f].enqueue(Tick{ (std::uint64_t)i * num_feeds + (std::uint64_t)((f * 7) % num_feeds), f });
+			}
+			feeds[f].close();
+		});
+	}
+
+	std::vector<Tick> out;
+	out.reserve(num_feeds * per_feed);
+	std::vector<Tick> batch(64);
+	while (!merger.drained()) {
+		size_t n = merger.try_dequeue_bulk(batch.begin(), batch.size());
+		out.insert(out.end(), batch.begin(), batch.begin() + n);
+	}
+	for (auto& t : producers) t.join();
+
+	ASSERT_EQ(out.size(), (size_t)num_feeds * per_feed);
+	for (size_t i = 1; i < out.size(); ++i) {
+		ASSERT_LE(out[i - 1].ts, out[i].ts) << "at " << i;
+	}
+	EXPECT_EQ(merger.late_count(), (size_t)0);
+}
+
+TEST(MergeConsumerTest, StrictMergeWaitsForASilentFeed) {
+	FeedQueue a, b;
+	Merger merger({ &a, &b });
+	Tick tick;
+
+	a.enqueue(Tick{ 10, 0 });
+	a.enqueue(Tick{ 20, 0 });
+	EXPECT_FALSE(merger.try_dequeue(tick)); // b could still bring something older.
+
+	b.enqueue(Tick{ 15, 1 });
+	ASSERT_TRUE(merger.try_dequeue(tick));
+	EXPECT_EQ(tick.ts, (std::uint64_t)10);
+	ASSERT_TRUE(merger.try_dequeue(tick));
+	EXPECT_EQ(tick.ts, (std::uint64_t)15);
+	EXPECT_FALSE(merger.try_dequeue(tick)); // b is silent again.
+
+	b.close();
+	ASSERT_TRUE(merger.try_dequeue(tick)); // A closed feed does not hold the others back.
+	EXPECT_EQ(tick.ts, (std::uint64_t)20);
+	EXPECT_FALSE(merger.drained());
+	a.close();
+	EXPECT_FALSE(merger.try_dequeue(tick));
+	EXPECT_TRUE(merger.drained());
+}
+
+TEST(MergeConsumerTest, StrictMergeClosedFeedWithStagedTicksStillWaits) {
+	FeedQueue a, b, c;
+	Merger merger({ &a, &b, &c });
+	Tick tick;
+
+	a.enqueue(Tick{ 10, 0 });
+	a.close(); // Staged together with its close, a still has a front.
+	b.enqueue(Tick{ 20, 1 });
+	EXPECT_FALSE(merger.try_dequeue(tick)); // c is open and could still bring something older.
+	EXPECT_FALSE(merger.drained());
+
+	c.enqueue(Tick{ 5, 2 });
+	ASSERT_TRUE(merger.try_dequeue(tick));
+	EXPECT_EQ(tick.ts, (std::uint64_t)5);
+	EXPECT_FALSE(merger.try_dequeue(tick)); // c is empty but open again.
+
+	c.close();
+	for (std::uint64_t ts : { 10, 20 }) {
+		ASSERT_TRUE(merger.try_dequeue(tick));
+		EXPECT_EQ(tick.ts, ts);
+	}
+	b.close();
+	EXPECT_FALSE(merger.try_dequeue(tick));
+	EXPECT_TRUE(merger.drained());
+	EXPECT_EQ(merger.late_count(), (size_t)0);
+}
+
+TEST(MergeConsumerTest, ReorderWindowReleasesPastASilentFeed) {
+	FeedQueue a, b;
+	Merger merger({ &a, &b }, TickTime(), 10);
+	Tick tick;
+
+	for (std::uint64_t ts = 1; ts <= 50; ++ts) {
+		a.enqueue(Tick{ ts, 0 });
+	}
+	std::vector<std::uint64_t> released;
+	while (merger.try_dequeue(tick)) {
+		released.push_back(tick.ts);
+	}
+	// All of a is staged (newest = 50), everything up to 50 - 10 is released.
+	ASSERT_FALSE(released.empty());
+	EXPECT_EQ(released.front(), (std::uint64_t)1);
+	EXPECT_EQ(released.back(), (std::uint64_t)40);
+
+	b.enqueue(Tick{ 5, 1 }); // Older than what was released: late.
+	ASSERT_TRUE(merger.try_dequeue(tick));
+	EXPECT_EQ(tick.ts, (std::uint64_t)5);
+	EXPECT_EQ(merger.late_count(), (size_t)1);
+}
@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "daking/shm_queue.hpp"
+
+struct ShmEvent {
+	std::uint32_t producer;
+	std::uint32_t seq;
+	std::uint64_t payload[3];
+};
+
+using ShmQueue = daking::MPSC_shm_queue<ShmEvent, 64>;
+
+static std::string shm_name(const char* test) {
+	return "/daking_test_" + std::to_string(::getpid()) + "_" + test;
+}
+
+TEST(ShmQueueTest, ProducerProcessesFeedOneConsumer) {
+	const int num_producers = 3;
+	const std::uint32_t per_producer = 30000;
+	std::string name = shm_name("feed");
+	ShmQueue queue = ShmQueue::create(name, 1024); // Much smaller than the traffic: nodes must be recycled.
+
+	std::vector<pid_t> children;
+	for (int p = 0; p < num_producers; ++p) {
+		pid_t pid = ::fork();
+		ASSERT_GE(pid, 0);
+		if (pid == 0) {
+			// Child: its own mapping, at whatever address, and its own producer handles.
+			ShmQueue attached = ShmQueue::attach(name);
+			auto producer = attached.make_producer();
+			ShmEvent batch[16];
+			std::uint32_t seq = 0;
+			while (seq < per_producer) {
+				if (seq % 2 == 0) {
+					std::uint32_t n = 0;
+					for (; n < 16 && seq + n < per_producer; ++n) batch[n] = ShmEvent{ (std::uint32_t)p, seq + n, {} };
+					std::size_t sent = producer.try_enqueue_bulk(batch, n);
+					seq += (std::uint32_t)sent;
+					if (sent == 0) ::sched_yield();
+				}
+				else if (producer.enqueue(ShmEvent{ (std::uint32_t)p, seq, {} })) {
+					++seq;
+				}
+			}
+			producer.release();
+			::_exit(0);
+		}
+		children.push_back(pid);
+	}
+
+	std::vector<std::uint32_t> next(num_producers, 0);
+	ShmEvent buf[64];
+	std::uint64_t received = 0;
+	while (received < (std::uint64_t)num_producers * per_producer) {
+		std::size_t n = queue.try_dequeue_bulk(buf, 64);
+		for (std::size_t i = 0; i < n; ++i) {
+			ASSERT_LT(buf[i].producer, (std::uint32_t)num_producers);
+			ASSERT_EQ(buf[i].seq, next[buf[i].producer]++);
+		}
+		received += n;
+		if (n == 0) ::sched_yield();
+	}
+	for (pid_t pid : children) {
+		int status = 0;
+		ASSERT_EQ(::waitpid(pid, &status, 0), pid);
+		EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(ShmQueueTest, CapacityIsBoundedAndRecycled) {
+	ShmQueue queue = ShmQueue::create(shm_name("capacity"), 100); // Rounded up to 2 chunks of 64
+	EXPECT_EQ(queue.capacity(), (std::size_t)128);
+	auto producer = queue.make_producer();
+
+	std::uint32_t sent = 0;
+	while (producer.try_enqueue(ShmEvent{ 0, sent, {} })) ++sent;
+	EXPECT_EQ(sent, (std::uint32_t)128);
+
+	ShmEvent event;
+	for (std::uint32_t i = 0; i < 64; ++i) {
+		ASSERT_TRUE(queue.try_dequeue(event));
+		EXPECT_EQ(event.seq, i);
+	}
+	// The consumer handed a full chunk back (the old dummy node and 63 elements).
+	for (std::uint32_t i = 0; i < 64; ++i) {
+		EXPECT_TRUE(producer.try_enqueue(ShmEvent{ 0, sent++, {} }));
+	}
+	for (std::uint32_t i = 64; i < sent; ++i) {
+		ASSERT_TRUE(queue.try_dequeue(event));
+		EXPECT_EQ(event.seq, i);
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(ShmQueueTest, CloseAndLayoutCheck) {
+	std::string name = shm_name("close");
+	ShmQueue queue = ShmQueue::create(name, 64);
+	EXPECT_THROW(ShmQueue::create(name, 64), std::system_error); // Already exists
+	EXPECT_THROW((daking::MPSC_shm_queue<std::uint64_t, 64>::attach(name)), std::runtime_error);
+
+	ShmQueue other = ShmQueue::attach(name);
+	auto producer = other.make_producer();
+	EXPECT_TRUE(producer.enqueue(ShmEvent{ 0, 7, {} }));
+	other.close(); // From the producer side
+
+	EXPECT_FALSE(producer.try_enqueue(ShmEvent{ 0, 8, {} }));
+	EXPECT_TRUE(queue.is_closed());
+	ShmEvent event;
+	EXPECT_EQ(queue.try_dequeue_status(event), daking::MPSC_dequeue_status::dequeued);
+	EXPECT_EQ(event.seq, 7u);
+	EXPECT_EQ(queue.try_dequeue_status(event), daking::MPSC_dequeue_status::closed);
+	EXPECT_TRUE(queue.empty());
+}
+
+#endif
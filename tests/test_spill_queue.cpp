@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "daking/spill_queue.hpp"
+
+struct SpillEvent {
+	std::uint32_t producer;
+	std::uint32_t seq;
+};
+
+template <>
+struct daking::MPSC_spill_traits<std::string> {
+	static std::size_t size(const std::string& s) noexcept { return s.size(); }
+	static void write(const std::string& s, unsigned char* dst) noexcept { std::memcpy(dst, s.data(), s.size()); }
+	static std::string read(const unsigned char* src, std::size_t size) { return std::string((const char*)src, size); }
+};
+
+struct SpillDirectory {
+	SpillDirectory() {
+		char pattern[] = "/tmp/daking_spill_test_XXXXXX";
+		path = ::mkdtemp(pattern);
+	}
+
+	~SpillDirectory() {
+		::rmdir(path.c_str());
+	}
+
+	std::size_t file_count() const {
+		std::size_t count = 0;
+		if (DIR* dir = ::opendir(path.c_str())) {
+			while (dirent* entry = ::readdir(dir)) {
+				if (entry->d_name[0] != '.') ++count;
+			}
+			::closedir(dir);
+		}
+		return count;
+	}
+
+	std::string path;
+};
+
+TEST(SpillQueueTest, SpillsOverBudgetAndReadsBackInOrder) {
+	using Q = daking::MPSC_spill_queue<std::uint64_t, daking::MPSC_spill_traits<std::uint64_t>, 16>;
+	Q::set_global_node_budget(4 * 16);
+	SpillDirectory dir;
+	{
+		Q queue({ dir.path, 4096 }); // Small segments: the reader has to follow several files.
+		const std::uint64_t n = 5000;
+		for (std::uint64_t i = 0; i < n; ++i) {
+			ASSERT_TRUE(queue.enqueue(i));
+		}
+		EXPECT_TRUE(queue.spilling());
+		EXPECT_GT(queue.spilled_count(), n - 4 * 16);
+		EXPECT_LE(Q::global_node_size_apprx(), (std::size_t)4 * 16);
+		EXPECT_GT(dir.file_count(), (std::size_t)1);
+
+		std::uint64_t value;
+		for (std::uint64_t i = 0; i < n; ++i) {
+			ASSERT_TRUE(queue.try_dequeue(value));
+			ASSERT_EQ(value, i);
+		}
+		EXPECT_FALSE(queue.try_dequeue(value));
+		EXPECT_FALSE(queue.spilling());
+		EXPECT_EQ(dir.file_count(), (std::size_t)1); // Read segments are unlinked, the last one is reused.
+
+		// Back to the nodes, then a second episode in the same file.
+		std::uint64_t batch[100];
+		for (std::uint64_t i = 0; i < 100; ++i) batch[i] = n + i;
+		ASSERT_TRUE(queue.enqueue_bulk(batch, 10));
+		EXPECT_FALSE(queue.spilling());
+		ASSERT_TRUE(queue.enqueue_bulk(batch + 10, 90));
+		EXPECT_TRUE(queue.spilling());
+		for (std::uint64_t i = 0; i < 100; ++i) {
+			ASSERT_TRUE(queue.try_dequeue(value));
+			ASSERT_EQ(value, n + i);
+		}
+
+		queue.enqueue(std::uint64_t(1));
+		queue.close();
+		EXPECT_FALSE(queue.enqueue(std::uint64_t(2)));
+		EXPECT_EQ(queue.try_dequeue_status(value), daking::MPSC_dequeue_status::dequeued);
+		EXPECT_EQ(queue.try_dequeue_status(value), daking::MPSC_dequeue_status::closed);
+	}
+	EXPECT_EQ(dir.file_count(), (std::size_t)0);
+}
+
+TEST(SpillQueueTest, UserSerialisedType) {
+	using Q = daking::MPSC_spill_queue<std::string, daking::MPSC_spill_traits<std::string>, 16>;
+	Q::set_global_node_budget(2 * 16);
+	SpillDirectory dir;
+	Q queue({ dir.path, 4096 });
+	for (int i = 0; i < 500; ++i) {
+		queue.enqueue(std::string(i % 37, 'a' + i % 26) + std::to_string(i));
+	}
+	queue.enqueue(std::string(10000, 'z')); // Larger than a segment.
+	EXPECT_GT(queue.spilled_count(), (std::size_t)400);
+
+	std::string value;
+	for (int i = 0; i < 500; ++i) {
+		ASSERT_TRUE(queue.try_dequeue(value));
+		ASSERT_EQ(value, std::string(i % 37, 'a' + i % 26) + std::to_string(i));
+	}
+	ASSERT_TRUE(queue.try_dequeue(value));
+	EXPECT_EQ(value, std::string(10000, 'z'));
+	EXPECT_FALSE(queue.try_dequeue(value));
+}
+
+TEST(SpillQueueTest, ConcurrentProducersKeepTheirOrder) {
+	using Q = daking::MPSC_spill_queue<SpillEvent, daking::MPSC_spill_traits<SpillEvent>, 16>;
+	Q::set_global_node_budget(8 * 16);
+	SpillDirectory dir;
+	{
+		Q queue({ dir.path, 1 << 16 });
+		const int num_producers = 4;
+		const std::uint32_t per_producer = 50000;
+		std::vector<std::thread> producers;
+		for (int p = 0; p < num_producers; ++p) {
+			producers.emplace_back([&, p] {
+				SpillEvent batch[8];
+				std::uint32_t seq = 0;
+				while (seq < per_producer) {
+					if (seq % 64 == 0 && seq + 8 <= per_producer) {
+						for (std::uint32_t k = 0; k < 8; ++k) batch[k] = SpillEvent{ (std::uint32_t)p, seq + k };
+						ASSERT_TRUE(queue.enqueue_bulk(batch, 8));
+						seq += 8;
+					}
+					else {
+						ASSERT_TRUE(queue.enqueue(SpillEvent{ (std::uint32_t)p, seq++ }));
+					}
+					if (seq % 512 == 0) {
+						std::this_thread::sleep_for(std::chrono::microseconds(100)); // Let the consumer catch up and end the episode.
+					}
+				}
+			});
+		}
+
+		// The consumer keeps stalling, so episodes start and end while producers race with them.
+		std::vector<std::uint32_t> next(num_producers, 0);
+		std::uint64_t total = 0, spin = 0;
+		SpillEvent event;
+		while (total < (std::uint64_t)num_producers * per_producer) {
+			if (queue.try_dequeue(event)) {
+				ASSERT_EQ(event.seq, next[event.producer]);
+				++next[event.producer];
+				++total;
+			}
+			if (++spin % 65536 == 0) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		for (auto& t : producers) t.join();
+		EXPECT_FALSE(queue.try_dequeue(event));
+		EXPECT_GT(queue.spilled_count(), (std::size_t)0);
+		EXPECT_LE(Q::global_node_size_apprx(), (std::size_t)8 * 16);
+	}
+	EXPECT_EQ(dir.file_count(), (std::size_t)0);
+}
+
+#endif